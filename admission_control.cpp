@@ -0,0 +1,143 @@
+#include "admission_control.hpp"
+#include "call_metrics.hpp"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace pj;
+using namespace std;
+
+static uint64_t process_cpu_us() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+         + (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+AdmissionControl::AdmissionControl()
+    : _tokens(0), _refillUs(0), _accountLimit(0), _retryAfterSec(0), _sampling(false), _admitted(0),
+      _dueUs(0), _lagUs(0), _cpuPercent(0), _cpuWindowUs(0), _cpuTimeUs(0) {
+    memset(&_config, 0, sizeof(_config));
+    _config.version = PJSUA2_ADMISSION_CONFIG_VERSION;
+    for (auto& counter : _rejected) {
+        counter.store(0, memory_order_relaxed);
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    _cpus = cpus > 0 ? (unsigned)cpus : 1;
+}
+
+void AdmissionControl::configure(const AdmissionConfig& config) {
+    lock_guard<mutex> lock(_mutex);
+    _config = config;
+    _tokens = config.burst ? config.burst : config.calls_per_second;
+    _refillUs = CallMetrics::now_us();
+    _accountLimit.store(config.max_calls_per_account, memory_order_relaxed);
+    _retryAfterSec.store(config.retry_after_sec, memory_order_relaxed);
+    bool sampling = config.max_loop_lag_ms || config.max_cpu_percent;
+    if (!sampling) {
+        // Samples go stale once the timer stops: do not report them
+        _lagUs.store(0, memory_order_relaxed);
+        _cpuPercent.store(0, memory_order_relaxed);
+    }
+    _sampling.store(sampling, memory_order_relaxed);
+}
+
+uint64_t AdmissionControl::_lag_us(uint64_t now_us) const {
+    uint64_t lag = _lagUs.load(memory_order_relaxed);
+    uint64_t due = _dueUs.load(memory_order_relaxed);
+    return due && now_us > due ? max(lag, now_us - due) : lag;
+}
+
+AdmissionVerdict AdmissionControl::admit(int account_calls, size_t queue_depth) {
+    uint64_t now = CallMetrics::now_us();
+    AdmissionVerdict verdict = ADMISSION_ACCEPT;
+    {
+        lock_guard<mutex> lock(_mutex);
+        const AdmissionConfig& config = _config;
+        if (config.max_loop_lag_ms && _lag_us(now) > config.max_loop_lag_ms * 1000ull) {
+            verdict = ADMISSION_REJECT_LAG;
+        } else if (config.max_cpu_percent && _cpuPercent.load(memory_order_relaxed) > config.max_cpu_percent) {
+            verdict = ADMISSION_REJECT_CPU;
+        } else if (config.max_event_queue && queue_depth > config.max_event_queue) {
+            verdict = ADMISSION_REJECT_QUEUE;
+        } else if (config.max_calls_per_account && account_calls >= (int)config.max_calls_per_account) {
+            verdict = ADMISSION_REJECT_ACCOUNT;
+        } else if (config.calls_per_second) {
+            double depth = config.burst ? config.burst : config.calls_per_second;
+            _tokens = min(depth, _tokens + (now - _refillUs) * config.calls_per_second / 1e6);
+            _refillUs = now;
+            if (_tokens < 1.0) {
+                verdict = ADMISSION_REJECT_RATE;
+            } else {
+                _tokens -= 1.0;
+            }
+        }
+    }
+    if (verdict == ADMISSION_ACCEPT) {
+        _admitted.fetch_add(1, memory_order_relaxed);
+    } else {
+        _rejected[verdict].fetch_add(1, memory_order_relaxed);
+    }
+    return verdict;
+}
+
+int AdmissionControl::status_code(AdmissionVerdict verdict) {
+    return verdict == ADMISSION_REJECT_ACCOUNT ? PJSIP_SC_BUSY_HERE : PJSIP_SC_SERVICE_UNAVAILABLE;
+}
+
+const char* AdmissionControl::reason(AdmissionVerdict verdict) {
+    switch (verdict) {
+        case ADMISSION_REJECT_RATE:
+            return "Call Rate Exceeded";
+        case ADMISSION_REJECT_ACCOUNT:
+            return "Busy Here";
+        case ADMISSION_REJECT_QUEUE:
+        case ADMISSION_REJECT_LAG:
+        case ADMISSION_REJECT_CPU:
+            return "Overloaded";
+        default:
+            return "OK";
+    }
+}
+
+void AdmissionControl::timer_armed(uint64_t due_us) {
+    _dueUs.store(due_us, memory_order_relaxed);
+}
+
+void AdmissionControl::timer_fired(uint64_t now_us) {
+    uint64_t due = _dueUs.exchange(0, memory_order_relaxed);
+    _lagUs.store(due && now_us > due ? now_us - due : 0, memory_order_relaxed);
+
+    uint64_t cpu = process_cpu_us();
+    if (_cpuWindowUs == 0) {
+        _cpuWindowUs = now_us;
+        _cpuTimeUs = cpu;
+    } else if (now_us - _cpuWindowUs >= CPU_WINDOW_MS * 1000ull) {
+        uint64_t busy = cpu > _cpuTimeUs ? cpu - _cpuTimeUs : 0;
+        _cpuPercent.store((unsigned)(busy * 100 / ((now_us - _cpuWindowUs) * _cpus)), memory_order_relaxed);
+        _cpuWindowUs = now_us;
+        _cpuTimeUs = cpu;
+    }
+}
+
+void AdmissionControl::read(AdmissionStats& out) const {
+    memset(&out, 0, sizeof(out));
+    out.admitted = _admitted.load(memory_order_relaxed);
+    out.rejected_rate = _rejected[ADMISSION_REJECT_RATE].load(memory_order_relaxed);
+    out.rejected_account = _rejected[ADMISSION_REJECT_ACCOUNT].load(memory_order_relaxed);
+    out.rejected_queue = _rejected[ADMISSION_REJECT_QUEUE].load(memory_order_relaxed);
+    out.rejected_lag = _rejected[ADMISSION_REJECT_LAG].load(memory_order_relaxed);
+    out.rejected_cpu = _rejected[ADMISSION_REJECT_CPU].load(memory_order_relaxed);
+    out.loop_lag_us = _lag_us(CallMetrics::now_us());
+    out.cpu_percent = _cpuPercent.load(memory_order_relaxed);
+}
+
+void AdmissionControl::reset() {
+    _admitted.store(0, memory_order_relaxed);
+    for (auto& counter : _rejected) {
+        counter.store(0, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,155 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <pjsua2.hpp>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#define PJSUA2_ADMISSION_CONFIG_VERSION 1 /**< Current AdmissionConfig layout version */
+
+/**
+ * @brief Limits applied to incoming INVITEs, all disabled by default.
+ */
+typedef struct {
+    unsigned version;               /**< Must be PJSUA2_ADMISSION_CONFIG_VERSION */
+    unsigned calls_per_second;      /**< New incoming calls admitted per second, 0 no limit */
+    unsigned burst;                 /**< Calls admitted back to back, 0 uses calls_per_second */
+    unsigned max_calls_per_account; /**< Concurrent calls per account, 0 no limit */
+    unsigned max_event_queue;       /**< Events awaiting pjsua2_poll_events above which calls are refused, 0 disabled */
+    unsigned max_loop_lag_ms;       /**< SIP timer lag above which calls are refused, 0 disabled */
+    unsigned max_cpu_percent;       /**< Process CPU (percent of all cores) above which calls are refused, 0 disabled */
+    unsigned retry_after_sec;       /**< Retry-After sent with rejections, 0 omits the header */
+} AdmissionConfig;
+
+/**
+ * @brief Admission counters and load samples, as exported to Dart.
+ */
+typedef struct {
+    uint64_t admitted;          /**< INVITEs accepted into the registry */
+    uint64_t rejected_rate;     /**< 503: calls per second limit */
+    uint64_t rejected_account;  /**< 486: account at its concurrent call limit */
+    uint64_t rejected_queue;    /**< 503: event queue too deep */
+    uint64_t rejected_lag;      /**< 503: SIP timers running late */
+    uint64_t rejected_cpu;      /**< 503: process CPU too high */
+    uint64_t loop_lag_us;       /**< Latest SIP timer lag */
+    uint32_t cpu_percent;       /**< Latest process CPU sample */
+    uint32_t event_queue;       /**< Events awaiting pjsua2_poll_events */
+} AdmissionStats;
+
+/**
+ * @brief Decision on an incoming INVITE.
+ */
+typedef enum {
+    ADMISSION_ACCEPT = 0,           /**< Call admitted */
+    ADMISSION_REJECT_RATE = 1,      /**< Token bucket empty */
+    ADMISSION_REJECT_ACCOUNT = 2,   /**< Account at its concurrent call limit */
+    ADMISSION_REJECT_QUEUE = 3,     /**< Event queue too deep */
+    ADMISSION_REJECT_LAG = 4,       /**< Event loop lagging */
+    ADMISSION_REJECT_CPU = 5        /**< CPU above threshold */
+} AdmissionVerdict;
+
+
+/**
+ * @brief Call admission controller in front of onIncomingCall.
+ *
+ * Overload is checked first (SIP timer lag, process CPU, event queue depth),
+ * then the account's concurrent calls and finally a token bucket, so a
+ * refused call never consumes a token. Lag and CPU are sampled by a SIP
+ * timer every SAMPLE_INTERVAL_MS, armed only while a lag or CPU limit is
+ * set; a timer overdue at decision time counts as lag, so a stalled loop is
+ * detected before the timer fires.
+ */
+class AdmissionControl {
+public:
+    static const unsigned SAMPLE_INTERVAL_MS = 100; /**< Lag and CPU sampling period */
+
+    AdmissionControl();
+
+    /**
+     * @brief Replace the limits (the token bucket starts full)
+     */
+    void configure(const AdmissionConfig& config);
+
+    /**
+     * @brief Concurrent call limit per account, 0 if disabled
+     */
+    unsigned account_limit() const { return _accountLimit.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Retry-After value of rejections, 0 if the header is omitted
+     */
+    unsigned retry_after_sec() const { return _retryAfterSec.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief True while a lag or CPU limit needs the sampling timer
+     */
+    bool sampling() const { return _sampling.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Decide on an incoming call and count the decision (any thread)
+     *
+     * @param account_calls Live calls of the receiving account
+     * @param queue_depth Events awaiting pjsua2_poll_events
+     * @return AdmissionVerdict ADMISSION_ACCEPT or the reason of the rejection
+     */
+    AdmissionVerdict admit(int account_calls, size_t queue_depth);
+
+    /**
+     * @brief SIP status code of a rejection: 486 for a busy account, 503 otherwise
+     */
+    static int status_code(AdmissionVerdict verdict);
+
+    /**
+     * @brief Reason phrase of a rejection
+     */
+    static const char* reason(AdmissionVerdict verdict);
+
+    /**
+     * @brief The sampling timer was armed to fire at due_us (0: disarmed)
+     */
+    void timer_armed(uint64_t due_us);
+
+    /**
+     * @brief The sampling timer fired: record the lag and sample CPU (timer thread)
+     */
+    void timer_fired(uint64_t now_us);
+
+    /**
+     * @brief Copy the counters and latest samples (event_queue is left to the caller)
+     */
+    void read(AdmissionStats& out) const;
+
+    /**
+     * @brief Reset the counters
+     */
+    void reset();
+
+private:
+    static const unsigned CPU_WINDOW_MS = 1000;  /**< CPU sampling window */
+
+    /**
+     * @brief Lag at now_us, counting a late timer that has not fired yet
+     */
+    uint64_t _lag_us(uint64_t now_us) const;
+
+    std::mutex _mutex;                           /**< Guards the limits and the token bucket */
+    AdmissionConfig _config;                     /**< Limits in effect */
+    double _tokens;                              /**< Calls that may be admitted now */
+    uint64_t _refillUs;                          /**< Last token refill */
+    std::atomic<unsigned> _accountLimit;         /**< _config.max_calls_per_account, read without the lock */
+    std::atomic<unsigned> _retryAfterSec;        /**< _config.retry_after_sec, read without the lock */
+    std::atomic<bool> _sampling;                 /**< A lag or CPU limit is set */
+
+    std::atomic<uint64_t> _admitted;             /**< Admitted counter */
+    std::atomic<uint64_t> _rejected[ADMISSION_REJECT_CPU + 1]; /**< Rejection counters by verdict */
+
+    std::atomic<uint64_t> _dueUs;                /**< Sampling timer deadline, 0 if not armed */
+    std::atomic<uint64_t> _lagUs;                /**< Latest lag sample */
+    std::atomic<unsigned> _cpuPercent;           /**< Latest CPU sample */
+    uint64_t _cpuWindowUs;                       /**< Start of the CPU window (timer thread) */
+    uint64_t _cpuTimeUs;                         /**< Process CPU time at the window start (timer thread) */
+    unsigned _cpus;                              /**< Online processors */
+};
+
+#endif // ADMISSION_CONTROL_H
@@ -0,0 +1,201 @@
+#include "call_metrics.hpp"
+
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+int LatencyHistogram::_bucket_of(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return (int)value;
+    }
+    // Position of the leading bit selects the power of two, the next 3 bits the sub-bucket
+    int magnitude = 63 - __builtin_clzll(value);
+    int sub = (int)((value >> (magnitude - 3)) & (SUB_BUCKETS - 1));
+    int bucket = (magnitude - 2) * SUB_BUCKETS + sub;
+    return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+uint64_t LatencyHistogram::_upper_bound(int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return (uint64_t)bucket;
+    }
+    int magnitude = bucket / SUB_BUCKETS + 2;
+    uint64_t sub = (uint64_t)(bucket % SUB_BUCKETS);
+    return ((SUB_BUCKETS + sub + 1) << (magnitude - 3)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value_us) {
+    _buckets[_bucket_of(value_us)].fetch_add(1, memory_order_relaxed);
+    _count.fetch_add(1, memory_order_relaxed);
+    _sum.fetch_add(value_us, memory_order_relaxed);
+
+    uint64_t current = _min.load(memory_order_relaxed);
+    while (value_us < current && !_min.compare_exchange_weak(current, value_us, memory_order_relaxed)) {
+    }
+    current = _max.load(memory_order_relaxed);
+    while (value_us > current && !_max.compare_exchange_weak(current, value_us, memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::summarize(LatencySummary& out) const {
+    memset(&out, 0, sizeof(out));
+    uint64_t counts[BUCKETS];
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        counts[i] = _buckets[i].load(memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) return;
+
+    out.count = total;
+    out.min_us = _min.load(memory_order_relaxed);
+    out.max_us = _max.load(memory_order_relaxed);
+    out.mean_us = _sum.load(memory_order_relaxed) / total;
+
+    const double quantiles[4] = {0.50, 0.90, 0.99, 0.999};
+    uint64_t* targets[4] = {&out.p50_us, &out.p90_us, &out.p99_us, &out.p999_us};
+    uint64_t seen = 0;
+    int q = 0;
+    for (int i = 0; i < BUCKETS && q < 4; i++) {
+        seen += counts[i];
+        while (q < 4 && seen >= (uint64_t)(quantiles[q] * total + 0.5)) {
+            *targets[q++] = min(_upper_bound(i), out.max_us);
+        }
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < BUCKETS; i++) {
+        _buckets[i].store(0, memory_order_relaxed);
+    }
+    _count.store(0, memory_order_relaxed);
+    _sum.store(0, memory_order_relaxed);
+    _min.store(UINT64_MAX, memory_order_relaxed);
+    _max.store(0, memory_order_relaxed);
+}
+
+
+CallMetrics::CallMetrics() : _attempted(0), _answered(0), _failed(0) {
+    for (Timeline& timeline : _timelines) {
+        timeline.inviteUs.store(0, memory_order_relaxed);
+        timeline.provisionalUs.store(0, memory_order_relaxed);
+        timeline.okUs.store(0, memory_order_relaxed);
+        timeline.confirmedUs.store(0, memory_order_relaxed);
+        timeline.mediaUs.store(0, memory_order_relaxed);
+        timeline.hangupUs.store(0, memory_order_relaxed);
+        timeline.outbound.store(false, memory_order_relaxed);
+    }
+}
+
+uint64_t CallMetrics::now_us() {
+    return (uint64_t)chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CallMetrics::Timeline* CallMetrics::_timeline(int index) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return nullptr;
+    return &_timelines[index];
+}
+
+void CallMetrics::call_started(int index, bool outbound) {
+    Timeline* timeline = _timeline(index);
+    if (!timeline) return;
+    timeline->provisionalUs.store(0, memory_order_relaxed);
+    timeline->okUs.store(0, memory_order_relaxed);
+    timeline->confirmedUs.store(0, memory_order_relaxed);
+    timeline->mediaUs.store(0, memory_order_relaxed);
+    timeline->hangupUs.store(0, memory_order_relaxed);
+    timeline->outbound.store(outbound, memory_order_relaxed);
+    timeline->inviteUs.store(now_us(), memory_order_release);
+    _attempted.fetch_add(1, memory_order_relaxed);
+}
+
+void CallMetrics::call_state(int index, pjsip_inv_state state) {
+    Timeline* timeline = _timeline(index);
+    if (!timeline) return;
+    uint64_t now = now_us();
+    uint64_t invite = timeline->inviteUs.load(memory_order_acquire);
+
+    switch (state) {
+        case PJSIP_INV_STATE_EARLY:
+            {
+                uint64_t expected = 0;
+                if (timeline->provisionalUs.compare_exchange_strong(expected, now)
+                        && invite && timeline->outbound.load(memory_order_relaxed)) {
+                    _postDialDelay.record(now - invite);
+                }
+            }
+            break;
+        case PJSIP_INV_STATE_CONNECTING:
+            timeline->okUs.store(now, memory_order_relaxed);
+            if (invite) {
+                _answerTime.record(now - invite);
+            }
+            break;
+        case PJSIP_INV_STATE_CONFIRMED:
+            timeline->confirmedUs.store(now, memory_order_relaxed);
+            _answered.fetch_add(1, memory_order_relaxed);
+            break;
+        case PJSIP_INV_STATE_DISCONNECTED:
+            {
+                uint64_t hangup = timeline->hangupUs.load(memory_order_relaxed);
+                if (hangup) {
+                    _teardownTime.record(now - hangup);
+                } else if (!timeline->confirmedUs.load(memory_order_relaxed) && invite) {
+                    _failed.fetch_add(1, memory_order_relaxed);
+                }
+                timeline->inviteUs.store(0, memory_order_relaxed);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void CallMetrics::media_active(int index) {
+    Timeline* timeline = _timeline(index);
+    if (!timeline) return;
+    uint64_t expected = 0;
+    uint64_t now = now_us();
+    // Only the first activation counts; re-INVITEs update media again
+    if (timeline->mediaUs.compare_exchange_strong(expected, now)) {
+        uint64_t ok = timeline->okUs.load(memory_order_relaxed);
+        if (ok) {
+            _mediaSetup.record(now - ok);
+        }
+    }
+}
+
+void CallMetrics::hangup_requested(int index) {
+    Timeline* timeline = _timeline(index);
+    if (!timeline) return;
+    uint64_t expected = 0;
+    timeline->hangupUs.compare_exchange_strong(expected, now_us());
+}
+
+void CallMetrics::read(MetricsData& out) const {
+    memset(&out, 0, sizeof(out));
+    out.version = PJSUA2_METRICS_VERSION;
+    out.calls_attempted = _attempted.load(memory_order_relaxed);
+    out.calls_answered = _answered.load(memory_order_relaxed);
+    out.calls_failed = _failed.load(memory_order_relaxed);
+    _postDialDelay.summarize(out.post_dial_delay);
+    _answerTime.summarize(out.answer_time);
+    _mediaSetup.summarize(out.media_setup);
+    _teardownTime.summarize(out.teardown_time);
+}
+
+void CallMetrics::reset() {
+    _attempted.store(0, memory_order_relaxed);
+    _answered.store(0, memory_order_relaxed);
+    _failed.store(0, memory_order_relaxed);
+    _postDialDelay.reset();
+    _answerTime.reset();
+    _mediaSetup.reset();
+    _teardownTime.reset();
+}
@@ -0,0 +1,152 @@
+#ifndef CALL_METRICS_H
+#define CALL_METRICS_H
+
+#include <pjsua2.hpp>
+#include <atomic>
+#include <cstdint>
+
+#define PJSUA2_METRICS_VERSION 1 /**< Current MetricsData layout version */
+
+/**
+ * @brief Summary of one latency histogram, all values in microseconds.
+ */
+typedef struct {
+    uint64_t count;     /**< Number of samples */
+    uint64_t min_us;    /**< Smallest sample */
+    uint64_t max_us;    /**< Largest sample */
+    uint64_t mean_us;   /**< Arithmetic mean */
+    uint64_t p50_us;    /**< Median (bucket upper bound) */
+    uint64_t p90_us;    /**< 90th percentile */
+    uint64_t p99_us;    /**< 99th percentile */
+    uint64_t p999_us;   /**< 99.9th percentile */
+} LatencySummary;
+
+/**
+ * @brief Signalling metrics exported through pjsua2_get_metrics.
+ */
+typedef struct {
+    unsigned version;               /**< PJSUA2_METRICS_VERSION */
+    unsigned reserved;              /**< Padding, always 0 */
+    uint64_t calls_attempted;       /**< INVITEs sent or received */
+    uint64_t calls_answered;        /**< Calls that reached CONFIRMED */
+    uint64_t calls_failed;          /**< Calls disconnected before CONFIRMED, not cancelled locally */
+    LatencySummary post_dial_delay; /**< INVITE sent -> first provisional reply (outbound) */
+    LatencySummary answer_time;     /**< INVITE sent/received -> 200 OK */
+    LatencySummary media_setup;     /**< 200 OK -> media active */
+    LatencySummary teardown_time;   /**< Local hangup -> DISCONNECTED */
+} MetricsData;
+
+
+/**
+ * @brief Lock-free log-linear histogram (HDR style).
+ *
+ * Values are bucketed by power of two with 8 linear sub-buckets each, so
+ * any sample is stored with at most 12.5% relative error. Recording is a
+ * handful of relaxed atomic increments.
+ */
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKETS = 8;                    /**< Linear sub-buckets per power of two */
+    static const int BUCKETS = 40 * SUB_BUCKETS;         /**< Covers up to 2^40 us */
+
+    LatencyHistogram();
+
+    /**
+     * @brief Record one sample (any thread)
+     */
+    void record(uint64_t value_us);
+
+    /**
+     * @brief Summarise the recorded samples
+     */
+    void summarize(LatencySummary& out) const;
+
+    /**
+     * @brief Forget all samples
+     */
+    void reset();
+
+private:
+    static int _bucket_of(uint64_t value);
+    static uint64_t _upper_bound(int bucket);
+
+    std::atomic<uint64_t> _buckets[BUCKETS]; /**< Sample counts */
+    std::atomic<uint64_t> _count;            /**< Total samples */
+    std::atomic<uint64_t> _sum;              /**< Sum of samples */
+    std::atomic<uint64_t> _min;              /**< Smallest sample */
+    std::atomic<uint64_t> _max;              /**< Largest sample */
+};
+
+
+/**
+ * @brief Per-call lifecycle timestamps aggregated into latency histograms.
+ *
+ * Timestamps come from a monotonic clock and are kept per pjsua call index.
+ * All entry points are safe from any thread.
+ */
+class CallMetrics {
+public:
+    CallMetrics();
+
+    /**
+     * @brief Monotonic time in microseconds
+     */
+    static uint64_t now_us();
+
+    /**
+     * @brief INVITE sent (outbound) or received (inbound)
+     */
+    void call_started(int index, bool outbound);
+
+    /**
+     * @brief Call reached a new invite session state
+     */
+    void call_state(int index, pjsip_inv_state state);
+
+    /**
+     * @brief Audio media became active
+     */
+    void media_active(int index);
+
+    /**
+     * @brief The application asked to hang the call up
+     */
+    void hangup_requested(int index);
+
+    /**
+     * @brief Export counters and histogram summaries
+     */
+    void read(MetricsData& out) const;
+
+    /**
+     * @brief Reset counters and histograms (timelines of live calls are kept)
+     */
+    void reset();
+
+private:
+    struct Timeline {
+        std::atomic<uint64_t> inviteUs;      /**< INVITE sent/received */
+        std::atomic<uint64_t> provisionalUs; /**< First provisional reply */
+        std::atomic<uint64_t> okUs;          /**< 200 OK (CONNECTING) */
+        std::atomic<uint64_t> confirmedUs;   /**< ACK (CONFIRMED) */
+        std::atomic<uint64_t> mediaUs;       /**< Media active */
+        std::atomic<uint64_t> hangupUs;      /**< Local hangup requested */
+        std::atomic<bool> outbound;          /**< Call placed by us */
+    };
+
+    /**
+     * @brief Timeline of a pjsua index, nullptr if out of range
+     */
+    Timeline* _timeline(int index);
+
+    Timeline _timelines[PJSUA_MAX_CALLS];    /**< Indexed by pjsua call index */
+    std::atomic<uint64_t> _attempted;        /**< Calls attempted */
+    std::atomic<uint64_t> _answered;         /**< Calls answered */
+    std::atomic<uint64_t> _failed;           /**< Calls failed */
+    LatencyHistogram _postDialDelay;         /**< INVITE -> first provisional */
+    LatencyHistogram _answerTime;            /**< INVITE -> 200 OK */
+    LatencyHistogram _mediaSetup;            /**< 200 OK -> media active */
+    LatencyHistogram _teardownTime;          /**< Hangup -> DISCONNECTED */
+};
+
+#endif // CALL_METRICS_H
@@ -0,0 +1,70 @@
+#include "call_pool.hpp"
+
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+CallPool::CallPool() : _count(0), _stride(0), _overflow(0) {
+}
+
+void CallPool::reserve(size_t count, size_t object_size) {
+    lock_guard<mutex> lock(_mutex);
+    if (_storage || count == 0) return;
+
+    // Keep every slot on its own cache lines
+    _stride = (sizeof(Header) + object_size + 63) & ~(size_t)63;
+    _count = count;
+    _storage = unique_ptr<unsigned char[]>(new unsigned char[_stride * _count + 64]);
+    // Touch the pages now so call setup never faults them in
+    memset(_storage.get(), 0, _stride * _count + 64);
+
+    unsigned char* base = _storage.get();
+    base += (64 - (reinterpret_cast<uintptr_t>(base) & 63)) & 63;
+    _free.reserve(_count);
+    for (size_t i = _count; i > 0; i--) {
+        _free.push_back(reinterpret_cast<Header*>(base + (i - 1) * _stride));
+    }
+}
+
+void* CallPool::allocate(size_t size) {
+    Header* header = nullptr;
+    {
+        lock_guard<mutex> lock(_mutex);
+        if (!_free.empty() && sizeof(Header) + size <= _stride) {
+            header = _free.back();
+            _free.pop_back();
+        } else {
+            _overflow++;
+        }
+    }
+    if (header) {
+        header->pool = this;
+    } else {
+        header = static_cast<Header*>(::operator new(sizeof(Header) + size));
+        header->pool = nullptr;
+    }
+    return header + 1;
+}
+
+void CallPool::deallocate(void* ptr) {
+    if (!ptr) return;
+    Header* header = static_cast<Header*>(ptr) - 1;
+    CallPool* pool = header->pool;
+    if (!pool) {
+        ::operator delete(header);
+        return;
+    }
+    lock_guard<mutex> lock(pool->_mutex);
+    pool->_free.push_back(header);
+}
+
+uint32_t CallPool::in_use() const {
+    lock_guard<mutex> lock(_mutex);
+    return (uint32_t)(_count - _free.size());
+}
+
+uint32_t CallPool::overflow() const {
+    lock_guard<mutex> lock(_mutex);
+    return _overflow;
+}
@@ -0,0 +1,92 @@
+#ifndef CALL_POOL_H
+#define CALL_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Memory usage of the process and of the manager's pools.
+ */
+typedef struct {
+    uint64_t rss_bytes;             /**< Resident set size of the process */
+    uint64_t pj_pool_used_bytes;    /**< Bytes held by live PJSIP pools */
+    uint64_t pj_pool_peak_bytes;    /**< Peak of pj_pool_used_bytes */
+    uint64_t pj_pool_cached_bytes;  /**< Bytes of released PJSIP pools kept for reuse */
+    uint32_t call_pool_capacity;    /**< Preallocated call objects */
+    uint32_t call_pool_in_use;      /**< Call objects currently live in the pool */
+    uint32_t call_pool_overflow;    /**< Calls that had to be heap-allocated */
+    uint32_t reserved;              /**< Padding, always 0 */
+} MemoryStats;
+
+
+/**
+ * @brief Fixed pool of call object slots.
+ *
+ * The slots are allocated and touched once, when the pool is reserved for
+ * the configured number of calls, so placing and recycling calls never
+ * reaches the heap and the memory they use is resident and bounded from
+ * startup. Each slot starts with a header naming its pool, which lets the
+ * class-specific operator delete return the object without a reference to
+ * the manager. When every slot is taken the object falls back to the heap
+ * and is counted.
+ */
+class CallPool {
+public:
+    CallPool();
+
+    CallPool(const CallPool&) = delete;
+    CallPool& operator=(const CallPool&) = delete;
+
+    /**
+     * @brief Preallocate the slots (once, before the first allocate())
+     *
+     * @param count Number of objects
+     * @param object_size Size of the largest object placed in the pool
+     */
+    void reserve(size_t count, size_t object_size);
+
+    /**
+     * @brief Storage for one object (any thread)
+     *
+     * @param size Object size
+     * @return void* Pool slot, or heap memory if the pool is exhausted or too small
+     */
+    void* allocate(size_t size);
+
+    /**
+     * @brief Return storage obtained from allocate() of any pool
+     */
+    static void deallocate(void* ptr);
+
+    /**
+     * @brief Number of slots
+     */
+    uint32_t capacity() const { return (uint32_t)_count; }
+
+    /**
+     * @brief Slots in use
+     */
+    uint32_t in_use() const;
+
+    /**
+     * @brief Allocations served from the heap
+     */
+    uint32_t overflow() const;
+
+private:
+    struct alignas(16) Header {
+        CallPool* pool;   /**< Owning pool, null for heap memory */
+    };
+
+    std::unique_ptr<unsigned char[]> _storage; /**< Slot memory */
+    size_t _count;                             /**< Number of slots */
+    size_t _stride;                            /**< Bytes per slot, header included */
+    mutable std::mutex _mutex;                 /**< Guards the free list */
+    std::vector<Header*> _free;                /**< Free slots (capacity reserved up front) */
+    uint32_t _overflow;                        /**< Heap fallbacks */
+};
+
+#endif // CALL_POOL_H
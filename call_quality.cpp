@@ -0,0 +1,170 @@
+#include "call_quality.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <strings.h>
+
+using namespace pj;
+using namespace std;
+
+namespace {
+
+// Equipment impairment (Ie) and packet-loss robustness (Bpl), ITU-T G.113 appendix I
+struct CodecImpairment {
+    const char* name;
+    float ie;
+    float bpl;
+};
+
+const CodecImpairment CODEC_IMPAIRMENTS[] = {
+    {"PCMU", 0.0f, 25.1f},
+    {"PCMA", 0.0f, 25.1f},
+    {"G722", 0.0f, 25.1f},
+    {"opus", 0.0f, 30.0f},
+    {"iLBC", 10.0f, 32.0f},
+    {"speex", 11.0f, 20.0f},
+    {"GSM", 20.0f, 43.0f},
+    {"G729", 11.0f, 19.0f},
+};
+
+// Packetisation plus encoder look-ahead, added to the network and jitter buffer delay
+const float CODEC_DELAY_MS = 25.0f;
+
+uint32_t interval_loss(uint32_t packets, uint32_t lost, uint32_t prev_packets, uint32_t prev_lost, float& pct) {
+    uint32_t sent = (packets - prev_packets) + (lost - prev_lost);
+    pct = sent ? 100.0f * (float)(lost - prev_lost) / (float)sent : 0.0f;
+    return sent;
+}
+
+} // namespace
+
+CallQuality::CallQuality() {
+    _thresholds.min_mos = 3.6f;
+    _thresholds.max_loss_pct = 5.0f;
+    _thresholds.max_jitter_ms = 40;
+    _thresholds.max_rtt_ms = 400;
+}
+
+void CallQuality::set_thresholds(const QualityThresholds& thresholds) {
+    lock_guard<mutex> lock(_mutex);
+    _thresholds = thresholds;
+}
+
+const CallQualityData& CallQuality::sample(int index, int call_handle, const StreamStat& stat,
+                                           const StreamInfo& info, uint64_t now_us, bool& changed) {
+    lock_guard<mutex> lock(_mutex);
+    Block& block = _blocks[index];
+    CallQualityData& data = block.data;
+    if (!block.used || data.call_handle != call_handle) {
+        block = Block();
+        block.used = true;
+        memset(&data, 0, sizeof(data));
+        data.call_handle = call_handle;
+    }
+
+    const RtcpStreamStat& rx = stat.rtcp.rxStat;
+    const RtcpStreamStat& tx = stat.rtcp.txStat;
+    // The first sample may come right after media started: judge silence from the second
+    bool sampled = data.sampled_us != 0;
+    data.sampled_us = now_us;
+    size_t len = min(info.codecName.size(), sizeof(data.codec) - 1);
+    memcpy(data.codec, info.codecName.data(), len);
+    data.codec[len] = '\0';
+    data.clock_rate = info.codecClockRate;
+    data.rtt_us = (uint32_t)max(0, stat.rtcp.rttUsec.last);
+    data.rx_jitter_us = (uint32_t)max(0, rx.jitterUsec.last);
+    data.tx_jitter_us = (uint32_t)max(0, tx.jitterUsec.last);
+    data.rx_packets = rx.pkt;
+    data.rx_lost = rx.loss;
+    data.tx_packets = tx.pkt;
+    data.tx_lost = tx.loss;
+    data.jb_delay_ms = stat.jbuf.avgDelayMsec;
+
+    // Loss over the interval, so an old burst does not mask a healthy call forever
+    bool no_media = false;
+    if (interval_loss(rx.pkt, rx.loss, block.rxPackets, block.rxLost, data.rx_loss_pct) > 0) {
+        block.rxPackets = rx.pkt;
+        block.rxLost = rx.loss;
+    } else if (sampled) {
+        // Neither counter moved: a dead stream, not a clean one
+        data.rx_loss_pct = 100.0f;
+        no_media = true;
+    }
+    if (interval_loss(tx.pkt, tx.loss, block.txPackets, block.txLost, data.tx_loss_pct) > 0) {
+        block.txPackets = tx.pkt;
+        block.txLost = tx.loss;
+    }
+
+    float delay_ms = data.rtt_us / 2000.0f + data.jb_delay_ms + CODEC_DELAY_MS;
+    data.r_factor = r_factor(delay_ms, data.rx_loss_pct, data.codec);
+    data.mos = mos(data.r_factor);
+
+    int alerts = _alerts(data);
+    if (no_media) {
+        alerts |= PJSUA2_QUALITY_NO_MEDIA;
+    }
+    changed = alerts != data.alerts;
+    data.alerts = alerts;
+    return data;
+}
+
+void CallQuality::call_ended(int index) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    lock_guard<mutex> lock(_mutex);
+    _blocks[index].used = false;
+}
+
+int CallQuality::snapshot(CallQualityData* out, int cap) const {
+    if (!out || cap <= 0) return 0;
+    lock_guard<mutex> lock(_mutex);
+    int n = 0;
+    for (int i = 0; i < PJSUA_MAX_CALLS && n < cap; i++) {
+        if (_blocks[i].used) {
+            out[n++] = _blocks[i].data;
+        }
+    }
+    return n;
+}
+
+float CallQuality::r_factor(float delay_ms, float loss_pct, const char* codec) {
+    float ie = 10.0f;
+    float bpl = 20.0f;
+    for (const CodecImpairment& entry : CODEC_IMPAIRMENTS) {
+        if (strncasecmp(codec, entry.name, strlen(entry.name)) == 0) {
+            ie = entry.ie;
+            bpl = entry.bpl;
+            break;
+        }
+    }
+
+    // Delay impairment, piecewise linear approximation of G.107 Id
+    float id = delay_ms < 160.0f ? delay_ms / 40.0f : (delay_ms - 120.0f) / 10.0f;
+    // Effective equipment impairment under random loss
+    float ie_eff = ie + (95.0f - ie) * loss_pct / (loss_pct + bpl);
+    float r = 93.2f - id - ie_eff;
+    return max(0.0f, min(100.0f, r));
+}
+
+float CallQuality::mos(float r) {
+    if (r <= 0.0f) return 1.0f;
+    if (r >= 100.0f) return 4.5f;
+    return 1.0f + 0.035f * r + 7.0e-6f * r * (r - 60.0f) * (100.0f - r);
+}
+
+int CallQuality::_alerts(const CallQualityData& data) const {
+    int alerts = 0;
+    if (_thresholds.min_mos > 0 && data.mos < _thresholds.min_mos) {
+        alerts |= PJSUA2_QUALITY_LOW_MOS;
+    }
+    if (_thresholds.max_loss_pct > 0
+            && (data.rx_loss_pct > _thresholds.max_loss_pct || data.tx_loss_pct > _thresholds.max_loss_pct)) {
+        alerts |= PJSUA2_QUALITY_HIGH_LOSS;
+    }
+    if (_thresholds.max_jitter_ms > 0 && data.rx_jitter_us > _thresholds.max_jitter_ms * 1000) {
+        alerts |= PJSUA2_QUALITY_HIGH_JITTER;
+    }
+    if (_thresholds.max_rtt_ms > 0 && data.rtt_us > _thresholds.max_rtt_ms * 1000) {
+        alerts |= PJSUA2_QUALITY_HIGH_RTT;
+    }
+    return alerts;
+}
@@ -0,0 +1,133 @@
+#ifndef CALL_QUALITY_H
+#define CALL_QUALITY_H
+
+#include <pjsua2.hpp>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * @brief Quality thresholds, as bits of CallQualityData::alerts.
+ */
+typedef enum {
+    PJSUA2_QUALITY_LOW_MOS = 1,      /**< MOS below min_mos */
+    PJSUA2_QUALITY_HIGH_LOSS = 2,    /**< Receive or transmit loss above max_loss_pct */
+    PJSUA2_QUALITY_HIGH_JITTER = 4,  /**< Receive jitter above max_jitter_ms */
+    PJSUA2_QUALITY_HIGH_RTT = 8,     /**< RTCP round trip above max_rtt_ms */
+    PJSUA2_QUALITY_NO_MEDIA = 16     /**< No RTP received over the last interval (not a threshold; loss counts as 100%) */
+} QualityAlert;
+
+/**
+ * @brief Alert thresholds; 0 disables a threshold.
+ */
+typedef struct {
+    float min_mos;          /**< Raise PJSUA2_QUALITY_LOW_MOS below this MOS */
+    float max_loss_pct;     /**< Raise PJSUA2_QUALITY_HIGH_LOSS above this loss over one interval */
+    unsigned max_jitter_ms; /**< Raise PJSUA2_QUALITY_HIGH_JITTER above this jitter */
+    unsigned max_rtt_ms;    /**< Raise PJSUA2_QUALITY_HIGH_RTT above this round trip */
+} QualityThresholds;
+
+/**
+ * @brief Latest RTP/RTCP sample of one call, as exported to Dart.
+ */
+typedef struct {
+    int32_t call_handle;     /**< Registry handle of the call */
+    int32_t alerts;          /**< QualityAlert bits currently raised */
+    uint64_t sampled_us;     /**< Monotonic time of the sample */
+    char codec[32];          /**< Negotiated codec name */
+    uint32_t clock_rate;     /**< Codec clock rate in Hz */
+    uint32_t rtt_us;         /**< Last RTCP round trip, 0 before the first report */
+    uint32_t rx_jitter_us;   /**< Interarrival jitter of received RTP */
+    uint32_t tx_jitter_us;   /**< Jitter reported by the remote party */
+    uint32_t rx_packets;     /**< RTP packets received */
+    uint32_t rx_lost;        /**< RTP packets lost on receive */
+    uint32_t tx_packets;     /**< RTP packets sent */
+    uint32_t tx_lost;        /**< Sent packets the remote party reported lost */
+    float rx_loss_pct;       /**< Receive loss over the last interval */
+    float tx_loss_pct;       /**< Transmit loss over the last interval */
+    uint32_t jb_delay_ms;    /**< Average jitter buffer delay */
+    float r_factor;          /**< E-model transmission rating 0-100 */
+    float mos;               /**< MOS estimated from r_factor (1-4.5) */
+} CallQualityData;
+
+
+/**
+ * @brief Per-call quality blocks computed from RTP/RTCP statistics.
+ *
+ * The event thread feeds one stream sample per call and interval; loss is
+ * computed over the interval from the cumulative counters, and an R-factor
+ * is estimated with the simplified ITU-T G.107 E-model (delay impairment
+ * from RTT/2, jitter buffer and codec delay; equipment impairment from the
+ * codec and the interval loss). An active stream that received nothing
+ * since the previous sample counts as 100% receive loss and raises
+ * PJSUA2_QUALITY_NO_MEDIA. Snapshots can be read from any thread.
+ */
+class CallQuality {
+public:
+    CallQuality();
+
+    /**
+     * @brief Replace the alert thresholds
+     */
+    void set_thresholds(const QualityThresholds& thresholds);
+
+    /**
+     * @brief Record a sample of a call's audio stream
+     *
+     * @param index pjsua call index
+     * @param call_handle Registry handle of the call
+     * @param stat Stream statistics
+     * @param info Stream info (codec)
+     * @param now_us Monotonic time
+     * @param changed Set when the raised alerts differ from the previous sample
+     * @return const CallQualityData& Updated block (event thread only)
+     */
+    const CallQualityData& sample(int index, int call_handle, const pj::StreamStat& stat,
+                                  const pj::StreamInfo& info, uint64_t now_us, bool& changed);
+
+    /**
+     * @brief Forget a disconnected call
+     */
+    void call_ended(int index);
+
+    /**
+     * @brief Copy the blocks of every sampled call
+     *
+     * @return int Number of blocks written
+     */
+    int snapshot(CallQualityData* out, int cap) const;
+
+    /**
+     * @brief E-model R-factor
+     *
+     * @param delay_ms One-way mouth-to-ear delay
+     * @param loss_pct Packet loss
+     * @param codec Codec name (selects Ie and Bpl)
+     */
+    static float r_factor(float delay_ms, float loss_pct, const char* codec);
+
+    /**
+     * @brief MOS from an R-factor (G.107 annex B)
+     */
+    static float mos(float r);
+
+private:
+    struct Block {
+        bool used = false;          /**< Slot holds a sampled call */
+        CallQualityData data;       /**< Exported block */
+        uint32_t rxPackets = 0;     /**< Counters at the previous sample */
+        uint32_t rxLost = 0;
+        uint32_t txPackets = 0;
+        uint32_t txLost = 0;
+    };
+
+    /**
+     * @brief Alert bits raised by a block
+     */
+    int _alerts(const CallQualityData& data) const;
+
+    mutable std::mutex _mutex;             /**< Guards the blocks and thresholds */
+    QualityThresholds _thresholds;         /**< Alert thresholds */
+    Block _blocks[PJSUA_MAX_CALLS];        /**< Indexed by pjsua call index */
+};
+
+#endif // CALL_QUALITY_H
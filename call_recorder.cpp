@@ -0,0 +1,290 @@
+#include "call_recorder.hpp"
+
+#include <cstring>
+
+using namespace pj;
+using namespace std;
+
+PcmRing::PcmRing(size_t samples) : _head(0), _tail(0), _dropped(0) {
+    size_t size = 2;
+    while (size < samples) {
+        size <<= 1;
+    }
+    _buffer.resize(size);
+    _mask = size - 1;
+}
+
+size_t PcmRing::write(const int16_t* samples, size_t count) {
+    size_t head = _head.load(memory_order_relaxed);
+    size_t tail = _tail.load(memory_order_acquire);
+    size_t room = _buffer.size() - (head - tail);
+    size_t n = min(count, room);
+    for (size_t i = 0; i < n; i++) {
+        _buffer[(head + i) & _mask] = samples[i];
+    }
+    _head.store(head + n, memory_order_release);
+    if (n < count) {
+        _dropped.fetch_add(count - n, memory_order_relaxed);
+    }
+    return n;
+}
+
+size_t PcmRing::read(int16_t* out, size_t max) {
+    size_t tail = _tail.load(memory_order_relaxed);
+    size_t head = _head.load(memory_order_acquire);
+    size_t n = min(max, head - tail);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = _buffer[(tail + i) & _mask];
+    }
+    _tail.store(tail + n, memory_order_release);
+    return n;
+}
+
+
+struct CallRecorder::Recording {
+    shared_ptr<PcmRing> ring;            /**< Samples from the media thread */
+    unique_ptr<RecorderPort> port;       /**< Conference port (PJSIP threads only) */
+    FILE* file = nullptr;                /**< Output file (writer thread only once started) */
+    bool compressed = false;             /**< mu-law output */
+    unsigned clockRate = 0;              /**< Sample rate written in the header */
+    uint32_t dataBytes = 0;              /**< Bytes in the data chunk */
+    vector<uint8_t> staging;             /**< Pending bytes for the next write */
+    atomic<bool> closing{false};         /**< Recording stopped, flush and finalise */
+};
+
+// G.711 mu-law encoder (ITU-T G.711, sign-magnitude with bias 0x84)
+static uint8_t linear_to_ulaw(int16_t pcm) {
+    const int BIAS = 0x84;
+    const int CLIP = 32635;
+    int sign = (pcm >> 8) & 0x80;
+    int sample = sign ? -(int)pcm : (int)pcm;
+    if (sample > CLIP) sample = CLIP;
+    sample += BIAS;
+    int exponent = 7;
+    for (int mask = 0x4000; (sample & mask) == 0 && exponent > 0; mask >>= 1) {
+        exponent--;
+    }
+    int mantissa = (sample >> (exponent + 3)) & 0x0f;
+    return (uint8_t)~(sign | (exponent << 4) | mantissa);
+}
+
+static void put_u16(uint8_t* p, uint16_t v) { p[0] = v & 0xff; p[1] = v >> 8; }
+static void put_u32(uint8_t* p, uint32_t v) { put_u16(p, v & 0xffff); put_u16(p + 2, v >> 16); }
+
+// RIFF/WAVE header with a 16-byte fmt chunk (PCM) or 18-byte fmt + fact chunk (mu-law)
+static size_t wav_header(uint8_t* out, unsigned clock_rate, bool compressed, uint32_t data_bytes) {
+    uint16_t bits = compressed ? 8 : 16;
+    uint32_t fmt_size = compressed ? 18 : 16;
+    size_t size = 12 + 8 + fmt_size + (compressed ? 12 : 0) + 8;
+
+    memcpy(out, "RIFF", 4);
+    put_u32(out + 4, (uint32_t)(size - 8 + data_bytes));
+    memcpy(out + 8, "WAVE", 4);
+    memcpy(out + 12, "fmt ", 4);
+    put_u32(out + 16, fmt_size);
+    put_u16(out + 20, compressed ? 7 : 1);           // WAVE_FORMAT_MULAW / WAVE_FORMAT_PCM
+    put_u16(out + 22, 1);                            // mono
+    put_u32(out + 24, clock_rate);
+    put_u32(out + 28, clock_rate * bits / 8);
+    put_u16(out + 32, bits / 8);
+    put_u16(out + 34, bits);
+    size_t pos = 36;
+    if (compressed) {
+        put_u16(out + pos, 0);                       // cbSize
+        pos += 2;
+        memcpy(out + pos, "fact", 4);
+        put_u32(out + pos + 4, 4);
+        put_u32(out + pos + 8, data_bytes);          // one byte per sample
+        pos += 12;
+    }
+    memcpy(out + pos, "data", 4);
+    put_u32(out + pos + 4, data_bytes);
+    return pos + 8;
+}
+
+void CallRecorder::RecorderPort::onFrameReceived(MediaFrame& frame) {
+    // Media clock thread: copy into the ring and return, never block
+    if (frame.type != PJMEDIA_FRAME_TYPE_AUDIO || frame.size < 2) return;
+    m_ring->write(reinterpret_cast<const int16_t*>(frame.buf.data()), frame.size / 2);
+}
+
+
+CallRecorder::CallRecorder() : _running(false), _clockRate(16000), _ptime(20) {
+}
+
+CallRecorder::~CallRecorder() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        for (auto& recording : _byCall) {
+            if (recording) {
+                // stop_all() should have run before libDestroy(); keep the port, only finish the file
+                recording->port.release();
+                recording->closing.store(true, memory_order_release);
+                recording.reset();
+            }
+        }
+        _running = false;
+    }
+    _wakeup.notify_all();
+    if (_writer.joinable()) {
+        _writer.join();
+    }
+}
+
+void CallRecorder::set_format(unsigned clock_rate, unsigned ptime) {
+    lock_guard<mutex> lock(_mutex);
+    _clockRate = clock_rate;
+    _ptime = ptime;
+}
+
+void CallRecorder::start(int index, const string& path, bool compressed) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) {
+        throw Error(PJ_EINVAL, "Recorder Error", "Invalid call index", __FILE__, __LINE__);
+    }
+    lock_guard<mutex> lock(_mutex);
+    if (_byCall[index]) {
+        throw Error(PJ_EEXISTS, "Recorder Error", "Call is already being recorded", __FILE__, __LINE__);
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        throw Error(PJ_ENOTFOUND, "Recorder Error", "Cannot create " + path, __FILE__, __LINE__);
+    }
+    // Staging is our write buffer: no second copy through stdio
+    setvbuf(file, nullptr, _IONBF, 0);
+    uint8_t header[64];
+    size_t header_size = wav_header(header, _clockRate, compressed, 0);
+    fwrite(header, 1, header_size, file);
+
+    auto recording = make_shared<Recording>();
+    recording->ring = make_shared<PcmRing>(_clockRate * RING_SECONDS);
+    recording->file = file;
+    recording->compressed = compressed;
+    recording->clockRate = _clockRate;
+    recording->staging.reserve(WRITE_CHUNK + _clockRate * 2);
+
+    _byCall[index] = recording;
+    _writing.push_back(recording);
+    if (!_running) {
+        if (_writer.joinable()) {
+            _writer.join();
+        }
+        _running = true;
+        _writer = thread(&CallRecorder::_writer_loop, this);
+    }
+}
+
+bool CallRecorder::attach(int index, AudioMedia& call_media, AudioMedia* local_source) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return false;
+    lock_guard<mutex> lock(_mutex);
+    shared_ptr<Recording> recording = _byCall[index];
+    if (!recording) return false;
+
+    if (!recording->port) {
+        MediaFormatAudio format;
+        format.init(PJMEDIA_FORMAT_PCM, _clockRate, 1, _ptime * 1000, 16);
+        recording->port.reset(new RecorderPort(recording->ring));
+        recording->port->createPort("rec" + to_string(index), format);
+    }
+    // The bridge mixes both parties into the port
+    call_media.startTransmit(*recording->port);
+    if (local_source) {
+        local_source->startTransmit(*recording->port);
+    }
+    return true;
+}
+
+void CallRecorder::stop(int index) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    shared_ptr<Recording> recording;
+    {
+        lock_guard<mutex> lock(_mutex);
+        recording = move(_byCall[index]);
+    }
+    if (!recording) return;
+
+    // Destroying the port removes it from the bridge: no more frames after this
+    recording->port.reset();
+    recording->closing.store(true, memory_order_release);
+    _wakeup.notify_all();
+}
+
+bool CallRecorder::is_recording(int index) const {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return false;
+    lock_guard<mutex> lock(_mutex);
+    return _byCall[index] != nullptr;
+}
+
+void CallRecorder::_writer_loop() {
+    vector<shared_ptr<Recording>> batch;
+    unique_lock<mutex> lock(_mutex);
+    while (_running || !_writing.empty()) {
+        // Rings hold seconds of audio: a relaxed polling period keeps writes large
+        _wakeup.wait_for(lock, chrono::milliseconds(200));
+        batch = _writing;
+        lock.unlock();
+
+        vector<Recording*> finished;
+        for (auto& recording : batch) {
+            if (!_drain(*recording)) {
+                finished.push_back(recording.get());
+            }
+        }
+
+        lock.lock();
+        for (Recording* done : finished) {
+            for (auto it = _writing.begin(); it != _writing.end(); ++it) {
+                if (it->get() == done) {
+                    _writing.erase(it);
+                    break;
+                }
+            }
+        }
+        batch.clear();
+    }
+}
+
+bool CallRecorder::_drain(Recording& recording) {
+    bool closing = recording.closing.load(memory_order_acquire);
+    int16_t samples[1024];
+    size_t n;
+    while ((n = recording.ring->read(samples, sizeof(samples) / sizeof(samples[0]))) > 0) {
+        if (recording.compressed) {
+            for (size_t i = 0; i < n; i++) {
+                recording.staging.push_back(linear_to_ulaw(samples[i]));
+            }
+        } else {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(samples);
+            recording.staging.insert(recording.staging.end(), bytes, bytes + n * 2);
+        }
+    }
+
+    if (recording.staging.size() >= WRITE_CHUNK || closing) {
+        if (!recording.staging.empty()) {
+            fwrite(recording.staging.data(), 1, recording.staging.size(), recording.file);
+            recording.dataBytes += (uint32_t)recording.staging.size();
+            recording.staging.clear();
+        }
+    }
+    if (closing) {
+        _finalize(recording);
+        return false;
+    }
+    return true;
+}
+
+void CallRecorder::_finalize(Recording& recording) {
+    if (!recording.file) return;
+    uint8_t header[64];
+    size_t header_size = wav_header(header, recording.clockRate, recording.compressed, recording.dataBytes);
+    fseek(recording.file, 0, SEEK_SET);
+    fwrite(header, 1, header_size, recording.file);
+    fclose(recording.file);
+    recording.file = nullptr;
+}
+
+void CallRecorder::stop_all() {
+    for (int i = 0; i < PJSUA_MAX_CALLS; i++) {
+        stop(i);
+    }
+}
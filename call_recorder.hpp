@@ -0,0 +1,162 @@
+#ifndef CALL_RECORDER_H
+#define CALL_RECORDER_H
+
+#include <pjsua2.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Single-producer/single-consumer ring of 16-bit PCM samples.
+ *
+ * Preallocated once; the producer drops samples that do not fit instead of
+ * waiting for the consumer.
+ */
+class PcmRing {
+public:
+    /**
+     * @brief Construct a new PcmRing
+     *
+     * @param samples Capacity in samples, rounded up to a power of two
+     */
+    explicit PcmRing(size_t samples);
+
+    /**
+     * @brief Append samples (producer only)
+     *
+     * @return size_t Samples stored; the rest were dropped
+     */
+    size_t write(const int16_t* samples, size_t count);
+
+    /**
+     * @brief Take up to max samples (consumer only)
+     *
+     * @return size_t Samples copied
+     */
+    size_t read(int16_t* out, size_t max);
+
+    /**
+     * @brief Samples dropped because the ring was full
+     */
+    uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<int16_t> _buffer;         /**< Sample storage */
+    size_t _mask;                         /**< Capacity - 1 */
+    alignas(64) std::atomic<size_t> _head; /**< Next write position */
+    alignas(64) std::atomic<size_t> _tail; /**< Next read position */
+    std::atomic<uint64_t> _dropped;       /**< Dropped sample counter */
+};
+
+
+/**
+ * @brief Records calls to WAV files without touching the disk from the media clock.
+ *
+ * Each recording owns a conference port that copies received frames into a
+ * preallocated PcmRing. One background writer thread drains every ring and
+ * writes the file in large sequential chunks, either as 16-bit PCM or, when
+ * compression is requested, as 8-bit G.711 mu-law (half the size). Indices
+ * are pjsua call indices; every method except the writer runs on PJSIP
+ * registered threads.
+ */
+class CallRecorder {
+public:
+    CallRecorder();
+
+    /**
+     * @brief Stop the writer thread, finalising every open file
+     */
+    ~CallRecorder();
+
+    /**
+     * @brief Audio format of the recording ports
+     *
+     * @param clock_rate Conference bridge clock rate in Hz
+     * @param ptime Frame duration in ms
+     */
+    void set_format(unsigned clock_rate, unsigned ptime);
+
+    /**
+     * @brief Open the output file for a call
+     *
+     * @param index pjsua call index
+     * @param path Output WAV path
+     * @param compressed Write G.711 mu-law instead of 16-bit PCM
+     * @throw pj::Error if the file cannot be created or a recording is already running
+     */
+    void start(int index, const std::string& path, bool compressed);
+
+    /**
+     * @brief Connect the recording port of a call (after each media update)
+     *
+     * @param index pjsua call index
+     * @param call_media Audio media of the call (remote party)
+     * @param local_source Audio sent to the call (local party), may be null
+     * @return true if the call is being recorded
+     */
+    bool attach(int index, pj::AudioMedia& call_media, pj::AudioMedia* local_source);
+
+    /**
+     * @brief Stop recording a call; the writer flushes and closes the file
+     */
+    void stop(int index);
+
+    /**
+     * @brief Stop every recording (before libDestroy)
+     */
+    void stop_all();
+
+    /**
+     * @brief Whether a call is being recorded
+     */
+    bool is_recording(int index) const;
+
+private:
+    struct Recording;
+
+    /**
+     * @brief Conference port feeding a recording's ring
+     */
+    class RecorderPort : public pj::AudioMediaPort {
+    public:
+        explicit RecorderPort(std::shared_ptr<PcmRing> ring) : m_ring(std::move(ring)) {}
+        virtual void onFrameReceived(pj::MediaFrame& frame) override;
+    private:
+        std::shared_ptr<PcmRing> m_ring; /**< Destination ring */
+    };
+
+    /**
+     * @brief Writer thread body
+     */
+    void _writer_loop();
+
+    /**
+     * @brief Drain a recording's ring to disk; returns false once it is finished
+     */
+    bool _drain(Recording& recording);
+
+    /**
+     * @brief Patch the RIFF sizes and close the file
+     */
+    static void _finalize(Recording& recording);
+
+    static const size_t WRITE_CHUNK = 64 * 1024;    /**< Bytes staged before each write */
+    static const unsigned RING_SECONDS = 4;         /**< Ring capacity in seconds of audio */
+
+    mutable std::mutex _mutex;                      /**< Guards the recording tables */
+    std::condition_variable _wakeup;                /**< Wakes the writer on stop/shutdown */
+    std::shared_ptr<Recording> _byCall[PJSUA_MAX_CALLS]; /**< Recording of each call */
+    std::vector<std::shared_ptr<Recording>> _writing; /**< Recordings the writer still serves */
+    std::thread _writer;                            /**< Background writer */
+    bool _running;                                  /**< Writer thread should keep going */
+    unsigned _clockRate;                            /**< Port clock rate in Hz */
+    unsigned _ptime;                                /**< Port frame duration in ms */
+};
+
+#endif // CALL_RECORDER_H
@@ -0,0 +1,191 @@
+#include "call_registry.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace pj;
+using namespace std;
+
+static_assert(CallRegistry::CAPACITY <= (1 << CallRegistry::INDEX_BITS), "PJSUA_MAX_CALLS exceeds the handle index range");
+
+static inline void copy_field(char* dst, size_t size, const string& src) {
+    size_t len = min(src.size(), size - 1);
+    memcpy(dst, src.data(), len);
+    dst[len] = '\0';
+}
+
+static inline int encode_handle(uint32_t generation, int index) {
+    // Keep handles positive: 19 bits of generation above the index bits
+    return (int)(((generation & 0x7ffff) << CallRegistry::INDEX_BITS) | (uint32_t)index);
+}
+
+CallRegistry::CallRegistry() {
+    for (int i = 0; i < CAPACITY; i++) {
+        _slots[i].generation.store(0, memory_order_relaxed);
+        _slots[i].direction.store(CALL_DIR_NONE, memory_order_relaxed);
+        _slots[i].state.store(CALL_SLOT_FREE, memory_order_relaxed);
+        _slots[i].account.store(-1, memory_order_relaxed);
+        memset(&_slots[i].data, 0, sizeof(_slots[i].data));
+    }
+}
+
+int CallRegistry::index_of(int handle) {
+    if (handle < 0) return -1;
+    int index = handle & ((1 << INDEX_BITS) - 1);
+    return index < CAPACITY ? index : -1;
+}
+
+const CallRegistry::Slot* CallRegistry::_slot(int handle) const {
+    int index = index_of(handle);
+    if (index < 0) return nullptr;
+    const Slot& slot = _slots[index];
+    if (encode_handle(slot.generation.load(memory_order_acquire), index) != handle) {
+        return nullptr;
+    }
+    return &slot;
+}
+
+int CallRegistry::insert(unique_ptr<Call> call, CallDirection direction, const CallInfo& info, int acc_handle) {
+    if (!call) return INVALID_HANDLE;
+    int index = call->getId();
+    return insert(index, move(call), direction, info, acc_handle);
+}
+
+int CallRegistry::insert(int index, unique_ptr<Call> call, CallDirection direction, const CallInfo& info, int acc_handle) {
+    if (index < 0 || index >= CAPACITY) return INVALID_HANDLE;
+
+    shared_ptr<Call> previous; // deleted once the lock is dropped
+    lock_guard<recursive_mutex> lock(_mutex);
+    Slot& slot = _slots[index];
+    previous = move(slot.call);
+    slot.call = move(call);
+    int handle = encode_handle(slot.generation.load(memory_order_relaxed), index);
+
+    CallData& data = slot.data;
+    copy_field(data.call_id, sizeof(data.call_id), info.callIdString);
+    copy_field(data.remote_uri, sizeof(data.remote_uri), info.remoteUri);
+    copy_field(data.local_uri, sizeof(data.local_uri), info.localUri);
+    copy_field(data.actual_state, sizeof(data.actual_state), info.stateText);
+    data.call_handle = handle;
+    data.state = info.state;
+    data.direction = direction;
+    data.acc_handle = acc_handle;
+
+    slot.direction.store(direction, memory_order_relaxed);
+    slot.account.store(acc_handle, memory_order_relaxed);
+    slot.state.store(CALL_SLOT_PENDING, memory_order_release);
+    return handle;
+}
+
+void CallRegistry::update(int index, const CallInfo& info) {
+    if (index < 0 || index >= CAPACITY) return;
+
+    lock_guard<recursive_mutex> lock(_mutex);
+    Slot& slot = _slots[index];
+    if (slot.state.load(memory_order_relaxed) == CALL_SLOT_FREE) return;
+    slot.data.state = info.state;
+    copy_field(slot.data.actual_state, sizeof(slot.data.actual_state), info.stateText);
+}
+
+bool CallRegistry::read(int handle, CallData& out) const {
+    lock_guard<recursive_mutex> lock(_mutex);
+    const Slot* slot = _slot(handle);
+    if (!slot || slot->state.load(memory_order_relaxed) == CALL_SLOT_FREE) return false;
+    out = slot->data;
+    return true;
+}
+
+int CallRegistry::snapshot(CallData* out, int cap) const {
+    if (!out || cap <= 0) return 0;
+
+    lock_guard<recursive_mutex> lock(_mutex);
+    int n = 0;
+    for (int i = 0; i < CAPACITY && n < cap; i++) {
+        if (_slots[i].state.load(memory_order_relaxed) != CALL_SLOT_FREE) {
+            out[n++] = _slots[i].data;
+        }
+    }
+    return n;
+}
+
+shared_ptr<Call> CallRegistry::release(int index) {
+    if (index < 0 || index >= CAPACITY) return nullptr;
+
+    lock_guard<recursive_mutex> lock(_mutex);
+    Slot& slot = _slots[index];
+    shared_ptr<Call> call = move(slot.call);
+    memset(&slot.data, 0, sizeof(slot.data));
+    slot.direction.store(CALL_DIR_NONE, memory_order_relaxed);
+    slot.account.store(-1, memory_order_relaxed);
+    slot.state.store(CALL_SLOT_FREE, memory_order_relaxed);
+    slot.generation.fetch_add(1, memory_order_release);
+    return call;
+}
+
+Call* CallRegistry::get(int handle) const {
+    const Slot* slot = _slot(handle);
+    return slot ? slot->call.get() : nullptr;
+}
+
+shared_ptr<Call> CallRegistry::pin(int handle) const {
+    lock_guard<recursive_mutex> lock(_mutex);
+    const Slot* slot = _slot(handle);
+    return slot ? slot->call : nullptr;
+}
+
+int CallRegistry::find(const string& call_id) const {
+    if (call_id.empty()) return INVALID_HANDLE;
+
+    lock_guard<recursive_mutex> lock(_mutex);
+    for (int i = 0; i < CAPACITY; i++) {
+        if (_slots[i].state.load(memory_order_relaxed) != CALL_SLOT_FREE && call_id == _slots[i].data.call_id) {
+            return encode_handle(_slots[i].generation.load(memory_order_relaxed), i);
+        }
+    }
+    return INVALID_HANDLE;
+}
+
+int CallRegistry::handle_of(int index) const {
+    if (index < 0 || index >= CAPACITY) return INVALID_HANDLE;
+    return encode_handle(_slots[index].generation.load(memory_order_acquire), index);
+}
+
+void CallRegistry::set_state(int index, CallSlotState state) {
+    if (index < 0 || index >= CAPACITY) return;
+    if (_slots[index].state.load(memory_order_relaxed) == CALL_SLOT_FREE) return;
+    _slots[index].state.store(state, memory_order_release);
+}
+
+CallSlotState CallRegistry::state(int handle) const {
+    const Slot* slot = _slot(handle);
+    return slot ? (CallSlotState)slot->state.load(memory_order_acquire) : CALL_SLOT_FREE;
+}
+
+CallDirection CallRegistry::direction(int handle) const {
+    const Slot* slot = _slot(handle);
+    return slot ? (CallDirection)slot->direction.load(memory_order_acquire) : CALL_DIR_NONE;
+}
+
+int CallRegistry::account(int handle) const {
+    const Slot* slot = _slot(handle);
+    return slot ? slot->account.load(memory_order_acquire) : -1;
+}
+
+int CallRegistry::collect(int* out, int cap, int acc_handle) const {
+    if (!out || cap <= 0) return 0;
+
+    lock_guard<recursive_mutex> lock(_mutex);
+    int n = 0;
+    for (int i = 0; i < CAPACITY && n < cap; i++) {
+        if (_slots[i].state.load(memory_order_relaxed) == CALL_SLOT_FREE) continue;
+        if (acc_handle >= 0 && _slots[i].account.load(memory_order_relaxed) != acc_handle) continue;
+        out[n++] = encode_handle(_slots[i].generation.load(memory_order_relaxed), i);
+    }
+    return n;
+}
+
+void CallRegistry::clear() {
+    for (int i = 0; i < CAPACITY; i++) {
+        shared_ptr<Call> call = release(i);
+    }
+}
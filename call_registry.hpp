@@ -0,0 +1,238 @@
+#ifndef CALL_REGISTRY_H
+#define CALL_REGISTRY_H
+
+#include <pjsua2.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Structure containing call information data.
+ * 
+ * This structure holds details about a SIP call including call identifiers,
+ * remote/local URIs, and current call state.
+ */
+typedef struct {
+    char call_id[128];       /**< Unique call identifier (null-terminated string) */
+    char remote_uri[128];    /**< Remote party URI (null-terminated string) */
+    char local_uri[128];     /**< Local party URI (null-terminated string) */
+    char actual_state[64];   /**< Current call state description (null-terminated string) */
+    int call_handle;         /**< Registry handle of the call */
+    int state;               /**< pjsip_inv_state */
+    int direction;           /**< CallDirection */
+    int acc_handle;          /**< Handle of the owning account */
+} CallData;
+
+/**
+ * @brief Direction of a call held in the registry.
+ */
+typedef enum {
+    CALL_DIR_NONE = 0,      /**< Slot unused */
+    CALL_DIR_INBOUND = 1,   /**< Call received through onIncomingCall */
+    CALL_DIR_OUTBOUND = 2   /**< Call placed through make_call */
+} CallDirection;
+
+/**
+ * @brief Lifecycle state of a registry slot.
+ */
+typedef enum {
+    CALL_SLOT_FREE = 0,     /**< No call in this slot */
+    CALL_SLOT_PENDING = 1,  /**< Ringing (inbound) or calling (outbound) */
+    CALL_SLOT_ACTIVE = 2    /**< Connecting, confirmed or being torn down */
+} CallSlotState;
+
+
+/**
+ * @brief Fixed-capacity call table indexed by the pjsua call index.
+ *
+ * Each slot carries a direction, a state and a generation counter. Calls are
+ * exposed as small integer handles combining the slot index with its
+ * generation, so a stale handle never resolves to a newer call reusing the
+ * same pjsua index. A single mutex guards ownership of the Call objects and
+ * the cached CallData; direction, state and generation can be read without it.
+ *
+ * Never call into PJSIP while holding mutex(): PJSIP callbacks take it with
+ * PJSUA_LOCK and the dialog lock already held, so the reverse order
+ * deadlocks. Commands pin() their call and run PJSIP without the lock.
+ */
+class CallRegistry {
+public:
+    static const int INDEX_BITS = 12;                       /**< Bits of a handle holding the slot index */
+    static const int CAPACITY = PJSUA_MAX_CALLS;            /**< Number of slots */
+    static const int INVALID_HANDLE = -1;                   /**< Returned when no call matches */
+
+    CallRegistry();
+
+    /**
+     * @brief Take ownership of a call placed in its pjsua slot
+     *
+     * @param call Call object, getId() must be a valid pjsua call index
+     * @param direction Inbound or outbound
+     * @param info Current call info, seeds the cached CallData
+     * @param acc_handle Handle of the account owning the call
+     * @return int Handle of the call, INVALID_HANDLE if the index is out of range
+     */
+    int insert(std::unique_ptr<pj::Call> call, CallDirection direction, const pj::CallInfo& info, int acc_handle);
+
+    /**
+     * @brief Occupy a pjsua slot, with or without a call object
+     *
+     * Trace replay fills slots without a pj::Call: get() then returns
+     * nullptr while the cached data, handle and state behave as usual.
+     *
+     * @param index pjsua call index
+     * @param call Call object (may be null)
+     * @param direction Inbound or outbound
+     * @param info Current call info, seeds the cached CallData
+     * @param acc_handle Handle of the account owning the call
+     * @return int Handle of the call, INVALID_HANDLE if the index is out of range
+     */
+    int insert(int index, std::unique_ptr<pj::Call> call, CallDirection direction, const pj::CallInfo& info, int acc_handle);
+
+    /**
+     * @brief Refresh the cached state of the call at a pjsua index
+     *
+     * Only the state fields change after insert(); identifiers and URIs are
+     * copied once. Ignored if the slot is not occupied yet.
+     *
+     * @param index pjsua call index
+     * @param info Call info received in onCallState
+     */
+    void update(int index, const pj::CallInfo& info);
+
+    /**
+     * @brief Copy the cached CallData of one call
+     *
+     * @param handle Call handle
+     * @param out Destination
+     * @return true if the handle addressed a live call
+     */
+    bool read(int handle, CallData& out) const;
+
+    /**
+     * @brief Copy the cached CallData of every live call
+     *
+     * @param out Destination array
+     * @param cap Capacity of the destination array
+     * @return int Number of records written
+     */
+    int snapshot(CallData* out, int cap) const;
+
+    /**
+     * @brief Release the call stored at a pjsua index and bump the slot generation
+     *
+     * @param index pjsua call index
+     * @return std::shared_ptr<pj::Call> The released call (may be null), deleted
+     * by whoever drops the last reference
+     */
+    std::shared_ptr<pj::Call> release(int index);
+
+    /**
+     * @brief Resolve a handle to its call
+     *
+     * The caller must hold mutex() for as long as it uses the returned pointer
+     * and may only compare it: use pin() to call into PJSIP.
+     *
+     * @param handle Call handle
+     * @return pj::Call* The call, nullptr if the handle is stale or invalid
+     */
+    pj::Call* get(int handle) const;
+
+    /**
+     * @brief Keep the call of a handle alive without holding mutex()
+     *
+     * If the slot is released meanwhile, the call is deleted when the last
+     * pin is dropped. pjsua hands out call indexes round robin, so the index
+     * of a released call is not reused while a command is still using it.
+     *
+     * @param handle Call handle
+     * @return std::shared_ptr<pj::Call> The call, empty if the handle is stale or invalid
+     */
+    std::shared_ptr<pj::Call> pin(int handle) const;
+
+    /**
+     * @brief Find the handle of a call by SIP Call-ID
+     *
+     * @param call_id SIP Call-ID
+     * @return int Handle, INVALID_HANDLE if not found
+     */
+    int find(const std::string& call_id) const;
+
+    /**
+     * @brief Handle currently associated with a pjsua index
+     *
+     * Valid even before insert() so events raised while a call is being set up
+     * carry the handle the call will be stored under.
+     *
+     * @param index pjsua call index
+     * @return int Handle, INVALID_HANDLE if the index is out of range
+     */
+    int handle_of(int index) const;
+
+    /**
+     * @brief Update the state of the slot at a pjsua index
+     */
+    void set_state(int index, CallSlotState state);
+
+    /**
+     * @brief State of the slot addressed by a handle (CALL_SLOT_FREE if stale)
+     */
+    CallSlotState state(int handle) const;
+
+    /**
+     * @brief Direction of the slot addressed by a handle (CALL_DIR_NONE if stale)
+     */
+    CallDirection direction(int handle) const;
+
+    /**
+     * @brief Account owning the slot addressed by a handle (-1 if stale)
+     */
+    int account(int handle) const;
+
+    /**
+     * @brief Collect the handles of occupied slots
+     *
+     * @param out Destination array
+     * @param cap Capacity of the destination array
+     * @param acc_handle Only return calls of this account, -1 for all
+     * @return int Number of handles written
+     */
+    int collect(int* out, int cap, int acc_handle = -1) const;
+
+    /**
+     * @brief Release every call
+     */
+    void clear();
+
+    /**
+     * @brief Mutex guarding the Call objects (never held across PJSIP calls)
+     */
+    std::recursive_mutex& mutex() const { return _mutex; }
+
+    /**
+     * @brief Extract the slot index from a handle (-1 if invalid)
+     */
+    static int index_of(int handle);
+
+private:
+    struct Slot {
+        std::shared_ptr<pj::Call> call;       /**< Owned call object, shared with pin() */
+        std::atomic<uint32_t> generation;     /**< Incremented each time the slot is freed */
+        std::atomic<int> direction;           /**< CallDirection */
+        std::atomic<int> state;               /**< CallSlotState */
+        std::atomic<int> account;             /**< Owning account handle, -1 when free */
+        CallData data;                        /**< Cached call information */
+    };
+
+    /**
+     * @brief Slot addressed by a handle, nullptr if out of range or stale
+     */
+    const Slot* _slot(int handle) const;
+
+    Slot _slots[CAPACITY];                    /**< Call table */
+    mutable std::recursive_mutex _mutex;      /**< Guards call ownership and data */
+};
+
+#endif // CALL_REGISTRY_H
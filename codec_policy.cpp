@@ -0,0 +1,187 @@
+#include "codec_policy.hpp"
+
+#include <strings.h>
+
+using namespace pj;
+using namespace std;
+
+CodecPolicy::CodecPolicy() : _maxOpusCalls(-1), _opusCalls(0), _budgetChanged(false) {
+    _default = {"opus/48000/2", "PCMU/8000/1", "PCMA/8000/1"};
+    _accounts.reserve(PJSUA_MAX_ACC);
+}
+
+void CodecPolicy::set_default(const CodecList& codecs) {
+    lock_guard<mutex> lock(_mutex);
+    _default = codecs;
+}
+
+void CodecPolicy::set_account(int acc_handle, const CodecList& codecs) {
+    lock_guard<mutex> lock(_mutex);
+    if (codecs.empty()) {
+        _accounts.erase(acc_handle);
+    } else {
+        _accounts[acc_handle] = codecs;
+    }
+}
+
+void CodecPolicy::remove_account(int acc_handle) {
+    lock_guard<mutex> lock(_mutex);
+    _accounts.erase(acc_handle);
+}
+
+void CodecPolicy::set_call(int index, const CodecList& codecs) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    lock_guard<mutex> lock(_mutex);
+    _calls[index].override = codecs;
+    _calls[index].reofferPending = false;
+    _calls[index].reoffered = false;
+}
+
+void CodecPolicy::set_cpu_budget(int max_opus_calls) {
+    lock_guard<mutex> lock(_mutex);
+    bool was_over = _over_budget();
+    _maxOpusCalls = max_opus_calls;
+    _update_budget(was_over);
+}
+
+CodecList CodecPolicy::order_for(int index, int acc_handle, const CodecList& override) const {
+    lock_guard<mutex> lock(_mutex);
+    const CodecList* codecs = &_default;
+    if (!override.empty()) {
+        codecs = &override;
+    } else if (index >= 0 && index < PJSUA_MAX_CALLS && !_calls[index].override.empty()) {
+        codecs = &_calls[index].override;
+    } else {
+        auto it = _accounts.find(acc_handle);
+        if (it != _accounts.end()) {
+            codecs = &it->second;
+        }
+    }
+    return _budgeted(*codecs);
+}
+
+CodecList CodecPolicy::_budgeted(const CodecList& codecs) const {
+    if (!_over_budget()) {
+        return codecs;
+    }
+
+    CodecList order;
+    for (const string& codec : codecs) {
+        if (!_is_opus(codec)) {
+            order.push_back(codec);
+        }
+    }
+    if (order.empty()) {
+        order = {"PCMU/8000/1", "PCMA/8000/1"};
+    }
+    return order;
+}
+
+void CodecPolicy::apply(Endpoint& endpoint, const CodecList& codecs) {
+    if (codecs == _applied && !_allCodecs.empty()) return;
+
+    if (_allCodecs.empty()) {
+        for (const CodecInfo& info : endpoint.codecEnum2()) {
+            _allCodecs.push_back(info.codecId);
+        }
+    }
+    // Enable the new list before disabling the rest: the table is never empty
+    int priority = PJMEDIA_CODEC_PRIO_HIGHEST;
+    for (const string& entry : codecs) {
+        endpoint.codecSetPriority(entry, priority);
+        if (priority > PJMEDIA_CODEC_PRIO_LOWEST + 1) {
+            priority--;
+        }
+    }
+    for (const string& codec_id : _allCodecs) {
+        bool listed = false;
+        for (const string& entry : codecs) {
+            if (_matches(codec_id, entry)) {
+                listed = true;
+                break;
+            }
+        }
+        if (!listed) {
+            endpoint.codecSetPriority(codec_id, PJMEDIA_CODEC_PRIO_DISABLED);
+        }
+    }
+    _applied = codecs;
+}
+
+void CodecPolicy::media_codec(int index, const string& codec_name) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    lock_guard<mutex> lock(_mutex);
+    CallCodec& call = _calls[index];
+
+    bool opus = _is_opus(codec_name);
+    if (opus != call.opus) {
+        bool was_over = _over_budget();
+        call.opus = opus;
+        _opusCalls.fetch_add(opus ? 1 : -1, memory_order_relaxed);
+        _update_budget(was_over);
+    }
+
+    if (call.override.empty() || call.reoffered) return;
+    // Re-offer once when the preferred codec was not the one negotiated
+    CodecList order = _budgeted(call.override);
+    if (!_matches(codec_name, order.front())) {
+        call.reoffered = true;
+        call.reofferPending = true;
+    }
+}
+
+bool CodecPolicy::take_reoffer(int index) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return false;
+    lock_guard<mutex> lock(_mutex);
+    bool pending = _calls[index].reofferPending;
+    _calls[index].reofferPending = false;
+    return pending;
+}
+
+void CodecPolicy::call_ended(int index) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    lock_guard<mutex> lock(_mutex);
+    CallCodec& call = _calls[index];
+    if (call.opus) {
+        bool was_over = _over_budget();
+        call.opus = false;
+        _opusCalls.fetch_sub(1, memory_order_relaxed);
+        _update_budget(was_over);
+    }
+    call.override.clear();
+    call.reofferPending = false;
+    call.reoffered = false;
+}
+
+void CodecPolicy::apply_opus(Endpoint& endpoint, const OpusSettings& settings) {
+    CodecOpusConfig config = endpoint.getCodecOpusConfig();
+    if (settings.sample_rate) config.sample_rate = settings.sample_rate;
+    if (settings.channels) config.channel_cnt = settings.channels;
+    if (settings.bitrate) config.bit_rate = settings.bitrate;
+    if (settings.complexity) config.complexity = settings.complexity;
+    if (settings.cbr >= 0) config.cbr = settings.cbr != 0;
+    endpoint.setCodecOpusConfig(config);
+}
+
+bool CodecPolicy::_is_opus(const string& codec) {
+    return strncasecmp(codec.c_str(), "opus", 4) == 0;
+}
+
+bool CodecPolicy::_matches(const string& codec_id, const string& entry) {
+    // Compare up to the shorter of the two, so "opus" matches "opus/48000/2" both ways
+    size_t n = min(codec_id.size(), entry.size());
+    if (n == 0) return false;
+    if (strncasecmp(codec_id.c_str(), entry.c_str(), n) != 0) return false;
+    const string& longer = codec_id.size() > entry.size() ? codec_id : entry;
+    return longer.size() == n || longer[n] == '/';
+}
+
+void CodecPolicy::_update_budget(bool was_over) {
+    if (_over_budget() != was_over) {
+        _budgetChanged.store(true, memory_order_release);
+    }
+}
+
+bool CodecPolicy::_over_budget() const {
+    return _maxOpusCalls >= 0 && _opusCalls.load(memory_order_relaxed) >= _maxOpusCalls;
+}
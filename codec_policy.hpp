@@ -0,0 +1,182 @@
+#ifndef CODEC_POLICY_H
+#define CODEC_POLICY_H
+
+#include <pjsua2.hpp>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Codec ids (or id prefixes such as "opus") in preference order.
+ */
+typedef std::vector<std::string> CodecList;
+
+/**
+ * @brief Opus encoder settings; 0 keeps the current value.
+ */
+typedef struct {
+    unsigned sample_rate;  /**< Internal sample rate in Hz (8000-48000) */
+    unsigned channels;     /**< 1 (mono) or 2 (stereo) */
+    unsigned bitrate;      /**< Target bitrate in bps */
+    unsigned complexity;   /**< Encoder complexity 1-10 (lower is cheaper) */
+    int cbr;               /**< 1 constant bitrate, 0 variable, -1 keep */
+} OpusSettings;
+
+
+/**
+ * @brief Decides which codecs each call offers and in which order.
+ *
+ * PJSIP keeps a single global codec priority table that is read when an SDP
+ * offer or answer is built. The policy computes the list in effect for a
+ * call (call override, else account list, else default) and programs the
+ * table with it: strictly decreasing priorities for listed codecs, every
+ * other codec disabled. The table is only rewritten when the list changes.
+ *
+ * In CPU budget mode, once the number of concurrent Opus calls reaches the
+ * limit, Opus is removed from every list (G.711 is used when nothing else
+ * is left) until an Opus call ends.
+ */
+class CodecPolicy {
+public:
+    CodecPolicy();
+
+    /**
+     * @brief List used when neither the call nor its account has one
+     */
+    void set_default(const CodecList& codecs);
+
+    /**
+     * @brief List of an account; empty to inherit the default
+     */
+    void set_account(int acc_handle, const CodecList& codecs);
+
+    /**
+     * @brief Forget the list of a removed account
+     */
+    void remove_account(int acc_handle);
+
+    /**
+     * @brief Override the list of one call
+     */
+    void set_call(int index, const CodecList& codecs);
+
+    /**
+     * @brief Limit concurrent Opus calls; -1 disables the budget
+     */
+    void set_cpu_budget(int max_opus_calls);
+
+    /**
+     * @brief List in effect for a call, after the CPU budget
+     *
+     * @param index pjsua call index, -1 for a new call
+     * @param acc_handle Account of the call, -1 for the default
+     * @param override List requested for this call, empty for none
+     */
+    CodecList order_for(int index, int acc_handle, const CodecList& override = CodecList()) const;
+
+    /**
+     * @brief Program the endpoint codec table (table_mutex() held)
+     *
+     * @throw pj::Error on failure
+     */
+    void apply(pj::Endpoint& endpoint, const CodecList& codecs);
+
+    /**
+     * @brief Serialises table updates with the SDP they are meant for
+     *
+     * Hold it from apply() until makeCall()/reinvite() returns. Never taken
+     * from PJSIP callbacks, and never held with the call registry lock since
+     * those calls take PJSUA_LOCK.
+     */
+    std::mutex& table_mutex() { return _tableMutex; }
+
+    /**
+     * @brief Record the codec a call negotiated
+     *
+     * @param index pjsua call index
+     * A call with its own list that negotiated something other than its
+     * first choice (the answer was built before the list was known) is
+     * marked for a single re-offer.
+     *
+     * @param index pjsua call index
+     * @param codec_name Negotiated encoding name (e.g. "opus", "PCMU")
+     */
+    void media_codec(int index, const std::string& codec_name);
+
+    /**
+     * @brief Take the re-offer mark of a call
+     *
+     * @return true if the call should be re-INVITEd with its own list
+     */
+    bool take_reoffer(int index);
+
+    /**
+     * @brief Release the per-call state of a disconnected call
+     */
+    void call_ended(int index);
+
+    /**
+     * @brief Whether the CPU budget state changed since the last call
+     */
+    bool take_budget_change() { return _budgetChanged.exchange(false, std::memory_order_acq_rel); }
+
+    /**
+     * @brief Number of calls currently using Opus
+     */
+    int opus_calls() const { return _opusCalls.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Update the Opus encoder configuration
+     *
+     * @throw pj::Error if Opus is not available
+     */
+    static void apply_opus(pj::Endpoint& endpoint, const OpusSettings& settings);
+
+private:
+    struct CallCodec {
+        CodecList override;          /**< Per-call list (empty: none) */
+        bool opus = false;           /**< Call counted in _opusCalls */
+        bool reofferPending = false; /**< Re-offer wanted, not yet taken */
+        bool reoffered = false;      /**< Re-offer already requested */
+    };
+
+    /**
+     * @brief Whether a codec id or encoding name refers to Opus
+     */
+    static bool _is_opus(const std::string& codec);
+
+    /**
+     * @brief Whether a codec id matches a list entry (case-insensitive prefix)
+     */
+    static bool _matches(const std::string& codec_id, const std::string& entry);
+
+    /**
+     * @brief Drop Opus from a list when over budget (lock held)
+     */
+    CodecList _budgeted(const CodecList& codecs) const;
+
+    /**
+     * @brief Raise the budget flag if the budget state flipped (lock held)
+     */
+    void _update_budget(bool was_over);
+
+    /**
+     * @brief Budget reached (lock held)
+     */
+    bool _over_budget() const;
+
+    mutable std::mutex _mutex;                      /**< Guards the lists */
+    std::mutex _tableMutex;                         /**< See table_mutex() */
+    CodecList _default;                             /**< Default list */
+    std::unordered_map<int, CodecList> _accounts;   /**< Account lists */
+    CallCodec _calls[PJSUA_MAX_CALLS];              /**< Indexed by pjsua call index */
+    int _maxOpusCalls;                              /**< Budget, -1 unlimited */
+    std::atomic<int> _opusCalls;                    /**< Concurrent Opus calls */
+    std::atomic<bool> _budgetChanged;               /**< Table must be reprogrammed */
+    CodecList _applied;                             /**< List in the table (table mutex) */
+    std::vector<std::string> _allCodecs;            /**< Codec ids, enumerated once */
+};
+
+#endif // CODEC_POLICY_H
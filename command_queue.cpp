@@ -0,0 +1,42 @@
+#include "command_queue.hpp"
+
+using namespace std;
+
+CommandQueue::CommandQueue() : _nextRequestId(1) {
+    _pending.reserve(64);
+}
+
+int CommandQueue::push(Command command) {
+    int request_id = _nextRequestId.fetch_add(1, memory_order_relaxed);
+    command.request_id = request_id;
+    lock_guard<mutex> lock(_mutex);
+    _pending.push_back(move(command));
+    return request_id;
+}
+
+void CommandQueue::push_batch(vector<Command>& commands, int* out_request_ids) {
+    for (size_t i = 0; i < commands.size(); i++) {
+        commands[i].request_id = _nextRequestId.fetch_add(1, memory_order_relaxed);
+        if (out_request_ids) {
+            out_request_ids[i] = commands[i].request_id;
+        }
+    }
+    lock_guard<mutex> lock(_mutex);
+    for (Command& command : commands) {
+        _pending.push_back(move(command));
+    }
+}
+
+bool CommandQueue::drain(vector<Command>& out) {
+    out.clear();
+    lock_guard<mutex> lock(_mutex);
+    if (_pending.empty()) return false;
+    // Swap keeps both buffers' capacity, so steady state does not allocate
+    out.swap(_pending);
+    return true;
+}
+
+size_t CommandQueue::size() const {
+    lock_guard<mutex> lock(_mutex);
+    return _pending.size();
+}
@@ -0,0 +1,76 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Operation requested through the asynchronous command API.
+ */
+typedef enum {
+    CMD_MAKE_CALL = 0,   /**< Dial uri from acc_handle */
+    CMD_ANSWER_CALL = 1, /**< Answer call_handle */
+    CMD_HANGUP_CALL = 2, /**< Hang up call_handle */
+    CMD_REOFFER_CALL = 3 /**< Internal: re-INVITE call_handle with its codec list */
+} CommandType;
+
+/**
+ * @brief Command waiting to be run on the event thread.
+ */
+struct Command {
+    CommandType type;    /**< Operation */
+    int request_id;      /**< Id returned to the submitter */
+    int acc_handle;      /**< Account for CMD_MAKE_CALL */
+    int call_handle;     /**< Target call for answer/hangup */
+    std::string uri;     /**< Destination for CMD_MAKE_CALL */
+};
+
+
+/**
+ * @brief Multi-producer command queue drained by the event thread.
+ *
+ * Submitters only take a short lock to append; the event thread swaps the
+ * whole pending list out in one go and runs it outside the lock.
+ */
+class CommandQueue {
+public:
+    CommandQueue();
+
+    /**
+     * @brief Queue a command and assign its request id
+     *
+     * @param command Command to queue (request_id is overwritten)
+     * @return int Request id (always > 0)
+     */
+    int push(Command command);
+
+    /**
+     * @brief Queue several commands under a single lock
+     *
+     * @param commands Commands to queue (request ids are overwritten)
+     * @param out_request_ids Receives one request id per command (may be null)
+     */
+    void push_batch(std::vector<Command>& commands, int* out_request_ids);
+
+    /**
+     * @brief Move every pending command into out
+     *
+     * @param out Cleared, then filled in submission order
+     * @return true if any command was taken
+     */
+    bool drain(std::vector<Command>& out);
+
+    /**
+     * @brief Number of commands waiting
+     */
+    size_t size() const;
+
+private:
+    mutable std::mutex _mutex;       /**< Guards _pending */
+    std::vector<Command> _pending;   /**< Commands in submission order */
+    std::atomic<int> _nextRequestId; /**< Request id generator */
+};
+
+#endif // COMMAND_QUEUE_H
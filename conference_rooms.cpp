@@ -0,0 +1,167 @@
+#include "conference_rooms.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace pj;
+using namespace std;
+
+// pjsua always places the sound device on bridge port 0
+static const int SOUND_DEVICE_PORT = 0;
+
+ConferenceRooms::ConferenceRooms() : _nextRoom(1) {
+    fill(begin(_roomOf), end(_roomOf), 0);
+}
+
+int ConferenceRooms::create(bool with_local) {
+    lock_guard<mutex> lock(_mutex);
+    int id = _nextRoom++;
+    Room& room = _rooms[id];
+    if (with_local) {
+        room.members.push_back(Member{LOCAL, SOUND_DEVICE_PORT, false});
+    }
+    return id;
+}
+
+bool ConferenceRooms::destroy(int room_id, vector<int>& indices) {
+    lock_guard<mutex> lock(_mutex);
+    auto it = _rooms.find(room_id);
+    if (it == _rooms.end()) return false;
+    Room& room = it->second;
+    for (const Member& member : room.members) {
+        if (member.index != LOCAL) {
+            indices.push_back(member.index);
+            _roomOf[member.index] = 0;
+        }
+    }
+    room.members.clear();
+    try {
+        _relink(room);
+    } catch (const Error&) {
+        // Only disconnects happen here, and those never throw
+    }
+    _rooms.erase(it);
+    return true;
+}
+
+bool ConferenceRooms::add(int room_id, int index) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return false;
+    lock_guard<mutex> lock(_mutex);
+    auto it = _rooms.find(room_id);
+    if (it == _rooms.end()) return false;
+
+    int current = _roomOf[index];
+    if (current == room_id) return true;
+    if (current != 0) {
+        Room& old = _rooms[current];
+        old.members.erase(remove_if(old.members.begin(), old.members.end(),
+                                    [index](const Member& m) { return m.index == index; }),
+                          old.members.end());
+        _relink(old);
+    }
+    it->second.members.push_back(Member{index, -1, false});
+    _roomOf[index] = room_id;
+    return true;
+}
+
+bool ConferenceRooms::remove(int index) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return false;
+    lock_guard<mutex> lock(_mutex);
+    int room_id = _roomOf[index];
+    if (room_id == 0) return false;
+    _roomOf[index] = 0;
+    auto it = _rooms.find(room_id);
+    if (it == _rooms.end()) return false;
+    Room& room = it->second;
+    room.members.erase(remove_if(room.members.begin(), room.members.end(),
+                                 [index](const Member& m) { return m.index == index; }),
+                       room.members.end());
+    _relink(room);
+    return true;
+}
+
+int ConferenceRooms::room_of(int index) const {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return 0;
+    lock_guard<mutex> lock(_mutex);
+    return _roomOf[index];
+}
+
+void ConferenceRooms::attach(int index, int port) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    lock_guard<mutex> lock(_mutex);
+    auto it = _rooms.find(_roomOf[index]);
+    if (it == _rooms.end()) return;
+    Member* member = _member(it->second, index);
+    if (!member) return;
+    member->port = port;
+    _relink(it->second);
+}
+
+bool ConferenceRooms::set_muted(int room_id, int index, bool muted) {
+    lock_guard<mutex> lock(_mutex);
+    auto it = _rooms.find(room_id);
+    if (it == _rooms.end()) return false;
+    Member* member = _member(it->second, index);
+    if (!member) return false;
+    if (member->muted != muted) {
+        member->muted = muted;
+        _relink(it->second);
+    }
+    return true;
+}
+
+int ConferenceRooms::members(int room_id, int* indices, int cap) const {
+    lock_guard<mutex> lock(_mutex);
+    auto it = _rooms.find(room_id);
+    if (it == _rooms.end()) return -1;
+    int n = 0;
+    for (const Member& member : it->second.members) {
+        if (member.index == LOCAL) continue;
+        if (n >= cap) break;
+        indices[n++] = member.index;
+    }
+    return n;
+}
+
+void ConferenceRooms::call_ended(int index) {
+    try {
+        remove(index);
+    } catch (const Error&) {
+    }
+}
+
+void ConferenceRooms::_relink(Room& room) {
+    set<pair<int, int>> wanted;
+    for (const Member& source : room.members) {
+        if (source.port < 0 || source.muted) continue;
+        for (const Member& sink : room.members) {
+            if (sink.port < 0 || sink.port == source.port) continue;
+            wanted.insert(make_pair(source.port, sink.port));
+        }
+    }
+
+    // Stale links may point at ports already removed from the bridge: failures are expected
+    for (auto it = room.links.begin(); it != room.links.end();) {
+        if (wanted.count(*it) == 0) {
+            pjsua_conf_disconnect(it->first, it->second);
+            it = room.links.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const pair<int, int>& link : wanted) {
+        if (room.links.count(link)) continue;
+        pj_status_t status = pjsua_conf_connect(link.first, link.second);
+        if (status != PJ_SUCCESS) {
+            throw Error(status, "Conference Error", "Cannot connect conference participants", __FILE__, __LINE__);
+        }
+        room.links.insert(link);
+    }
+}
+
+ConferenceRooms::Member* ConferenceRooms::_member(Room& room, int index) {
+    for (Member& member : room.members) {
+        if (member.index == index) return &member;
+    }
+    return nullptr;
+}
@@ -0,0 +1,126 @@
+#ifndef CONFERENCE_ROOMS_H
+#define CONFERENCE_ROOMS_H
+
+#include <pjsua2.hpp>
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Conference rooms built on the PJSIP conference bridge.
+ *
+ * A room is a set of calls, plus optionally the local sound device, whose
+ * bridge ports are connected to each other and to nothing else, so each
+ * room only costs the slots and links of its own participants. Every
+ * participant hears all others; a muted participant keeps listening but
+ * its outgoing links are removed, so it is not mixed at all rather than
+ * mixed at level 0. A two-party room is reduced to the two direct links,
+ * which the bridge forwards without mixing (one transmitter per listener).
+ *
+ * Links are kept per room and only the difference with the wanted set is
+ * applied when a participant joins, leaves, mutes or renegotiates media.
+ * Indices are pjsua call indices; LOCAL addresses the sound device.
+ */
+class ConferenceRooms {
+public:
+    static const int LOCAL = -1; /**< Index of the local sound device participant */
+
+    ConferenceRooms();
+
+    /**
+     * @brief Create an empty room
+     *
+     * @param with_local Whether the local sound device takes part
+     * @return int Room id (> 0)
+     */
+    int create(bool with_local);
+
+    /**
+     * @brief Unlink every participant and delete the room
+     *
+     * @param indices Receives the call indices that were in the room
+     * @return true if the room existed
+     */
+    bool destroy(int room, std::vector<int>& indices);
+
+    /**
+     * @brief Add a call to a room (it leaves any other room)
+     *
+     * Its links are made by attach() once its media is active.
+     *
+     * @return true if the room exists
+     */
+    bool add(int room, int index);
+
+    /**
+     * @brief Remove a call from its room and unlink it
+     *
+     * @return true if the call was in a room
+     */
+    bool remove(int index);
+
+    /**
+     * @brief Room of a call, 0 if none
+     */
+    int room_of(int index) const;
+
+    /**
+     * @brief Bind the (new) bridge port of a call and relink its room
+     *
+     * @param index pjsua call index
+     * @param port Conference port of the call's audio
+     * @throw pj::Error if a link cannot be made
+     */
+    void attach(int index, int port);
+
+    /**
+     * @brief Mute or unmute a participant (index or LOCAL)
+     *
+     * @return true if the participant is in the room
+     * @throw pj::Error if a link cannot be made
+     */
+    bool set_muted(int room, int index, bool muted);
+
+    /**
+     * @brief Call indices in a room
+     *
+     * @return int Number of indices written, -1 if the room does not exist
+     */
+    int members(int room, int* indices, int cap) const;
+
+    /**
+     * @brief Drop a disconnected call from its room
+     */
+    void call_ended(int index);
+
+private:
+    struct Member {
+        int index;              /**< pjsua call index or LOCAL */
+        int port;               /**< Conference port, -1 until media is active */
+        bool muted;             /**< Outgoing links removed */
+    };
+
+    struct Room {
+        std::vector<Member> members;            /**< Participants */
+        std::set<std::pair<int, int>> links;    /**< (source, sink) ports connected */
+    };
+
+    /**
+     * @brief Apply the difference between the wanted and current links (lock held)
+     */
+    void _relink(Room& room);
+
+    /**
+     * @brief Member of a room by index, nullptr if absent (lock held)
+     */
+    static Member* _member(Room& room, int index);
+
+    mutable std::mutex _mutex;                  /**< Guards the rooms */
+    std::map<int, Room> _rooms;                 /**< Rooms by id */
+    int _roomOf[PJSUA_MAX_CALLS];               /**< Room of each call index, 0 if none */
+    int _nextRoom;                              /**< Next room id */
+};
+
+#endif // CONFERENCE_ROOMS_H
@@ -0,0 +1,157 @@
+#include "event_queue.hpp"
+
+#include <cstring>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static size_t round_up_pow2(size_t value, size_t minimum) {
+    size_t size = minimum;
+    while (size < value) {
+        size <<= 1;
+    }
+    return size;
+}
+
+EventQueue::EventQueue(size_t capacity, size_t strings_bytes)
+    : _enqueuePos(0), _dequeuePos(0), _stringsTail(0), _consumedPos(0), _signalled(false), _dropped(0), _notifyFd(-1) {
+    size_t size = round_up_pow2(capacity, 2);
+    _mask = (uint32_t)(size - 1);
+    _cells = std::unique_ptr<Cell[]>(new Cell[size]);
+    for (size_t i = 0; i < size; i++) {
+        _cells[i].sequence.store((uint32_t)i, std::memory_order_relaxed);
+    }
+    size_t arena = round_up_pow2(strings_bytes, MAX_STRINGS);
+    _stringsMask = (uint32_t)(arena - 1);
+    _strings = std::unique_ptr<char[]>(new char[arena]);
+    _notifyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+EventQueue::~EventQueue() {
+    if (_notifyFd >= 0) {
+        close(_notifyFd);
+    }
+}
+
+static_assert(sizeof(EventData) == 40, "EventData layout is part of the FFI");
+
+const size_t EventQueue::MAX_STRINGS;
+
+// Longest prefix of NUL-separated strings within cap that ends on a whole string
+static size_t whole_strings(const char* strings, size_t len, size_t cap) {
+    if (len <= cap) return len;
+    while (cap > 0 && strings[cap - 1] != '\0') {
+        cap--;
+    }
+    return cap;
+}
+
+bool EventQueue::push(const EventData& event, const char* strings, size_t strings_len) {
+    uint32_t len = strings ? (uint32_t)whole_strings(strings, strings_len, MAX_STRINGS) : 0;
+    uint32_t arena = _stringsMask + 1;
+    Cell* cell;
+    uint32_t pos, start, end;
+    uint64_t state = _enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        // Cell and arena positions advance in one step, so arena reservations
+        // are in cell order and the consumer frees them in that order
+        pos = (uint32_t)state;
+        start = end = (uint32_t)(state >> 32);
+        cell = &_cells[pos & _mask];
+        uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (len > 0) {
+                uint32_t offset = start & _stringsMask;
+                if (offset + len > arena) {
+                    start += arena - offset; // keep the strings contiguous: skip the arena tail
+                }
+                end = start + len;
+                if (end - _stringsTail.load(std::memory_order_acquire) > arena) {
+                    // Arena full: drop rather than stall the SIP thread
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+            uint64_t next = ((uint64_t)end << 32) | (uint32_t)(pos + 1);
+            if (_enqueuePos.compare_exchange_weak(state, next, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Ring full: drop rather than stall the SIP thread
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            state = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->data = event;
+    cell->strings_pos = start;
+    cell->strings_len = len;
+    cell->strings_end = end;
+    if (len > 0) {
+        memcpy(&_strings[start & _stringsMask], strings, len);
+    }
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    // Only the first push after a drain pays for the syscall
+    if (_notifyFd >= 0 && !_signalled.exchange(true, std::memory_order_acq_rel)) {
+        uint64_t one = 1;
+        ssize_t ret = write(_notifyFd, &one, sizeof(one));
+        (void)ret;
+    }
+    return true;
+}
+
+int EventQueue::pop_batch(EventData* out, int max, char* strings, size_t strings_cap) {
+    if (!out || max <= 0) return 0;
+
+    // Re-arm the notification before draining so a concurrent push signals again
+    if (_notifyFd >= 0 && _signalled.exchange(false, std::memory_order_acq_rel)) {
+        uint64_t count;
+        ssize_t ret = read(_notifyFd, &count, sizeof(count));
+        (void)ret;
+    }
+
+    int n = 0;
+    size_t used = 0;
+    while (n < max) {
+        Cell* cell = &_cells[_dequeuePos & _mask];
+        uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+        if ((int32_t)(seq - (_dequeuePos + 1)) < 0) {
+            break; // empty, or producer still writing this cell
+        }
+        EventData& event = out[n];
+        event = cell->data;
+        event.strings_offset = 0;
+        event.strings_len = 0;
+        size_t len = cell->strings_len;
+        const char* cellStrings = &_strings[cell->strings_pos & _stringsMask];
+        if (len > 0 && strings) {
+            if (used + len > strings_cap) {
+                if (n > 0) break; // arena full: deliver this one in the next batch
+                // Larger than the whole arena: keep the leading strings that fit
+                len = whole_strings(cellStrings, len, strings_cap);
+            }
+            if (len > 0) {
+                memcpy(strings + used, cellStrings, len);
+                event.strings_offset = (uint32_t)used;
+                event.strings_len = (uint32_t)len;
+                used += len;
+            }
+        }
+        n++;
+        // Strings copied out: hand their arena bytes back before the cell
+        _stringsTail.store(cell->strings_end, std::memory_order_release);
+        cell->sequence.store(_dequeuePos + _mask + 1, std::memory_order_release);
+        _dequeuePos++;
+    }
+    _consumedPos.store(_dequeuePos, std::memory_order_relaxed);
+    return n;
+}
+
+size_t EventQueue::depth() const {
+    uint32_t consumed = _consumedPos.load(std::memory_order_relaxed);
+    uint32_t queued = (uint32_t)_enqueuePos.load(std::memory_order_relaxed);
+    int32_t diff = (int32_t)(queued - consumed);
+    return diff > 0 ? (size_t)diff : 0;
+}
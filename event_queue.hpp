@@ -0,0 +1,151 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#define PJSUA2_EVENT_VERSION 2
+
+/**
+ * @brief Kind of event stored in an EventData record.
+ */
+typedef enum {
+    PJSUA2_EVENT_NONE = 0,          /**< Empty record */
+    PJSUA2_EVENT_REG_STATE = 1,     /**< Registration state changed */
+    PJSUA2_EVENT_INCOMING_CALL = 2, /**< New incoming call (code: configured INVITE headers present but dropped by the size caps) */
+    PJSUA2_EVENT_CALL_STATE = 3,    /**< Call state changed */
+    PJSUA2_EVENT_ERROR = 4,         /**< Error reported by the manager */
+    PJSUA2_EVENT_COMMAND_DONE = 5,  /**< Asynchronous command finished (code 0 or pj_status_t) */
+    PJSUA2_EVENT_QUALITY_ALERT = 6  /**< Raised quality alerts of a call changed (state: QualityAlert bits, code: MOS x 100) */
+} EventType;
+
+/**
+ * @brief Fixed-size binary event record (40 bytes).
+ *
+ * Records are produced on the PJSIP threads and drained by Dart in batches
+ * through pjsua2_poll_events(), so the layout must stay plain C. Strings are
+ * not repeated on every record: the Call-ID and URIs of a call are attached
+ * to its first event only ("call_id\0local_uri\0remote_uri\0"), and a
+ * reason to registration, error and failed command events ("text\0"). An
+ * incoming call event follows its URIs with "name\0value\0" pairs for the
+ * headers set by pjsua2_set_invite_headers(). Strings are copied into the
+ * string arena passed to pjsua2_poll_events().
+ */
+typedef struct {
+    uint16_t version;        /**< PJSUA2_EVENT_VERSION */
+    uint16_t type;           /**< One of EventType */
+    int32_t state;           /**< pjsip_inv_state for calls, 1/0 registration active, pj_status_t for errors and commands */
+    int32_t code;            /**< SIP status code (or source line for errors) */
+    int32_t call_handle;     /**< Registry handle of the call, -1 if none */
+    int32_t acc_handle;      /**< Handle of the account concerned, -1 if none */
+    int32_t request_id;      /**< Request id of an asynchronous command, 0 otherwise */
+    uint64_t timestamp_us;   /**< Monotonic time the event was produced, in microseconds */
+    uint32_t strings_offset; /**< Offset of the attached strings in the arena */
+    uint32_t strings_len;    /**< Bytes of attached strings, 0 if none */
+} EventData;
+
+
+/**
+ * @brief Bounded lock-free multi-producer/single-consumer event ring.
+ *
+ * Producers never block: when the ring is full the event is dropped and
+ * counted. A Linux eventfd is signalled when the ring goes from drained to
+ * non-empty so the consumer can sleep on it instead of polling. Attached
+ * strings are copied into one byte arena shared by all cells, reserved in
+ * the same step as the cell so the consumer frees it in order; pushing
+ * never allocates, and an event whose strings do not fit is dropped like
+ * one that finds the ring full.
+ */
+class EventQueue {
+public:
+    static const size_t MAX_STRINGS = 2048; /**< Bytes of strings a record can carry */
+
+    /**
+     * @brief Construct a new EventQueue
+     *
+     * @param capacity Number of records, rounded up to a power of two
+     * @param strings_bytes Size of the string arena, rounded up to a power of
+     * two of at least MAX_STRINGS
+     */
+    explicit EventQueue(size_t capacity = 1024, size_t strings_bytes = 256 * 1024);
+
+    /**
+     * @brief Destroy the EventQueue and close its notification handle
+     */
+    ~EventQueue();
+
+    EventQueue(const EventQueue&) = delete;
+    EventQueue& operator=(const EventQueue&) = delete;
+
+    /**
+     * @brief Push a record (any thread, wait-free unless contended)
+     *
+     * Strings longer than MAX_STRINGS are cut after the last whole string
+     * that fits, so leading fields are never lost.
+     *
+     * @param event Record to copy into the ring
+     * @param strings Strings attached to the record (NUL-separated), may be null
+     * @param strings_len Bytes of strings
+     * @return true if queued, false if the ring or arena was full and the event dropped
+     */
+    bool push(const EventData& event, const char* strings = nullptr, size_t strings_len = 0);
+
+    /**
+     * @brief Drain up to max records (single consumer only)
+     *
+     * A record whose strings no longer fit in the arena ends the batch and
+     * is returned by the next call; if they do not fit an empty arena, the
+     * whole strings that fit are delivered and the rest dropped. An arena
+     * of MAX_STRINGS bytes always takes a record's strings.
+     *
+     * @param out Destination array
+     * @param max Capacity of the destination array
+     * @param strings Arena receiving attached strings, may be null
+     * @param strings_cap Size of the arena
+     * @return int Number of records copied
+     */
+    int pop_batch(EventData* out, int max, char* strings = nullptr, size_t strings_cap = 0);
+
+    /**
+     * @brief Get the notification handle
+     *
+     * @return int eventfd readable while events are pending, -1 if unavailable
+     */
+    int notify_fd() const { return _notifyFd; }
+
+    /**
+     * @brief Number of events dropped because the ring or arena was full
+     */
+    uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Approximate number of records awaiting the consumer (any thread)
+     */
+    size_t depth() const;
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> sequence; /**< Vyukov sequence number */
+        uint32_t strings_pos;         /**< Arena position of the attached strings */
+        uint32_t strings_len;         /**< Bytes of attached strings */
+        uint32_t strings_end;         /**< Arena position after the reservation, padding included */
+        EventData data;               /**< Stored record */
+    };
+
+    std::unique_ptr<Cell[]> _cells;   /**< Preallocated ring storage */
+    uint32_t _mask;                   /**< Capacity - 1 */
+    std::unique_ptr<char[]> _strings; /**< Shared string arena */
+    uint32_t _stringsMask;            /**< Arena size - 1 */
+    alignas(64) std::atomic<uint64_t> _enqueuePos; /**< Next producer position: arena position << 32 | cell position */
+    alignas(64) uint32_t _dequeuePos;              /**< Next consumer position */
+    std::atomic<uint32_t> _stringsTail;            /**< Arena position up to which strings were consumed */
+    std::atomic<uint32_t> _consumedPos;            /**< _dequeuePos published after each batch, for depth() */
+    std::atomic<bool> _signalled;     /**< Notification already pending */
+    std::atomic<uint64_t> _dropped;   /**< Dropped event counter */
+    int _notifyFd;                    /**< eventfd handle */
+};
+
+#endif // EVENT_QUEUE_H
@@ -0,0 +1,91 @@
+#include "event_waker.hpp"
+
+#include <pjsua-lib/pjsua.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+
+using namespace pj;
+
+EventWaker::EventWaker() : _pool(nullptr), _key(nullptr), _pending(false) {
+    _fds[0] = -1;
+    _fds[1] = -1;
+}
+
+EventWaker::~EventWaker() {
+    close();
+}
+
+void EventWaker::open() {
+    if (_key) return;
+
+    if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, _fds) != 0) {
+        throw Error(PJ_EINVAL, "Event Loop Error", "socketpair() failed", __FILE__, __LINE__);
+    }
+
+    _pool = pjsua_pool_create("waker", 256, 256);
+    pj_ioqueue_callback cb;
+    memset(&cb, 0, sizeof(cb));
+    cb.on_read_complete = &EventWaker::_on_read;
+
+    pj_ioqueue_t* ioqueue = pjsip_endpt_get_ioqueue(pjsua_get_pjsip_endpt());
+    pj_status_t status = pj_ioqueue_register_sock(_pool, ioqueue, _fds[0], this, &cb, &_key);
+    if (status != PJ_SUCCESS) {
+        _key = nullptr;
+        close();
+        throw Error(status, "Event Loop Error", "Cannot register wake socket", __FILE__, __LINE__);
+    }
+    pj_ioqueue_op_key_init(&_readOp, sizeof(_readOp));
+    _post_read();
+}
+
+void EventWaker::close() {
+    if (_key) {
+        pj_ioqueue_unregister(_key);
+        _key = nullptr;
+        _fds[0] = -1; // closed by the ioqueue
+    }
+    if (_fds[0] >= 0) {
+        ::close(_fds[0]);
+        _fds[0] = -1;
+    }
+    if (_fds[1] >= 0) {
+        ::close(_fds[1]);
+        _fds[1] = -1;
+    }
+    if (_pool) {
+        pj_pool_release(_pool);
+        _pool = nullptr;
+    }
+}
+
+void EventWaker::wake() {
+    if (_fds[1] < 0) return;
+    if (_pending.exchange(true, std::memory_order_acq_rel)) return;
+
+    char byte = 1;
+    if (send(_fds[1], &byte, 1, MSG_DONTWAIT) != 1) {
+        _pending.store(false, std::memory_order_release);
+    }
+}
+
+void EventWaker::_on_read(pj_ioqueue_key_t* key, pj_ioqueue_op_key_t* op_key, pj_ssize_t bytes_read) {
+    PJ_UNUSED_ARG(op_key);
+    PJ_UNUSED_ARG(bytes_read);
+    EventWaker* waker = static_cast<EventWaker*>(pj_ioqueue_get_user_data(key));
+    if (waker && waker->_key) {
+        waker->_post_read();
+    }
+}
+
+void EventWaker::_post_read() {
+    // Clear before re-arming so a wake racing with this read is not lost
+    _pending.store(false, std::memory_order_release);
+    for (;;) {
+        pj_ssize_t size = sizeof(_buf);
+        pj_status_t status = pj_ioqueue_recv(_key, &_readOp, _buf, &size, 0);
+        if (status != PJ_SUCCESS) {
+            break; // PJ_EPENDING: read armed
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef EVENT_WAKER_H
+#define EVENT_WAKER_H
+
+#include <pjsua2.hpp>
+#include <atomic>
+
+/**
+ * @brief Wakes a thread blocked in libHandleEvents().
+ *
+ * The read end of a local datagram socket pair is registered with the SIP
+ * ioqueue, so a single byte written from any thread makes the blocked
+ * ioqueue poll return. A socket pair is used rather than an eventfd because
+ * the ioqueue reads registered handles with recv(). Wakes are coalesced
+ * until the pending one has been consumed.
+ */
+class EventWaker {
+public:
+    EventWaker();
+
+    /**
+     * @brief Destroy the EventWaker, unregistering it if still open
+     */
+    ~EventWaker();
+
+    EventWaker(const EventWaker&) = delete;
+    EventWaker& operator=(const EventWaker&) = delete;
+
+    /**
+     * @brief Create the socket pair and register it with the SIP ioqueue
+     *
+     * Must be called after libInit().
+     *
+     * @throw pj::Error on failure
+     */
+    void open();
+
+    /**
+     * @brief Unregister from the ioqueue and close the sockets
+     *
+     * Must be called before libDestroy().
+     */
+    void close();
+
+    /**
+     * @brief Make the current or next ioqueue poll return (any thread)
+     */
+    void wake();
+
+    /**
+     * @brief Pollable handle, readable while a wake is pending
+     *
+     * @return int Read end of the socket pair, -1 if not open
+     */
+    int fd() const { return _fds[0]; }
+
+private:
+    /**
+     * @brief ioqueue read completion
+     */
+    static void _on_read(pj_ioqueue_key_t* key, pj_ioqueue_op_key_t* op_key, pj_ssize_t bytes_read);
+
+    /**
+     * @brief Drain pending wake bytes and re-arm the asynchronous read
+     */
+    void _post_read();
+
+    int _fds[2];                     /**< [0] read end (registered), [1] write end */
+    pj_pool_t* _pool;                /**< Pool for the ioqueue key */
+    pj_ioqueue_key_t* _key;          /**< ioqueue registration */
+    pj_ioqueue_op_key_t _readOp;     /**< Pending read operation */
+    char _buf[16];                   /**< Read buffer for wake bytes */
+    std::atomic<bool> _pending;      /**< A wake byte is in flight */
+};
+
+#endif // EVENT_WAKER_H
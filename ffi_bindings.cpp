@@ -1,8 +1,59 @@
 #include "ffi_bindings.hpp"
 #include "pjsua2_manager.hpp"
 
+#include <cstddef>
+#include <cstring>
+
 using namespace std;
 
+// param is the tone frequency for MEDIA_ROUTE_TONE and the peer call handle for MEDIA_ROUTE_BRIDGE
+static bool make_media_route(int mode, const char* file_path, int param, MediaRoute& route) {
+    if (mode < MEDIA_ROUTE_SOUND_DEVICE || mode > MEDIA_ROUTE_BRIDGE) return false;
+    route.mode = static_cast<MediaRouteMode>(mode);
+    switch (route.mode) {
+        case MEDIA_ROUTE_FILE:
+            if (!file_path) return false;
+            route.filePath = file_path;
+            break;
+        case MEDIA_ROUTE_TONE:
+            if (param > 0) route.toneFreq = (unsigned)param;
+            break;
+        case MEDIA_ROUTE_BRIDGE:
+            route.peerHandle = param;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+static bool make_codec_list(const char** codecs, int count, CodecList& out) {
+    if (count < 0 || (count > 0 && !codecs)) return false;
+    out.reserve(count);
+    for (int i = 0; i < count; i++) {
+        if (!codecs[i]) return false;
+        out.emplace_back(codecs[i]);
+    }
+    return true;
+}
+
+// Version 1 callers allocate a shorter ManagerConfig: read only the fields their version has
+static ManagerConfig copy_manager_config(const ManagerConfig* config) {
+    ManagerConfig out = PJSUA2Manager::default_config();
+    size_t size = config->version >= 2 ? sizeof(ManagerConfig) : offsetof(ManagerConfig, memory_profile);
+    memcpy(&out, config, size);
+    return out;
+}
+
+// Handles point at the IPJSUA2Manager base: the call-control shims only need the interface
+// (tests and benchmarks pass other backends), everything else needs the PJSIP manager.
+static IPJSUA2Manager* as_backend(PJSUA2ManagerPtr mgr) {
+    return static_cast<IPJSUA2Manager*>(mgr);
+}
+
+static PJSUA2Manager* as_manager(PJSUA2ManagerPtr mgr) {
+    return static_cast<PJSUA2Manager*>(as_backend(mgr));
+}
 
 extern "C" {
     PJSUA2ManagerPtr pjsua2_manager_create(const char* sip_user, const char* sip_password, const char* sip_domain,
@@ -18,22 +69,88 @@ extern "C" {
                 callStateCb, 
                 onErrorCb
             );
-            return static_cast<PJSUA2ManagerPtr>(manager);
+            return static_cast<PJSUA2ManagerPtr>(static_cast<IPJSUA2Manager*>(manager));
+        } catch (const Error &e) {
+            return nullptr;
+        }
+    }
+
+    void pjsua2_manager_config_default(ManagerConfig* config) {
+        if (config) {
+            *config = PJSUA2Manager::default_config();
+        }
+    }
+
+    void pjsua2_registration_config_default(RegistrationConfig* config) {
+        if (config) {
+            *config = PJSUA2Manager::default_registration_config();
+        }
+    }
+
+    PJSUA2ManagerPtr pjsua2_manager_create_ex(const char* sip_user, const char* sip_password, const char* sip_domain,
+                                              const ManagerConfig* config,
+                                              DartIncomingCallStateCb incomingCallCb, DartOnRegStateCb onRegStateCb,
+                                              DartCallStateCb callStateCb, DartOnErrorCb onErrorCb) {
+        try {
+            if (!sip_user || !sip_password || !sip_domain || !config) return nullptr;
+            PJSUA2Manager* manager = new PJSUA2Manager(
+                string(sip_user),
+                string(sip_password),
+                string(sip_domain),
+                copy_manager_config(config),
+                incomingCallCb,
+                onRegStateCb,
+                callStateCb,
+                onErrorCb
+            );
+            return static_cast<PJSUA2ManagerPtr>(static_cast<IPJSUA2Manager*>(manager));
         } catch (const Error &e) {
             return nullptr;
         }
     }
 
     int pjsua2_manager_destroy(PJSUA2ManagerPtr mgr) {
-        delete static_cast<PJSUA2Manager*>(mgr);
+        delete as_backend(mgr);
         return 0;
     }
 
+    int pjsua2_manager_reconfigure(PJSUA2ManagerPtr mgr, const ManagerConfig* config){
+        try{
+            if (!mgr || !config) return -2;
+            as_manager(mgr)->reconfigure(copy_manager_config(config));
+            return 0;
+        }catch(const Error &e){
+            return e.status == PJ_ENOTSUP ? -3 : -1;
+        }
+    }
+
+    int pjsua2_transport_add(PJSUA2ManagerPtr mgr, int type, int port,
+                             const char* tls_ca_file, const char* tls_cert_file, const char* tls_privkey_file){
+        try{
+            if (!mgr) return -2;
+            if ((type != PJSIP_TRANSPORT_UDP && type != PJSIP_TRANSPORT_TCP && type != PJSIP_TRANSPORT_TLS) || port < 0) return -3;
+            return as_manager(mgr)->add_transport(
+                static_cast<pjsip_transport_type_e>(type), port, tls_ca_file, tls_cert_file, tls_privkey_file);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_transport_remove(PJSUA2ManagerPtr mgr, int transport_id){
+        try{
+            if (!mgr) return -2;
+            as_manager(mgr)->remove_transport(transport_id);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
     int pjsua2_make_call(PJSUA2ManagerPtr mgr, const char* remote_uri, char* out_call_id, int buffer_size) {
         try {
             if (!mgr || !remote_uri) return -2; // input invalide
             if (buffer_size <= 0) return -3; // buffer_size invalide
-            PJSUA2Manager* manager = static_cast<PJSUA2Manager*>(mgr);
+            IPJSUA2Manager* manager = as_backend(mgr);
             string call_id = manager->make_call(remote_uri);
 
             if (out_call_id && buffer_size > 0) {
@@ -47,10 +164,130 @@ extern "C" {
         }
     }
 
+    int pjsua2_make_call_from(PJSUA2ManagerPtr mgr, int acc_handle, const char* remote_uri, char* out_call_id, int buffer_size) {
+        try {
+            if (!mgr || !remote_uri) return -2;
+            if (buffer_size <= 0) return -3;
+            PJSUA2Manager* manager = as_manager(mgr);
+            string call_id = manager->make_call(acc_handle, remote_uri);
+
+            if (out_call_id) {
+                strncpy(out_call_id, call_id.c_str(), buffer_size - 1);
+                out_call_id[buffer_size - 1] = '\0';
+            }
+            return 0;
+        }
+        catch (const Error &e) {
+            return -1;
+        }
+    }
+
+    int pjsua2_make_call_with_codecs(PJSUA2ManagerPtr mgr, int acc_handle, const char* remote_uri,
+                                     const char** codecs, int count, char* out_call_id, int buffer_size) {
+        try {
+            CodecList list;
+            if (!mgr || !remote_uri || !make_codec_list(codecs, count, list)) return -2;
+            if (buffer_size <= 0) return -3;
+            string call_id = as_manager(mgr)->make_call(acc_handle, remote_uri, list);
+
+            if (out_call_id) {
+                strncpy(out_call_id, call_id.c_str(), buffer_size - 1);
+                out_call_id[buffer_size - 1] = '\0';
+            }
+            return 0;
+        }
+        catch (const Error &e) {
+            return -1;
+        }
+    }
+
+    // Returns the new account handle (>= 0) or a negative error code
+    int pjsua2_account_add(PJSUA2ManagerPtr mgr, const char* sip_user, const char* sip_password, const char* sip_domain){
+        try{
+            if (!mgr || !sip_user || !sip_password || !sip_domain) return -2;
+            return as_manager(mgr)->add_account(sip_user, sip_password, sip_domain);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    // registrars: URIs in preference order (count 0 registers with sip:domain); config may be null
+    int pjsua2_account_add_ex(PJSUA2ManagerPtr mgr, const char* sip_user, const char* sip_password, const char* sip_domain,
+                              const char** registrars, int count, const RegistrationConfig* config){
+        try{
+            if (!mgr || !sip_user || !sip_password || !sip_domain) return -2;
+            if (count < 0 || (count > 0 && !registrars)) return -2;
+            vector<string> uris;
+            for (int i = 0; i < count; i++) {
+                if (!registrars[i]) return -2;
+                uris.emplace_back(registrars[i]);
+            }
+            RegistrationConfig regConfig = config ? *config : PJSUA2Manager::default_registration_config();
+            return as_manager(mgr)->add_account(sip_user, sip_password, sip_domain, uris, regConfig);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_account_update(PJSUA2ManagerPtr mgr, int acc_handle, const char* sip_user, const char* sip_password,
+                              const char* sip_domain){
+        return pjsua2_account_update_ex(mgr, acc_handle, sip_user, sip_password, sip_domain, nullptr, 0, nullptr);
+    }
+
+    int pjsua2_account_update_ex(PJSUA2ManagerPtr mgr, int acc_handle, const char* sip_user, const char* sip_password,
+                                 const char* sip_domain, const char** registrars, int count, const RegistrationConfig* config){
+        try{
+            if (!mgr) return -2;
+            if (count < 0 || (count > 0 && !registrars)) return -2;
+            vector<string> uris;
+            for (int i = 0; i < count; i++) {
+                if (!registrars[i]) return -2;
+                uris.emplace_back(registrars[i]);
+            }
+            // NULL or empty keeps the current value; 1 if the account changed, 0 if not
+            bool changed = as_manager(mgr)->update_account(
+                acc_handle,
+                sip_user ? sip_user : "",
+                sip_password ? sip_password : "",
+                sip_domain ? sip_domain : "",
+                uris,
+                config
+            );
+            return changed ? 1 : 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_get_registrar_stats(PJSUA2ManagerPtr mgr, int acc_handle, RegistrarStats* out, int cap){
+        try{
+            if (!mgr || !out) return -2;
+            if (cap <= 0) return -3;
+            return as_manager(mgr)->get_registrar_stats(acc_handle, out, cap);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_account_remove(PJSUA2ManagerPtr mgr, int acc_handle){
+        try{
+            if (!mgr) return -2;
+            as_manager(mgr)->remove_account(acc_handle);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_get_default_account(PJSUA2ManagerPtr mgr){
+        if (!mgr) return -2;
+        return as_manager(mgr)->default_account();
+    }
+
     int pjsua2_hangup_call(PJSUA2ManagerPtr mgr, const char* call_id){
         try{
             if (!mgr) return -1;
-            static_cast<PJSUA2Manager*>(mgr)->hang_up_call(call_id);
+            as_backend(mgr)->hang_up_call(call_id);
             return 0;
         }catch(const Error &e){
             return -1;
@@ -59,7 +296,7 @@ extern "C" {
 
     int pjsua2_answer_call(PJSUA2ManagerPtr mgr, const char* call_id){
         try{
-            static_cast<PJSUA2Manager*>(mgr)->answer_call(call_id);
+            as_backend(mgr)->answer_call(call_id);
             return 0;
         }catch(const Error &e){
             return -1;
@@ -75,42 +312,589 @@ extern "C" {
     ){
         try{
             if (!output_data) return -2; // output not exists
-            
-            memset(output_data, 0, sizeof(CallData));
+            if (!mgr || !call_id) return -2;
 
-            PJSUA2Manager* manager = static_cast<PJSUA2Manager*>(mgr);
-            CallData data = manager->get_call_info(call_id);
+            IPJSUA2Manager* manager = as_backend(mgr);
+            *output_data = manager->get_call_info(string(call_id));
 
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }catch(const exception &e){
+            return -1;
+        }
+    }
 
-            strncpy(output_data->call_id, data.call_id, sizeof(output_data->call_id) - 1);
-            output_data->call_id[sizeof(output_data->call_id) - 1] = '\0';
+    // Returns the registry handle of the call, or -1 when the Call-ID is unknown
+    int pjsua2_get_call_handle(PJSUA2ManagerPtr mgr, const char* call_id){
+        if (!mgr || !call_id) return -2;
+        return as_backend(mgr)->get_call_handle(call_id);
+    }
 
-            strncpy(output_data->remote_uri, data.remote_uri, sizeof(output_data->remote_uri) - 1);
-            output_data->remote_uri[sizeof(output_data->remote_uri) - 1] = '\0';
+    int pjsua2_hangup_call_by_handle(PJSUA2ManagerPtr mgr, int call_handle){
+        try{
+            if (!mgr) return -2;
+            as_backend(mgr)->hang_up_call(call_handle);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
 
-            strncpy(output_data->local_uri, data.local_uri, sizeof(output_data->local_uri) - 1);
-            output_data->local_uri[sizeof(output_data->local_uri) - 1] = '\0';
+    int pjsua2_answer_call_by_handle(PJSUA2ManagerPtr mgr, int call_handle){
+        try{
+            if (!mgr) return -2;
+            as_backend(mgr)->answer_call(call_handle);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
 
-            strncpy(output_data->actual_state, data.actual_state, sizeof(output_data->actual_state) - 1);
-            output_data->actual_state[sizeof(output_data->actual_state) - 1] = '\0';
+    int pjsua2_answer_call_with_codecs(PJSUA2ManagerPtr mgr, int call_handle, const char** codecs, int count){
+        try{
+            CodecList list;
+            if (!mgr || !make_codec_list(codecs, count, list)) return -2;
+            as_manager(mgr)->answer_call(call_handle, list);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
 
+    int pjsua2_get_call_info_by_handle(PJSUA2ManagerPtr mgr, int call_handle, CallData* output_data){
+        try{
+            if (!mgr || !output_data) return -2;
+            *output_data = as_backend(mgr)->get_call_info(call_handle);
             return 0;
         }catch(const Error &e){
             return -1;
-        }catch(const exception &e){
+        }
+    }
+
+    int pjsua2_set_account_media_route(PJSUA2ManagerPtr mgr, int acc_handle, int mode, const char* file_path, int param){
+        MediaRoute route;
+        if (!mgr || !make_media_route(mode, file_path, param, route)) return -2;
+        as_manager(mgr)->set_account_media_route(acc_handle, route);
+        return 0;
+    }
+
+    int pjsua2_set_call_media_route(PJSUA2ManagerPtr mgr, int call_handle, int mode, const char* file_path, int param){
+        try{
+            MediaRoute route;
+            if (!mgr || !make_media_route(mode, file_path, param, route)) return -2;
+            as_manager(mgr)->set_call_media_route(call_handle, route);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_bridge_calls(PJSUA2ManagerPtr mgr, int call_handle_a, int call_handle_b){
+        try{
+            if (!mgr) return -2;
+            as_manager(mgr)->bridge_calls(call_handle_a, call_handle_b);
+            return 0;
+        }catch(const Error &e){
             return -1;
         }
     }
 
+    int pjsua2_conference_create(PJSUA2ManagerPtr mgr, int include_local){
+        try{
+            if (!mgr) return -2;
+            return as_manager(mgr)->conference_create(include_local != 0);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_conference_destroy(PJSUA2ManagerPtr mgr, int room){
+        try{
+            if (!mgr) return -2;
+            as_manager(mgr)->conference_destroy(room);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_conference_add(PJSUA2ManagerPtr mgr, int room, int call_handle){
+        try{
+            if (!mgr) return -2;
+            as_manager(mgr)->conference_add(room, call_handle);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_conference_remove(PJSUA2ManagerPtr mgr, int room, int call_handle){
+        try{
+            if (!mgr) return -2;
+            as_manager(mgr)->conference_remove(room, call_handle);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_conference_mute(PJSUA2ManagerPtr mgr, int room, int call_handle, int muted){
+        try{
+            if (!mgr) return -2;
+            as_manager(mgr)->conference_mute(room, call_handle, muted != 0);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_conference_members(PJSUA2ManagerPtr mgr, int room, int* out_handles, int cap){
+        try{
+            if (!mgr || !out_handles) return -2;
+            if (cap <= 0) return -3;
+            return as_manager(mgr)->conference_members(room, out_handles, cap);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_refresh_audio_devices(PJSUA2ManagerPtr mgr){
+        if (!mgr) return -2;
+        as_manager(mgr)->refresh_audio_devices();
+        return 0;
+    }
+
+    int pjsua2_set_headless(PJSUA2ManagerPtr mgr, int headless){
+        try{
+            if (!mgr) return -2;
+            as_manager(mgr)->set_headless(headless != 0);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_start_recording(PJSUA2ManagerPtr mgr, int call_handle, const char* path, int compressed){
+        try{
+            if (!mgr || !path) return -2;
+            as_manager(mgr)->start_recording(call_handle, path, compressed != 0);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_stop_recording(PJSUA2ManagerPtr mgr, int call_handle){
+        if (!mgr) return -2;
+        as_manager(mgr)->stop_recording(call_handle);
+        return 0;
+    }
+
+    FrameTapHeader* pjsua2_start_frame_tap(PJSUA2ManagerPtr mgr, int call_handle, int frames){
+        try{
+            if (!mgr || frames <= 0) return nullptr;
+            return as_manager(mgr)->start_frame_tap(call_handle, (unsigned)frames);
+        }catch(const Error &e){
+            return nullptr;
+        }
+    }
+
+    FrameTapHeader* pjsua2_get_frame_tap(PJSUA2ManagerPtr mgr, int call_handle){
+        if (!mgr) return nullptr;
+        return as_manager(mgr)->get_frame_tap(call_handle);
+    }
+
+    int pjsua2_stop_frame_tap(PJSUA2ManagerPtr mgr, int call_handle){
+        if (!mgr) return -2;
+        as_manager(mgr)->stop_frame_tap(call_handle);
+        return 0;
+    }
+
+    int pjsua2_release_frame_tap(PJSUA2ManagerPtr mgr, FrameTapHeader* region){
+        if (!mgr) return -2;
+        return as_manager(mgr)->release_frame_tap(region) ? 0 : -1;
+    }
+
+    int pjsua2_set_codec_priorities(PJSUA2ManagerPtr mgr, int acc_handle, const char** codecs, int count){
+        try{
+            CodecList list;
+            if (!mgr || !make_codec_list(codecs, count, list)) return -2;
+            as_manager(mgr)->set_codec_priorities(acc_handle, list);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_set_opus_settings(PJSUA2ManagerPtr mgr, const OpusSettings* settings){
+        try{
+            if (!mgr || !settings) return -2;
+            as_manager(mgr)->set_opus_settings(*settings);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_set_codec_cpu_budget(PJSUA2ManagerPtr mgr, int max_opus_calls){
+        if (!mgr) return -2;
+        as_manager(mgr)->set_codec_cpu_budget(max_opus_calls);
+        return 0;
+    }
+
+    int pjsua2_set_log_level(PJSUA2ManagerPtr mgr, int sink, int level){
+        if (!mgr) return -2;
+        if (sink < 0 || sink >= PJSUA2_LOG_SINK_COUNT || level < 0 || level > 6) return -3;
+        as_manager(mgr)->set_log_level(static_cast<LogSink>(sink), level);
+        return 0;
+    }
+
+    int pjsua2_set_log_rate_limit(PJSUA2ManagerPtr mgr, unsigned burst, unsigned window_ms){
+        if (!mgr) return -2;
+        as_manager(mgr)->set_log_rate_limit(burst, window_ms);
+        return 0;
+    }
+
+    int pjsua2_log_open_file(PJSUA2ManagerPtr mgr, const char* path, unsigned max_bytes, unsigned max_files){
+        try{
+            if (!mgr || !path) return -2;
+            as_manager(mgr)->open_log_file(path, max_bytes, max_files);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_log_close_file(PJSUA2ManagerPtr mgr){
+        if (!mgr) return -2;
+        as_manager(mgr)->close_log_file();
+        return 0;
+    }
+
+    int pjsua2_poll_logs(PJSUA2ManagerPtr mgr, LogRecord* out, int max){
+        if (!mgr || !out) return -2;
+        if (max <= 0) return -3;
+        return as_manager(mgr)->poll_logs(out, max);
+    }
+
+    int pjsua2_trace_start(PJSUA2ManagerPtr mgr, const char* path){
+        try{
+            if (!mgr || !path) return -2;
+            as_manager(mgr)->start_trace(path);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_trace_stop(PJSUA2ManagerPtr mgr){
+        if (!mgr) return -2;
+        as_manager(mgr)->stop_trace();
+        return 0;
+    }
+
+    int pjsua2_trace_replay(PJSUA2ManagerPtr mgr, const char* path, double speed, TraceReplayStats* out){
+        try{
+            if (!mgr || !path) return -2;
+            if (speed < 0) return -3;
+            TraceReplayStats stats = as_manager(mgr)->replay_trace(path, speed);
+            if (out) *out = stats;
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_get_metrics(PJSUA2ManagerPtr mgr, MetricsData* out){
+        if (!mgr || !out) return -2;
+        as_manager(mgr)->get_metrics(*out);
+        return 0;
+    }
+
+    int pjsua2_get_memory_stats(PJSUA2ManagerPtr mgr, MemoryStats* out){
+        if (!mgr || !out) return -2;
+        as_manager(mgr)->get_memory_stats(*out);
+        return 0;
+    }
+
+    int pjsua2_set_quality_interval(PJSUA2ManagerPtr mgr, unsigned interval_ms){
+        if (!mgr) return -2;
+        as_manager(mgr)->set_quality_interval(interval_ms);
+        return 0;
+    }
+
+    int pjsua2_set_quality_thresholds(PJSUA2ManagerPtr mgr, const QualityThresholds* thresholds){
+        if (!mgr || !thresholds) return -2;
+        as_manager(mgr)->set_quality_thresholds(*thresholds);
+        return 0;
+    }
+
+    int pjsua2_get_call_quality(PJSUA2ManagerPtr mgr, CallQualityData* out, int cap){
+        if (!mgr || !out) return -2;
+        if (cap <= 0) return -3;
+        return as_manager(mgr)->get_call_quality(out, cap);
+    }
+
+    int pjsua2_reset_metrics(PJSUA2ManagerPtr mgr){
+        if (!mgr) return -2;
+        as_manager(mgr)->reset_metrics();
+        return 0;
+    }
+
+    void pjsua2_admission_config_default(AdmissionConfig* config){
+        if (config) {
+            *config = PJSUA2Manager::default_admission_config();
+        }
+    }
+
+    int pjsua2_set_admission_config(PJSUA2ManagerPtr mgr, const AdmissionConfig* config){
+        try{
+            if (!mgr || !config) return -2;
+            as_manager(mgr)->set_admission_config(*config);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_get_admission_stats(PJSUA2ManagerPtr mgr, AdmissionStats* out){
+        if (!mgr || !out) return -2;
+        as_manager(mgr)->get_admission_stats(*out);
+        return 0;
+    }
+
+    // names: headers appended as "name\0value" pairs to incoming call event strings (count 0 disables)
+    int pjsua2_set_invite_headers(PJSUA2ManagerPtr mgr, const char** names, int count){
+        try{
+            if (!mgr || count < 0 || (count > 0 && !names)) return -2;
+            vector<string> list;
+            list.reserve(count);
+            for (int i = 0; i < count; i++) {
+                if (!names[i]) return -2;
+                list.emplace_back(names[i]);
+            }
+            as_manager(mgr)->set_invite_headers(list);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    // Asynchronous commands return a request id (> 0) matched by a PJSUA2_EVENT_COMMAND_DONE event
+    int pjsua2_submit_make_call(PJSUA2ManagerPtr mgr, int acc_handle, const char* remote_uri){
+        if (!mgr || !remote_uri) return -2;
+        return as_backend(mgr)->submit_make_call(acc_handle, remote_uri);
+    }
+
+    int pjsua2_submit_make_calls(PJSUA2ManagerPtr mgr, int acc_handle, const char** remote_uris, int count, int* out_request_ids){
+        if (!mgr || !remote_uris) return -2;
+        if (count <= 0) return -3;
+        vector<string> uris;
+        uris.reserve(count);
+        for (int i = 0; i < count; i++) {
+            if (!remote_uris[i]) return -2;
+            uris.emplace_back(remote_uris[i]);
+        }
+        as_manager(mgr)->submit_make_calls(acc_handle, uris, out_request_ids);
+        return count;
+    }
+
+    int pjsua2_submit_answer_call(PJSUA2ManagerPtr mgr, int call_handle){
+        if (!mgr) return -2;
+        return as_backend(mgr)->submit_answer_call(call_handle);
+    }
+
+    int pjsua2_submit_hangup_call(PJSUA2ManagerPtr mgr, int call_handle){
+        if (!mgr) return -2;
+        return as_backend(mgr)->submit_hang_up_call(call_handle);
+    }
+
+    // Fills out with up to cap calls from the cached call state; returns the number written
+    int pjsua2_get_calls_snapshot(PJSUA2ManagerPtr mgr, CallData* out, int cap){
+        if (!mgr || !out) return -2;
+        if (cap <= 0) return -3;
+        return as_backend(mgr)->get_calls_snapshot(out, cap);
+    }
+
+    // Drain up to max queued events; keep calling until it returns less than max.
+    // Attached strings are copied into strings (strings_offset/strings_len of each event).
+    int pjsua2_poll_events(PJSUA2ManagerPtr mgr, EventData* out, int max, char* strings, int strings_cap){
+        if (!mgr || !out) return -2;
+        if (max <= 0 || strings_cap < 0) return -3;
+        return as_backend(mgr)->poll_events(out, max, strings, strings ? (size_t)strings_cap : 0);
+    }
+
+    int pjsua2_get_event_fd(PJSUA2ManagerPtr mgr){
+        if (!mgr) return -2;
+        return as_backend(mgr)->event_fd();
+    }
+
 
     void pjsua2_start_events_loop(PJSUA2ManagerPtr mgr, unsigned timeout_ms){
-        PJSUA2Manager* manager = static_cast<PJSUA2Manager*>(mgr);
+        IPJSUA2Manager* manager = as_backend(mgr);
         manager->start_event_loop(timeout_ms);
     }
 
+    void pjsua2_start_events_loop_blocking(PJSUA2ManagerPtr mgr){
+        PJSUA2Manager* manager = as_manager(mgr);
+        manager->start_event_loop_blocking();
+    }
+
     void pjsua2_stop_events_loop(PJSUA2ManagerPtr mgr){
-        PJSUA2Manager* manager = static_cast<PJSUA2Manager*>(mgr);
+        IPJSUA2Manager* manager = as_backend(mgr);
         manager->stop_event_loop();
     }
 
+    // External loop mode: call when a descriptor from pjsua2_get_poll_fds is readable or the timer is due
+    int pjsua2_handle_events(PJSUA2ManagerPtr mgr, unsigned timeout_ms){
+        try{
+            if (!mgr) return -2;
+            return as_manager(mgr)->handle_events(timeout_ms);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_wake(PJSUA2ManagerPtr mgr){
+        if (!mgr) return -2;
+        as_manager(mgr)->wake();
+        return 0;
+    }
+
+    int pjsua2_get_poll_fds(PJSUA2ManagerPtr mgr, int* fds, int cap){
+        try{
+            if (!mgr || !fds) return -2;
+            if (cap <= 0) return -3;
+            return as_manager(mgr)->get_poll_fds(fds, cap);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_get_next_timer_ms(PJSUA2ManagerPtr mgr){
+        if (!mgr) return -2;
+        return as_manager(mgr)->next_timer_ms();
+    }
+
+    void pjsua2_shard_config_default(ShardConfig* config){
+        if (config) {
+            *config = ShardSupervisor::default_config();
+        }
+    }
+
+    // manager_config may be null for the default configuration; ports are offset per worker
+    PJSUA2SupervisorPtr pjsua2_supervisor_create(const ShardConfig* shard_config, const ManagerConfig* manager_config){
+        try{
+            if (!shard_config) return nullptr;
+            ManagerConfig config = manager_config ? copy_manager_config(manager_config) : PJSUA2Manager::default_config();
+            return static_cast<PJSUA2SupervisorPtr>(new ShardSupervisor(*shard_config, config));
+        }catch(const Error &e){
+            return nullptr;
+        }
+    }
+
+    int pjsua2_supervisor_destroy(PJSUA2SupervisorPtr sup){
+        delete static_cast<ShardSupervisor*>(sup);
+        return 0;
+    }
+
+    int pjsua2_supervisor_worker_count(PJSUA2SupervisorPtr sup){
+        if (!sup) return -2;
+        return static_cast<ShardSupervisor*>(sup)->worker_count();
+    }
+
+    int pjsua2_supervisor_account_add(PJSUA2SupervisorPtr sup, const char* sip_user, const char* sip_password, const char* sip_domain){
+        try{
+            if (!sup || !sip_user || !sip_password || !sip_domain) return -2;
+            return static_cast<ShardSupervisor*>(sup)->add_account(sip_user, sip_password, sip_domain);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_supervisor_account_remove(PJSUA2SupervisorPtr sup, int acc_handle){
+        try{
+            if (!sup) return -2;
+            static_cast<ShardSupervisor*>(sup)->remove_account(acc_handle);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    // Returns the call handle
+    int pjsua2_supervisor_make_call(PJSUA2SupervisorPtr sup, int acc_handle, const char* remote_uri){
+        try{
+            if (!sup || !remote_uri) return -2;
+            return static_cast<ShardSupervisor*>(sup)->make_call(acc_handle, remote_uri);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_supervisor_answer_call(PJSUA2SupervisorPtr sup, int call_handle){
+        try{
+            if (!sup) return -2;
+            static_cast<ShardSupervisor*>(sup)->answer_call(call_handle);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_supervisor_hangup_call(PJSUA2SupervisorPtr sup, int call_handle){
+        try{
+            if (!sup) return -2;
+            static_cast<ShardSupervisor*>(sup)->hang_up_call(call_handle);
+            return 0;
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_supervisor_submit_make_call(PJSUA2SupervisorPtr sup, int acc_handle, const char* remote_uri){
+        try{
+            if (!sup || !remote_uri) return -2;
+            return static_cast<ShardSupervisor*>(sup)->submit_make_call(acc_handle, remote_uri);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_supervisor_submit_answer_call(PJSUA2SupervisorPtr sup, int call_handle){
+        try{
+            if (!sup) return -2;
+            return static_cast<ShardSupervisor*>(sup)->submit_answer_call(call_handle);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_supervisor_submit_hangup_call(PJSUA2SupervisorPtr sup, int call_handle){
+        try{
+            if (!sup) return -2;
+            return static_cast<ShardSupervisor*>(sup)->submit_hang_up_call(call_handle);
+        }catch(const Error &e){
+            return -1;
+        }
+    }
+
+    int pjsua2_supervisor_get_calls_snapshot(PJSUA2SupervisorPtr sup, CallData* out, int cap){
+        if (!sup || !out) return -2;
+        if (cap <= 0) return -3;
+        return static_cast<ShardSupervisor*>(sup)->get_calls_snapshot(out, cap);
+    }
+
+    // Same contract as pjsua2_poll_events, for the events of every worker
+    int pjsua2_supervisor_poll_events(PJSUA2SupervisorPtr sup, EventData* out, int max, char* strings, int strings_cap){
+        if (!sup || !out) return -2;
+        if (max <= 0 || strings_cap < 0) return -3;
+        return static_cast<ShardSupervisor*>(sup)->poll_events(out, max, strings, strings ? (size_t)strings_cap : 0);
+    }
+
+    int pjsua2_supervisor_get_event_fd(PJSUA2SupervisorPtr sup){
+        if (!sup) return -2;
+        return static_cast<ShardSupervisor*>(sup)->event_fd();
+    }
 }
\ No newline at end of file
@@ -2,12 +2,14 @@
 #define FFI_BINDINGS_H
 
 #include "pjsua2_manager.hpp"
+#include "shard_supervisor.hpp"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef void* PJSUA2ManagerPtr;
+typedef void* PJSUA2SupervisorPtr;
 
 PJSUA2ManagerPtr pjsua2_manager_create(
     const char* sip_user,
@@ -18,17 +20,131 @@ PJSUA2ManagerPtr pjsua2_manager_create(
     DartCallStateCb callStateCb, 
     DartOnErrorCb onErrorCb
 );
+void pjsua2_manager_config_default(ManagerConfig* config);
+PJSUA2ManagerPtr pjsua2_manager_create_ex(
+    const char* sip_user,
+    const char* sip_password, 
+    const char* sip_domain,
+    const ManagerConfig* config,
+    DartIncomingCallStateCb incomingCallCb, 
+    DartOnRegStateCb onRegStateCb,
+    DartCallStateCb callStateCb, 
+    DartOnErrorCb onErrorCb
+);
 int pjsua2_manager_destroy(PJSUA2ManagerPtr mgr);
+int pjsua2_manager_reconfigure(PJSUA2ManagerPtr mgr, const ManagerConfig* config);
+int pjsua2_transport_add(PJSUA2ManagerPtr mgr, int type, int port,
+                         const char* tls_ca_file, const char* tls_cert_file, const char* tls_privkey_file);
+int pjsua2_transport_remove(PJSUA2ManagerPtr mgr, int transport_id);
+
+int pjsua2_account_add(PJSUA2ManagerPtr mgr, const char* sip_user, const char* sip_password, const char* sip_domain);
+int pjsua2_account_remove(PJSUA2ManagerPtr mgr, int acc_handle);
+void pjsua2_registration_config_default(RegistrationConfig* config);
+int pjsua2_account_add_ex(PJSUA2ManagerPtr mgr, const char* sip_user, const char* sip_password, const char* sip_domain,
+                          const char** registrars, int count, const RegistrationConfig* config);
+int pjsua2_account_update(PJSUA2ManagerPtr mgr, int acc_handle, const char* sip_user, const char* sip_password,
+                          const char* sip_domain);
+int pjsua2_account_update_ex(PJSUA2ManagerPtr mgr, int acc_handle, const char* sip_user, const char* sip_password,
+                             const char* sip_domain, const char** registrars, int count, const RegistrationConfig* config);
+int pjsua2_get_registrar_stats(PJSUA2ManagerPtr mgr, int acc_handle, RegistrarStats* out, int cap);
+int pjsua2_get_default_account(PJSUA2ManagerPtr mgr);
 
 int pjsua2_make_call(PJSUA2ManagerPtr mgr, const char* remote_uri, char* out_call_id, int buffer_size);
+int pjsua2_make_call_from(PJSUA2ManagerPtr mgr, int acc_handle, const char* remote_uri, char* out_call_id, int buffer_size);
+int pjsua2_make_call_with_codecs(PJSUA2ManagerPtr mgr, int acc_handle, const char* remote_uri,
+                                 const char** codecs, int count, char* out_call_id, int buffer_size);
 int pjsua2_hangup_call(PJSUA2ManagerPtr mgr, const char* call_id);
 int pjsua2_answer_call(PJSUA2ManagerPtr mgr, const char* call_id);
 int pjsua2_get_call_info(PJSUA2ManagerPtr mgr, const char* call_id, CallData* output_data);
 
+int pjsua2_get_call_handle(PJSUA2ManagerPtr mgr, const char* call_id);
+int pjsua2_hangup_call_by_handle(PJSUA2ManagerPtr mgr, int call_handle);
+int pjsua2_answer_call_by_handle(PJSUA2ManagerPtr mgr, int call_handle);
+int pjsua2_answer_call_with_codecs(PJSUA2ManagerPtr mgr, int call_handle, const char** codecs, int count);
+int pjsua2_get_call_info_by_handle(PJSUA2ManagerPtr mgr, int call_handle, CallData* output_data);
+int pjsua2_get_calls_snapshot(PJSUA2ManagerPtr mgr, CallData* out, int cap);
+
+int pjsua2_set_account_media_route(PJSUA2ManagerPtr mgr, int acc_handle, int mode, const char* file_path, int param);
+int pjsua2_set_call_media_route(PJSUA2ManagerPtr mgr, int call_handle, int mode, const char* file_path, int param);
+int pjsua2_bridge_calls(PJSUA2ManagerPtr mgr, int call_handle_a, int call_handle_b);
+int pjsua2_conference_create(PJSUA2ManagerPtr mgr, int include_local);
+int pjsua2_conference_destroy(PJSUA2ManagerPtr mgr, int room);
+int pjsua2_conference_add(PJSUA2ManagerPtr mgr, int room, int call_handle);
+int pjsua2_conference_remove(PJSUA2ManagerPtr mgr, int room, int call_handle);
+int pjsua2_conference_mute(PJSUA2ManagerPtr mgr, int room, int call_handle, int muted);
+int pjsua2_conference_members(PJSUA2ManagerPtr mgr, int room, int* out_handles, int cap);
+int pjsua2_refresh_audio_devices(PJSUA2ManagerPtr mgr);
+int pjsua2_set_headless(PJSUA2ManagerPtr mgr, int headless);
+
+int pjsua2_start_recording(PJSUA2ManagerPtr mgr, int call_handle, const char* path, int compressed);
+int pjsua2_stop_recording(PJSUA2ManagerPtr mgr, int call_handle);
+
+FrameTapHeader* pjsua2_start_frame_tap(PJSUA2ManagerPtr mgr, int call_handle, int frames);
+FrameTapHeader* pjsua2_get_frame_tap(PJSUA2ManagerPtr mgr, int call_handle);
+int pjsua2_stop_frame_tap(PJSUA2ManagerPtr mgr, int call_handle);
+int pjsua2_release_frame_tap(PJSUA2ManagerPtr mgr, FrameTapHeader* region);
+
+int pjsua2_set_codec_priorities(PJSUA2ManagerPtr mgr, int acc_handle, const char** codecs, int count);
+int pjsua2_set_opus_settings(PJSUA2ManagerPtr mgr, const OpusSettings* settings);
+int pjsua2_set_codec_cpu_budget(PJSUA2ManagerPtr mgr, int max_opus_calls);
+
+int pjsua2_set_log_level(PJSUA2ManagerPtr mgr, int sink, int level);
+int pjsua2_set_log_rate_limit(PJSUA2ManagerPtr mgr, unsigned burst, unsigned window_ms);
+int pjsua2_log_open_file(PJSUA2ManagerPtr mgr, const char* path, unsigned max_bytes, unsigned max_files);
+int pjsua2_log_close_file(PJSUA2ManagerPtr mgr);
+int pjsua2_poll_logs(PJSUA2ManagerPtr mgr, LogRecord* out, int max);
+
+int pjsua2_trace_start(PJSUA2ManagerPtr mgr, const char* path);
+int pjsua2_trace_stop(PJSUA2ManagerPtr mgr);
+int pjsua2_trace_replay(PJSUA2ManagerPtr mgr, const char* path, double speed, TraceReplayStats* out);
+
+int pjsua2_get_metrics(PJSUA2ManagerPtr mgr, MetricsData* out);
+int pjsua2_reset_metrics(PJSUA2ManagerPtr mgr);
+
+void pjsua2_admission_config_default(AdmissionConfig* config);
+int pjsua2_set_admission_config(PJSUA2ManagerPtr mgr, const AdmissionConfig* config);
+int pjsua2_get_admission_stats(PJSUA2ManagerPtr mgr, AdmissionStats* out);
+int pjsua2_set_invite_headers(PJSUA2ManagerPtr mgr, const char** names, int count);
+int pjsua2_get_memory_stats(PJSUA2ManagerPtr mgr, MemoryStats* out);
+
+int pjsua2_set_quality_interval(PJSUA2ManagerPtr mgr, unsigned interval_ms);
+int pjsua2_set_quality_thresholds(PJSUA2ManagerPtr mgr, const QualityThresholds* thresholds);
+int pjsua2_get_call_quality(PJSUA2ManagerPtr mgr, CallQualityData* out, int cap);
+
+int pjsua2_submit_make_call(PJSUA2ManagerPtr mgr, int acc_handle, const char* remote_uri);
+int pjsua2_submit_make_calls(PJSUA2ManagerPtr mgr, int acc_handle, const char** remote_uris, int count, int* out_request_ids);
+int pjsua2_submit_answer_call(PJSUA2ManagerPtr mgr, int call_handle);
+int pjsua2_submit_hangup_call(PJSUA2ManagerPtr mgr, int call_handle);
+
+int pjsua2_poll_events(PJSUA2ManagerPtr mgr, EventData* out, int max, char* strings, int strings_cap);
+int pjsua2_get_event_fd(PJSUA2ManagerPtr mgr);
+
 
 void pjsua2_start_events_loop(PJSUA2ManagerPtr mgr, unsigned timeout_ms);
+void pjsua2_start_events_loop_blocking(PJSUA2ManagerPtr mgr);
 void pjsua2_stop_events_loop(PJSUA2ManagerPtr mgr);
 
+int pjsua2_handle_events(PJSUA2ManagerPtr mgr, unsigned timeout_ms);
+int pjsua2_wake(PJSUA2ManagerPtr mgr);
+int pjsua2_get_poll_fds(PJSUA2ManagerPtr mgr, int* fds, int cap);
+int pjsua2_get_next_timer_ms(PJSUA2ManagerPtr mgr);
+
+void pjsua2_shard_config_default(ShardConfig* config);
+PJSUA2SupervisorPtr pjsua2_supervisor_create(const ShardConfig* shard_config, const ManagerConfig* manager_config);
+int pjsua2_supervisor_destroy(PJSUA2SupervisorPtr sup);
+int pjsua2_supervisor_worker_count(PJSUA2SupervisorPtr sup);
+int pjsua2_supervisor_account_add(PJSUA2SupervisorPtr sup, const char* sip_user, const char* sip_password, const char* sip_domain);
+int pjsua2_supervisor_account_remove(PJSUA2SupervisorPtr sup, int acc_handle);
+int pjsua2_supervisor_make_call(PJSUA2SupervisorPtr sup, int acc_handle, const char* remote_uri);
+int pjsua2_supervisor_answer_call(PJSUA2SupervisorPtr sup, int call_handle);
+int pjsua2_supervisor_hangup_call(PJSUA2SupervisorPtr sup, int call_handle);
+int pjsua2_supervisor_submit_make_call(PJSUA2SupervisorPtr sup, int acc_handle, const char* remote_uri);
+int pjsua2_supervisor_submit_answer_call(PJSUA2SupervisorPtr sup, int call_handle);
+int pjsua2_supervisor_submit_hangup_call(PJSUA2SupervisorPtr sup, int call_handle);
+int pjsua2_supervisor_get_calls_snapshot(PJSUA2SupervisorPtr sup, CallData* out, int cap);
+int pjsua2_supervisor_poll_events(PJSUA2SupervisorPtr sup, EventData* out, int max, char* strings, int strings_cap);
+int pjsua2_supervisor_get_event_fd(PJSUA2SupervisorPtr sup);
+
 #ifdef __cplusplus
 }
 #endif
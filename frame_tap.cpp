@@ -0,0 +1,150 @@
+#include "frame_tap.hpp"
+
+#include <cstring>
+#include <sys/mman.h>
+
+using namespace pj;
+using namespace std;
+
+static_assert(sizeof(FrameTapHeader) == 192, "FrameTapHeader layout is part of the FFI");
+
+void FrameTap::TapPort::onFrameReceived(MediaFrame& frame) {
+    // Media clock thread: one copy into the ring, never block
+    if (frame.type != PJMEDIA_FRAME_TYPE_AUDIO) return;
+    FrameTapHeader* region = m_region;
+    uint64_t write = region->write_index;
+    uint64_t read = __atomic_load_n(&region->read_index, __ATOMIC_ACQUIRE);
+    if (write - read >= region->capacity) {
+        __atomic_fetch_add(&region->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    uint8_t* slot = reinterpret_cast<uint8_t*>(region) + region->data_offset
+        + (write & (region->capacity - 1)) * region->frame_bytes;
+    size_t size = min((size_t)region->frame_bytes, frame.buf.size());
+    memcpy(slot, frame.buf.data(), size);
+    if (size < region->frame_bytes) {
+        memset(slot + size, 0, region->frame_bytes - size);
+    }
+    __atomic_store_n(&region->write_index, write + 1, __ATOMIC_RELEASE);
+}
+
+
+FrameTap::FrameTap() : _clockRate(16000), _ptime(20) {
+}
+
+FrameTap::~FrameTap() {
+    lock_guard<mutex> lock(_mutex);
+    for (Tap& tap : _byCall) {
+        if (tap.region) {
+            // stop_all() should have run before libDestroy(); keep the port, only unmap
+            tap.port.release();
+            _unmap(tap.region, tap.regionSize);
+        }
+    }
+    for (Tap& tap : _closed) {
+        _unmap(tap.region, tap.regionSize);
+    }
+}
+
+void FrameTap::set_format(unsigned clock_rate, unsigned ptime) {
+    lock_guard<mutex> lock(_mutex);
+    _clockRate = clock_rate;
+    _ptime = ptime;
+}
+
+FrameTapHeader* FrameTap::start(int index, unsigned frames) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) {
+        throw Error(PJ_EINVAL, "Frame Tap Error", "Invalid call index", __FILE__, __LINE__);
+    }
+    lock_guard<mutex> lock(_mutex);
+    if (_byCall[index].region) {
+        throw Error(PJ_EEXISTS, "Frame Tap Error", "Call is already tapped", __FILE__, __LINE__);
+    }
+
+    unsigned capacity = 2;
+    while (capacity < frames) {
+        capacity <<= 1;
+    }
+    unsigned samples = _clockRate * _ptime / 1000;
+    size_t size = sizeof(FrameTapHeader) + (size_t)capacity * samples * 2;
+    // Anonymous pages: zero-filled, page-aligned and never moved
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw Error(PJ_ENOMEM, "Frame Tap Error", "Cannot map frame tap region", __FILE__, __LINE__);
+    }
+
+    FrameTapHeader* region = static_cast<FrameTapHeader*>(memory);
+    region->version = PJSUA2_FRAME_TAP_VERSION;
+    region->clock_rate = _clockRate;
+    region->samples_per_frame = samples;
+    region->frame_bytes = samples * 2;
+    region->capacity = capacity;
+    region->data_offset = sizeof(FrameTapHeader);
+
+    _byCall[index].region = region;
+    _byCall[index].regionSize = size;
+    return region;
+}
+
+bool FrameTap::attach(int index, AudioMedia& call_media) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return false;
+    lock_guard<mutex> lock(_mutex);
+    Tap& tap = _byCall[index];
+    if (!tap.region) return false;
+
+    if (!tap.port) {
+        MediaFormatAudio format;
+        format.init(PJMEDIA_FORMAT_PCM, _clockRate, 1, _ptime * 1000, 16);
+        tap.port.reset(new TapPort(tap.region));
+        tap.port->createPort("tap" + to_string(index), format);
+    }
+    call_media.startTransmit(*tap.port);
+    return true;
+}
+
+void FrameTap::stop(int index) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    Tap tap;
+    {
+        lock_guard<mutex> lock(_mutex);
+        if (!_byCall[index].region) return;
+        tap = move(_byCall[index]);
+        _byCall[index] = Tap();
+    }
+
+    // Destroying the port removes it from the bridge: no more frames after this
+    tap.port.reset();
+    __atomic_store_n(&tap.region->closed, 1, __ATOMIC_RELEASE);
+
+    lock_guard<mutex> lock(_mutex);
+    _closed.push_back(move(tap));
+}
+
+void FrameTap::stop_all() {
+    for (int i = 0; i < PJSUA_MAX_CALLS; i++) {
+        stop(i);
+    }
+}
+
+bool FrameTap::release(FrameTapHeader* region) {
+    if (!region) return false;
+    lock_guard<mutex> lock(_mutex);
+    for (auto it = _closed.begin(); it != _closed.end(); ++it) {
+        if (it->region == region) {
+            _unmap(it->region, it->regionSize);
+            _closed.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+FrameTapHeader* FrameTap::region_of(int index) const {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return nullptr;
+    lock_guard<mutex> lock(_mutex);
+    return _byCall[index].region;
+}
+
+void FrameTap::_unmap(FrameTapHeader* region, size_t size) {
+    munmap(region, size);
+}
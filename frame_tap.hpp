@@ -0,0 +1,139 @@
+#ifndef FRAME_TAP_H
+#define FRAME_TAP_H
+
+#include <pjsua2.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define PJSUA2_FRAME_TAP_VERSION 1
+
+/**
+ * @brief Header of a frame tap region, followed by the frame slots.
+ *
+ * The region is a single-producer/single-consumer ring of fixed-size 16-bit
+ * mono PCM frames, written by the media clock thread and read in place by
+ * Dart. Frame n lives at byte offset data_offset + (n % capacity) *
+ * frame_bytes. The consumer reads frames [read_index, write_index) and then
+ * stores the new read_index; both indices only ever grow and must be accessed
+ * with acquire/release semantics (Dart: read write_index before the frames,
+ * store read_index after consuming them).
+ */
+typedef struct {
+    uint32_t version;            /**< PJSUA2_FRAME_TAP_VERSION */
+    uint32_t clock_rate;         /**< Sample rate in Hz */
+    uint32_t samples_per_frame;  /**< Samples in each frame slot */
+    uint32_t frame_bytes;        /**< Bytes in each frame slot */
+    uint32_t capacity;           /**< Number of frame slots (power of two) */
+    uint32_t data_offset;        /**< Offset of slot 0 from the start of the region */
+    uint32_t closed;             /**< Set to 1 once the call ended: no more frames */
+    uint32_t reserved;
+    uint64_t dropped;            /**< Frames dropped because the ring was full */
+    uint8_t pad0[64 - 40];
+    uint64_t write_index;        /**< Frames produced (written by the media thread) */
+    uint8_t pad1[64 - 8];
+    uint64_t read_index;         /**< Frames consumed (written by Dart) */
+    uint8_t pad2[64 - 8];
+} FrameTapHeader;
+
+
+/**
+ * @brief Exposes the received audio of selected calls as shared-memory rings.
+ *
+ * Each tap owns a conference port whose onFrameReceived copies the frame
+ * into a page-aligned region and publishes it by bumping write_index: no
+ * callback, lock or allocation per frame. Regions stay mapped after the call
+ * ends (closed is set) until the consumer releases them, so Dart never reads
+ * freed memory. Indices are pjsua call indices.
+ */
+class FrameTap {
+public:
+    FrameTap();
+
+    /**
+     * @brief Unmap every region
+     */
+    ~FrameTap();
+
+    /**
+     * @brief Audio format of the tap ports
+     *
+     * @param clock_rate Conference bridge clock rate in Hz
+     * @param ptime Frame duration in ms
+     */
+    void set_format(unsigned clock_rate, unsigned ptime);
+
+    /**
+     * @brief Create the tap region of a call
+     *
+     * @param index pjsua call index
+     * @param frames Ring capacity in frames, rounded up to a power of two
+     * @return FrameTapHeader* Region to hand to the consumer
+     * @throw pj::Error if the call is already tapped or the region cannot be mapped
+     */
+    FrameTapHeader* start(int index, unsigned frames);
+
+    /**
+     * @brief Connect the tap port of a call (after each media update)
+     *
+     * @param index pjsua call index
+     * @param call_media Audio media of the call
+     * @return true if the call is tapped
+     */
+    bool attach(int index, pj::AudioMedia& call_media);
+
+    /**
+     * @brief Stop tapping a call; the region is closed but stays mapped
+     */
+    void stop(int index);
+
+    /**
+     * @brief Stop every tap (before libDestroy)
+     */
+    void stop_all();
+
+    /**
+     * @brief Unmap a closed region once the consumer is done with it
+     *
+     * @return true if the region was known and is now released
+     */
+    bool release(FrameTapHeader* region);
+
+    /**
+     * @brief Region of a tapped call, nullptr if none
+     */
+    FrameTapHeader* region_of(int index) const;
+
+private:
+    /**
+     * @brief Conference port writing frames into a region
+     */
+    class TapPort : public pj::AudioMediaPort {
+    public:
+        explicit TapPort(FrameTapHeader* region) : m_region(region) {}
+        virtual void onFrameReceived(pj::MediaFrame& frame) override;
+    private:
+        FrameTapHeader* m_region; /**< Destination ring */
+    };
+
+    struct Tap {
+        FrameTapHeader* region = nullptr;   /**< Mapped ring */
+        size_t regionSize = 0;              /**< Mapping length */
+        std::unique_ptr<TapPort> port;      /**< Conference port (PJSIP threads only) */
+    };
+
+    /**
+     * @brief Unmap a region
+     */
+    static void _unmap(FrameTapHeader* region, size_t size);
+
+    mutable std::mutex _mutex;                  /**< Guards the tap tables */
+    Tap _byCall[PJSUA_MAX_CALLS];               /**< Live tap of each call */
+    std::vector<Tap> _closed;                   /**< Ended taps awaiting release */
+    unsigned _clockRate;                        /**< Port clock rate in Hz */
+    unsigned _ptime;                            /**< Port frame duration in ms */
+};
+
+#endif // FRAME_TAP_H
@@ -0,0 +1,94 @@
+#include "invite_headers.hpp"
+
+#include <strings.h>
+
+#include <cstring>
+
+using namespace pj;
+using namespace std;
+
+const size_t InviteHeaders::MAX_BYTES;
+
+// Compact header forms (RFC 3261 7.3.3 and later extensions)
+static const struct {
+    const char* name;
+    const char* compact;
+} COMPACT_FORMS[] = {
+    {"Accept-Contact", "a"}, {"Allow-Events", "u"}, {"Call-ID", "i"}, {"Contact", "m"},
+    {"Content-Encoding", "e"}, {"Content-Length", "l"}, {"Content-Type", "c"}, {"Event", "o"},
+    {"From", "f"}, {"Identity", "y"}, {"Refer-To", "r"}, {"Referred-By", "b"},
+    {"Reject-Contact", "j"}, {"Request-Disposition", "d"}, {"Session-Expires", "x"},
+    {"Subject", "s"}, {"Supported", "k"}, {"To", "t"}, {"Via", "v"},
+};
+
+// The other form of a header name, empty if it has none
+static string other_form(const string& name) {
+    for (const auto& form : COMPACT_FORMS) {
+        if (strcasecmp(name.c_str(), form.name) == 0) return form.compact;
+        if (strcasecmp(name.c_str(), form.compact) == 0) return form.name;
+    }
+    return string();
+}
+
+void InviteHeaders::configure(const vector<string>& names) {
+    vector<Name> entries;
+    entries.reserve(names.size());
+    for (const string& name : names) {
+        entries.push_back(Name{name, other_form(name)});
+    }
+    lock_guard<mutex> lock(_mutex);
+    _names.swap(entries);
+}
+
+int InviteHeaders::extract(const pjsip_msg* msg, string& out, int* dropped) const {
+    if (dropped) *dropped = 0;
+    if (!msg) return 0;
+
+    lock_guard<mutex> lock(_mutex);
+    size_t budget = MAX_BYTES;
+    int found = 0;
+    int skipped = 0;
+    bool full = false;
+    char buf[MAX_BYTES];
+    for (const Name& entry : _names) {
+        pj_str_t name;
+        name.ptr = const_cast<char*>(entry.name.c_str());
+        name.slen = (pj_ssize_t)entry.name.size();
+        pj_str_t compact;
+        compact.ptr = const_cast<char*>(entry.compact.c_str());
+        compact.slen = (pj_ssize_t)entry.compact.size();
+
+        // Without a compact form both names are the configured one
+        const pj_str_t* sname = compact.slen ? &compact : &name;
+        const pjsip_hdr* hdr = (const pjsip_hdr*)pjsip_msg_find_hdr_by_names(msg, &name, sname, nullptr);
+        for (; hdr; hdr = (const pjsip_hdr*)pjsip_msg_find_hdr_by_names(msg, &name, sname, hdr->next)) {
+            if (full) {
+                skipped++; // past the cap: only counted
+                continue;
+            }
+            // Printing covers typed headers (From, Contact...) as well as generic ones
+            int len = pjsip_hdr_print_on(const_cast<pjsip_hdr*>(hdr), buf, sizeof(buf));
+            if (len < 0) {
+                skipped++; // longer than MAX_BYTES on its own: skip just this one
+                continue;
+            }
+            const char* colon = static_cast<const char*>(memchr(buf, ':', len));
+            if (!colon) continue;
+            const char* value = colon + 1;
+            while (value < buf + len && *value == ' ') value++;
+            size_t size = entry.name.size() + (buf + len - value) + 2;
+            if (size > budget) {
+                full = true;
+                skipped++;
+                continue;
+            }
+            out.push_back('\0');
+            out.append(entry.name).push_back('\0');
+            out.append(value, buf + len - value);
+            budget -= size;
+            found++;
+        }
+    }
+    if (dropped) *dropped = skipped;
+    return found;
+}
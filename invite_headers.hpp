@@ -0,0 +1,53 @@
+#ifndef INVITE_HEADERS_H
+#define INVITE_HEADERS_H
+
+#include <pjsua2.hpp>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Headers copied out of incoming INVITEs while onIncomingCall runs.
+ *
+ * The values are packed as "name\0value\0" pairs after the Call-ID and URIs
+ * of the PJSUA2_EVENT_INCOMING_CALL event, so Dart reads its routing data
+ * (X-Caller-Id, P-Asserted-Identity, Alert-Info...) straight from the event
+ * arena. Names are matched case-insensitively and also match the compact
+ * form of a header that has one (f for From, i for Call-ID...); pairs always
+ * carry the configured name. A header present several times yields one pair
+ * per occurrence and a missing header yields none. A header longer than
+ * MAX_BYTES on its own is skipped, and extraction stops before the packed
+ * pairs would exceed MAX_BYTES, which keeps the event within
+ * EventQueue::MAX_STRINGS; both are counted so Dart can tell a dropped
+ * header from an absent one.
+ */
+class InviteHeaders {
+public:
+    static const size_t MAX_BYTES = 1024; /**< Packed pairs per INVITE */
+
+    /**
+     * @brief Replace the header names to extract (empty disables extraction)
+     */
+    void configure(const std::vector<std::string>& names);
+
+    /**
+     * @brief Append the configured headers of msg to out (PJSIP thread)
+     *
+     * @param msg Parsed INVITE, may be null
+     * @param out Receives "\0name\0value" for each header found
+     * @param dropped Receives the number of headers present but not appended, may be null
+     * @return int Number of headers appended
+     */
+    int extract(const pjsip_msg* msg, std::string& out, int* dropped = nullptr) const;
+
+private:
+    struct Name {
+        std::string name;           /**< Configured name */
+        std::string compact;        /**< Compact form, empty if none */
+    };
+
+    mutable std::mutex _mutex;      /**< Guards the names */
+    std::vector<Name> _names;       /**< Header names to extract */
+};
+
+#endif // INVITE_HEADERS_H
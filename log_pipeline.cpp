@@ -0,0 +1,323 @@
+#include "log_pipeline.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+using namespace pj;
+using namespace std;
+
+static_assert(sizeof(LogRecord) == 512, "LogRecord layout is part of the FFI");
+
+LogPipeline::LogPipeline(size_t capacity)
+    : _enqueuePos(0), _dequeuePos(0), _dropped(0), _suppressed(0), _burst(10), _windowUs(1000000),
+      _file(nullptr), _fileBytes(0), _maxFileBytes(0), _maxFiles(0), _stopping(false) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    _mask = size - 1;
+    _cells = unique_ptr<Cell[]>(new Cell[size]);
+    for (size_t i = 0; i < size; i++) {
+        _cells[i].sequence.store(i, memory_order_relaxed);
+    }
+    _levels[PJSUA2_LOG_CONSOLE].store(3, memory_order_relaxed);
+    _levels[PJSUA2_LOG_FILE].store(3, memory_order_relaxed);
+    _levels[PJSUA2_LOG_DART].store(0, memory_order_relaxed);
+    _thread = thread(&LogPipeline::_run, this);
+}
+
+LogPipeline::~LogPipeline() {
+    {
+        lock_guard<mutex> lock(_threadMutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    close_file();
+}
+
+LogWriter* LogPipeline::make_writer() {
+    return new Writer(*this);
+}
+
+void LogPipeline::Writer::write(const LogEntry &entry) {
+    m_pipeline.write(entry.level, entry.msg);
+}
+
+void LogPipeline::write(int level, const char* msg, size_t len) {
+    if (!msg || level > max_level()) return;
+    while (len > 0 && (msg[len - 1] == '\n' || msg[len - 1] == '\r')) {
+        len--;
+    }
+    if (len == 0) return;
+
+    // FNV-1a: identical messages share a rate limiter slot
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)msg[i]) * 1099511628211ULL;
+    }
+    uint32_t slot = (uint32_t)((hash >> 32) % RATE_SLOTS);
+
+    LogRecord record;
+    record.timestamp_us = _wall_us();
+    record.level = level;
+    if (!_admit(slot, hash, level, record.timestamp_us, record.repeated)) return;
+    size_t n = min(len, sizeof(record.msg) - 1);
+    memcpy(record.msg, msg, n);
+    record.msg[n] = '\0';
+    _push(record, slot);
+}
+
+bool LogPipeline::_admit(uint32_t slot, uint64_t hash, int level, uint64_t now_us, uint32_t& repeated) {
+    repeated = 0;
+    unsigned burst = _burst.load(memory_order_relaxed);
+    if (burst == 0) return true;
+
+    RateSlot& rate = _slots[slot];
+    if (rate.hash.load(memory_order_acquire) != hash) {
+        // Another message (or none) owned the slot: take it over. Races only blur the counts.
+        rate.suppressed.store(0, memory_order_relaxed);
+        rate.count.store(1, memory_order_relaxed);
+        rate.level.store(level, memory_order_relaxed);
+        rate.windowUs.store(now_us, memory_order_relaxed);
+        rate.hash.store(hash, memory_order_release);
+        return true;
+    }
+
+    uint64_t start = rate.windowUs.load(memory_order_relaxed);
+    if (now_us - start >= _windowUs.load(memory_order_relaxed)
+            && rate.windowUs.compare_exchange_strong(start, now_us, memory_order_relaxed)) {
+        repeated = rate.suppressed.exchange(0, memory_order_relaxed);
+        rate.count.store(1, memory_order_relaxed);
+        return true;
+    }
+    if (rate.count.fetch_add(1, memory_order_relaxed) < burst) return true;
+
+    rate.suppressed.fetch_add(1, memory_order_relaxed);
+    _suppressed.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+void LogPipeline::_push(const LogRecord& record, uint32_t slot) {
+    Cell* cell;
+    size_t pos = _enqueuePos.load(memory_order_relaxed);
+    for (;;) {
+        cell = &_cells[pos & _mask];
+        size_t seq = cell->sequence.load(memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (_enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Ring full: drop rather than stall a SIP or media thread
+            _dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        } else {
+            pos = _enqueuePos.load(memory_order_relaxed);
+        }
+    }
+    cell->record = record;
+    cell->slot = slot;
+    cell->sequence.store(pos + 1, memory_order_release);
+}
+
+void LogPipeline::set_level(LogSink sink, int level) {
+    if (sink < 0 || sink >= PJSUA2_LOG_SINK_COUNT) return;
+    _levels[sink].store(max(0, min(level, 6)), memory_order_relaxed);
+}
+
+int LogPipeline::level(LogSink sink) const {
+    if (sink < 0 || sink >= PJSUA2_LOG_SINK_COUNT) return 0;
+    return _levels[sink].load(memory_order_relaxed);
+}
+
+int LogPipeline::max_level() const {
+    int level = 0;
+    for (const atomic<int>& sink : _levels) {
+        level = max(level, sink.load(memory_order_relaxed));
+    }
+    return level;
+}
+
+void LogPipeline::set_rate_limit(unsigned burst, unsigned window_ms) {
+    _burst.store(burst, memory_order_relaxed);
+    _windowUs.store((uint64_t)max(1u, window_ms) * 1000, memory_order_relaxed);
+}
+
+bool LogPipeline::open_file(const string& path, size_t max_bytes, unsigned max_files) {
+    lock_guard<mutex> lock(_fileMutex);
+    if (_file) {
+        fclose(_file);
+        _file = nullptr;
+    }
+    _file = fopen(path.c_str(), "a");
+    if (!_file) return false;
+    setvbuf(_file, nullptr, _IOFBF, 1 << 16);
+    _filePath = path;
+    _maxFileBytes = max_bytes;
+    _maxFiles = max_files;
+    long size = ftell(_file);
+    _fileBytes = size > 0 ? (size_t)size : 0;
+    return true;
+}
+
+void LogPipeline::close_file() {
+    lock_guard<mutex> lock(_fileMutex);
+    if (_file) {
+        fclose(_file);
+        _file = nullptr;
+    }
+}
+
+int LogPipeline::poll(LogRecord* out, int max) {
+    if (!out || max <= 0) return 0;
+    lock_guard<mutex> lock(_dartMutex);
+    int n = 0;
+    while (n < max && !_dartRecords.empty()) {
+        out[n++] = _dartRecords.front();
+        _dartRecords.pop_front();
+    }
+    return n;
+}
+
+void LogPipeline::_run() {
+    unique_lock<mutex> lock(_threadMutex);
+    while (!_stopping) {
+        _wake.wait_for(lock, chrono::milliseconds(DRAIN_MS));
+        lock.unlock();
+        _drain();
+        _flush_suppressed(_wall_us());
+        lock.lock();
+    }
+    lock.unlock();
+    _drain();
+}
+
+void LogPipeline::_drain() {
+    bool delivered = false;
+    for (;;) {
+        Cell* cell = &_cells[_dequeuePos & _mask];
+        size_t seq = cell->sequence.load(memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(_dequeuePos + 1) < 0) {
+            break;
+        }
+        LogRecord& record = cell->record;
+        _slotText[cell->slot].assign(record.msg);
+        if (record.repeated > 0) {
+            // Summary of the previous window first, then the message that opened the new one
+            _deliver(record);
+            record.repeated = 0;
+        }
+        _deliver(record);
+        cell->sequence.store(_dequeuePos + _mask + 1, memory_order_release);
+        _dequeuePos++;
+        delivered = true;
+    }
+    if (!delivered) return;
+
+    if (_levels[PJSUA2_LOG_CONSOLE].load(memory_order_relaxed) > 0) {
+        fflush(stdout);
+    }
+    lock_guard<mutex> lock(_fileMutex);
+    if (_file) {
+        fflush(_file);
+    }
+}
+
+void LogPipeline::_flush_suppressed(uint64_t now_us) {
+    uint64_t window = _windowUs.load(memory_order_relaxed);
+    for (size_t i = 0; i < RATE_SLOTS; i++) {
+        RateSlot& rate = _slots[i];
+        if (rate.suppressed.load(memory_order_relaxed) == 0) continue;
+        if (now_us - rate.windowUs.load(memory_order_relaxed) < window) continue;
+        uint32_t count = rate.suppressed.exchange(0, memory_order_relaxed);
+        if (count == 0) continue;
+
+        LogRecord record;
+        record.timestamp_us = now_us;
+        record.level = rate.level.load(memory_order_relaxed);
+        record.repeated = count;
+        size_t n = min(_slotText[i].size(), sizeof(record.msg) - 1);
+        memcpy(record.msg, _slotText[i].data(), n);
+        record.msg[n] = '\0';
+        _deliver(record);
+    }
+}
+
+void LogPipeline::_deliver(const LogRecord& record) {
+    bool console = record.level <= _levels[PJSUA2_LOG_CONSOLE].load(memory_order_relaxed);
+    bool file = record.level <= _levels[PJSUA2_LOG_FILE].load(memory_order_relaxed);
+    bool dart = record.level <= _levels[PJSUA2_LOG_DART].load(memory_order_relaxed);
+
+    if (console || file) {
+        char line[PJSUA2_LOG_MSG_MAX + 96];
+        time_t sec = (time_t)(record.timestamp_us / 1000000);
+        struct tm tm;
+        localtime_r(&sec, &tm);
+        int len = (int)strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S", &tm);
+        if (record.repeated > 0) {
+            len += snprintf(line + len, sizeof(line) - len, ".%03u %d [suppressed %u identical messages] %s\n",
+                            (unsigned)(record.timestamp_us / 1000 % 1000), record.level, record.repeated, record.msg);
+        } else {
+            len += snprintf(line + len, sizeof(line) - len, ".%03u %d %s\n",
+                            (unsigned)(record.timestamp_us / 1000 % 1000), record.level, record.msg);
+        }
+        len = min(len, (int)sizeof(line) - 1);
+
+        if (console) {
+            fwrite(line, 1, len, stdout);
+        }
+        if (file) {
+            lock_guard<mutex> lock(_fileMutex);
+            if (_file) {
+                _write_file(line, len);
+            }
+        }
+    }
+
+    if (dart) {
+        lock_guard<mutex> lock(_dartMutex);
+        if (_dartRecords.size() >= DART_QUEUE_MAX) {
+            // Dart is not keeping up: keep the newest records
+            _dartRecords.pop_front();
+            _dropped.fetch_add(1, memory_order_relaxed);
+        }
+        _dartRecords.push_back(record);
+    }
+}
+
+void LogPipeline::_write_file(const char* line, size_t len) {
+    if (_maxFileBytes > 0 && _fileBytes > 0 && _fileBytes + len > _maxFileBytes) {
+        _rotate();
+        if (!_file) return;
+    }
+    _fileBytes += fwrite(line, 1, len, _file);
+}
+
+void LogPipeline::_rotate() {
+    fclose(_file);
+    for (unsigned i = _maxFiles; i > 1; i--) {
+        string from = _filePath + "." + to_string(i - 1);
+        string to = _filePath + "." + to_string(i);
+        rename(from.c_str(), to.c_str());
+    }
+    if (_maxFiles > 0) {
+        rename(_filePath.c_str(), (_filePath + ".1").c_str());
+    }
+    _file = fopen(_filePath.c_str(), "w");
+    if (_file) {
+        setvbuf(_file, nullptr, _IOFBF, 1 << 16);
+    }
+    _fileBytes = 0;
+}
+
+uint64_t LogPipeline::_wall_us() {
+    // CLOCK_REALTIME is read through the vDSO: no syscall on the logging threads
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
@@ -0,0 +1,246 @@
+#ifndef LOG_PIPELINE_H
+#define LOG_PIPELINE_H
+
+#include <pjsua2.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define PJSUA2_LOG_MSG_MAX 496
+
+/**
+ * @brief Destination of log records, each with its own level.
+ */
+typedef enum {
+    PJSUA2_LOG_CONSOLE = 0, /**< stdout */
+    PJSUA2_LOG_FILE = 1,    /**< Rotating file opened with pjsua2_log_open_file() */
+    PJSUA2_LOG_DART = 2,    /**< Batches drained by pjsua2_poll_logs() */
+    PJSUA2_LOG_SINK_COUNT = 3
+} LogSink;
+
+/**
+ * @brief Fixed-size log record (512 bytes), as exported to Dart.
+ */
+typedef struct {
+    uint64_t timestamp_us;          /**< Wall-clock time, microseconds since the epoch */
+    int32_t level;                  /**< PJSIP log level 1 (error) to 6 */
+    uint32_t repeated;              /**< Identical messages suppressed and summarised by this record, 0 for a normal record */
+    char msg[PJSUA2_LOG_MSG_MAX];   /**< NUL-terminated message, truncated if longer */
+} LogRecord;
+
+
+/**
+ * @brief Asynchronous log pipeline behind the PJSIP log writer.
+ *
+ * PJSIP threads only copy the message into a preallocated lock-free ring
+ * (no allocation, no lock, no syscall); a background thread drains it every
+ * few milliseconds to stdout, a size-rotated file and a bounded queue for
+ * Dart, each filtered by its own level. When the ring is full records are
+ * dropped and counted.
+ *
+ * Repeated messages are rate limited: after `burst` identical messages in a
+ * window the rest are suppressed, and a single record carrying the
+ * suppressed count is emitted when the window ends.
+ */
+class LogPipeline {
+public:
+    /**
+     * @brief Construct a new LogPipeline and start its thread
+     *
+     * @param capacity Ring size in records, rounded up to a power of two
+     */
+    explicit LogPipeline(size_t capacity = 1024);
+
+    /**
+     * @brief Flush pending records, stop the thread and close the file
+     */
+    ~LogPipeline();
+
+    LogPipeline(const LogPipeline&) = delete;
+    LogPipeline& operator=(const LogPipeline&) = delete;
+
+    /**
+     * @brief New writer to hand to LogConfig::writer
+     *
+     * The endpoint deletes the writer in libDestroy(), so it is a separate
+     * object forwarding to this pipeline, which must outlive the endpoint.
+     */
+    pj::LogWriter* make_writer();
+
+    /**
+     * @brief Queue a message (any thread, never blocks)
+     *
+     * @param level Log level
+     * @param msg Message, trailing newline ignored
+     * @param len Length of msg
+     */
+    void write(int level, const char* msg, size_t len);
+
+    /**
+     * @brief Queue a message (any thread, never blocks)
+     */
+    void write(int level, const std::string& msg) { write(level, msg.data(), msg.size()); }
+
+    /**
+     * @brief Set the level of a sink; 0 turns it off
+     */
+    void set_level(LogSink sink, int level);
+
+    /**
+     * @brief Level of a sink
+     */
+    int level(LogSink sink) const;
+
+    /**
+     * @brief Highest level any sink wants, the level PJSIP should log at
+     */
+    int max_level() const;
+
+    /**
+     * @brief Limit identical messages to burst per window; burst 0 disables
+     */
+    void set_rate_limit(unsigned burst, unsigned window_ms);
+
+    /**
+     * @brief Write to a file, rotated to path.1 ... path.max_files at max_bytes
+     *
+     * @param path File path, appended to if it exists
+     * @param max_bytes Size that triggers a rotation, 0 never rotates
+     * @param max_files Rotated files kept
+     * @return true if the file could be opened
+     */
+    bool open_file(const std::string& path, size_t max_bytes, unsigned max_files);
+
+    /**
+     * @brief Flush and close the log file
+     */
+    void close_file();
+
+    /**
+     * @brief Drain up to max records queued for Dart (oldest first)
+     *
+     * @return int Number of records copied
+     */
+    int poll(LogRecord* out, int max);
+
+    /**
+     * @brief Records dropped because the ring or the Dart queue was full
+     */
+    uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Messages suppressed by the rate limiter
+     */
+    uint64_t suppressed() const { return _suppressed.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t RATE_SLOTS = 64;      /**< Rate limiter table size */
+    static const size_t DART_QUEUE_MAX = 1024; /**< Records kept for Dart */
+    static const unsigned DRAIN_MS = 20;      /**< Drain period */
+
+    struct Cell {
+        std::atomic<size_t> sequence; /**< Vyukov sequence number */
+        LogRecord record;             /**< Stored record */
+        uint32_t slot;                /**< Rate limiter slot of the message */
+    };
+
+    struct RateSlot {
+        std::atomic<uint64_t> hash{0};       /**< Message hash owning the slot */
+        std::atomic<uint64_t> windowUs{0};   /**< Start of the current window */
+        std::atomic<uint32_t> count{0};      /**< Messages in the window */
+        std::atomic<uint32_t> suppressed{0}; /**< Messages dropped in the window */
+        std::atomic<int> level{0};           /**< Level of the message */
+    };
+
+    /**
+     * @brief Forwards PJSIP log entries to the pipeline
+     */
+    class Writer : public pj::LogWriter {
+    private:
+        LogPipeline& m_pipeline; /**< Owning pipeline */
+    public:
+        explicit Writer(LogPipeline& pipeline) : m_pipeline(pipeline) {}
+        virtual void write(const pj::LogEntry &entry) override;
+    };
+
+    /**
+     * @brief Rate limiter decision for a message
+     *
+     * @param repeated Receives the count suppressed in the previous window
+     * @return true if the message passes
+     */
+    bool _admit(uint32_t slot, uint64_t hash, int level, uint64_t now_us, uint32_t& repeated);
+
+    /**
+     * @brief Copy a record into the ring
+     */
+    void _push(const LogRecord& record, uint32_t slot);
+
+    /**
+     * @brief Background thread body
+     */
+    void _run();
+
+    /**
+     * @brief Drain the ring and deliver to the sinks (log thread)
+     */
+    void _drain();
+
+    /**
+     * @brief Emit summaries of windows that ended with suppressed messages (log thread)
+     */
+    void _flush_suppressed(uint64_t now_us);
+
+    /**
+     * @brief Deliver one record to every sink whose level allows it (log thread)
+     */
+    void _deliver(const LogRecord& record);
+
+    /**
+     * @brief Append a formatted line to the file, rotating first if needed (file mutex held)
+     */
+    void _write_file(const char* line, size_t len);
+
+    /**
+     * @brief Shift path.N files up and start a new file (file mutex held)
+     */
+    void _rotate();
+
+    static uint64_t _wall_us();
+
+    std::unique_ptr<Cell[]> _cells;             /**< Preallocated ring storage */
+    size_t _mask;                               /**< Capacity - 1 */
+    alignas(64) std::atomic<size_t> _enqueuePos; /**< Next producer position */
+    alignas(64) size_t _dequeuePos;              /**< Next consumer position */
+    std::atomic<uint64_t> _dropped;             /**< Dropped record counter */
+    std::atomic<uint64_t> _suppressed;          /**< Suppressed message counter */
+
+    std::atomic<int> _levels[PJSUA2_LOG_SINK_COUNT]; /**< Level of each sink */
+    std::atomic<unsigned> _burst;               /**< Identical messages let through per window */
+    std::atomic<uint64_t> _windowUs;            /**< Rate limit window */
+    RateSlot _slots[RATE_SLOTS];                /**< Rate limiter state by message hash */
+    std::string _slotText[RATE_SLOTS];          /**< Last message seen per slot (log thread) */
+
+    std::mutex _fileMutex;                      /**< Guards the file */
+    FILE* _file;                                /**< Log file, null if none */
+    std::string _filePath;                      /**< Path of the log file */
+    size_t _fileBytes;                          /**< Size of the current file */
+    size_t _maxFileBytes;                       /**< Rotation threshold */
+    unsigned _maxFiles;                         /**< Rotated files kept */
+
+    std::mutex _dartMutex;                      /**< Guards _dartRecords */
+    std::deque<LogRecord> _dartRecords;         /**< Records awaiting pjsua2_poll_logs */
+
+    std::mutex _threadMutex;                    /**< Pairs with _wake */
+    std::condition_variable _wake;              /**< Stops the drain wait */
+    bool _stopping;                             /**< Thread must exit */
+    std::thread _thread;                        /**< Log thread */
+};
+
+#endif // LOG_PIPELINE_H
@@ -0,0 +1,218 @@
+#include "media_router.hpp"
+
+using namespace pj;
+using namespace std;
+
+MediaRouter::MediaRouter()
+    : _devicesStale(true), _hasSoundDevice(false), _headless(false), _nullDevActive(false) {
+    _accountRoutes.reserve(PJSUA_MAX_ACC);
+}
+
+void MediaRouter::set_account_route(int acc_handle, const MediaRoute& route) {
+    lock_guard<recursive_mutex> lock(_mutex);
+    _accountRoutes[acc_handle] = route;
+}
+
+void MediaRouter::remove_account(int acc_handle) {
+    lock_guard<recursive_mutex> lock(_mutex);
+    _accountRoutes.erase(acc_handle);
+}
+
+void MediaRouter::set_call_route(int index, const MediaRoute& route) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    lock_guard<recursive_mutex> lock(_mutex);
+    _calls[index].route = route;
+    _calls[index].hasRoute = true;
+}
+
+void MediaRouter::clear_call_route(int index) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    lock_guard<recursive_mutex> lock(_mutex);
+    _calls[index].route = MediaRoute();
+    _calls[index].hasRoute = false;
+}
+
+MediaRoute MediaRouter::route_for(int index, int acc_handle) const {
+    lock_guard<recursive_mutex> lock(_mutex);
+    if (index >= 0 && index < PJSUA_MAX_CALLS && _calls[index].hasRoute) {
+        return _calls[index].route;
+    }
+    auto it = _accountRoutes.find(acc_handle);
+    if (it != _accountRoutes.end()) {
+        return it->second;
+    }
+    MediaRoute route;
+    if (_headless) {
+        route.mode = MEDIA_ROUTE_NULL;
+    }
+    return route;
+}
+
+void MediaRouter::connect(int index, int acc_handle, AudioMedia& media, AudioMedia* peer) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    lock_guard<recursive_mutex> lock(_mutex);
+    CallMedia& call = _calls[index];
+    MediaRoute route = route_for(index, acc_handle);
+
+    _disconnect(call, media);
+
+    switch (route.mode) {
+        case MEDIA_ROUTE_SOUND_DEVICE:
+            {
+                if (_headless || !_has_sound_device()) {
+                    throw Error(PJ_ENOTFOUND, "Media Error", "No sound device available", __FILE__, __LINE__);
+                }
+                _open_sound_device();
+                AudDevManager& audioDevManager = Endpoint::instance().audDevManager();
+                media.startTransmit(audioDevManager.getPlaybackDevMedia());
+                audioDevManager.getCaptureDevMedia().startTransmit(media);
+            }
+            break;
+        case MEDIA_ROUTE_NULL:
+            break;
+        case MEDIA_ROUTE_FILE:
+            _ensure_clock();
+            call.player.reset(new AudioMediaPlayer());
+            call.player->createPlayer(route.filePath);
+            call.player->startTransmit(media);
+            break;
+        case MEDIA_ROUTE_TONE:
+            {
+                _ensure_clock();
+                call.tone.reset(new ToneGenerator());
+                call.tone->createToneGenerator();
+                ToneDesc desc;
+                desc.freq1 = (short)route.toneFreq;
+                desc.freq2 = 0;
+                desc.on_msec = 1000;
+                desc.off_msec = 0;
+                desc.volume = 0;
+                desc.flags = 0;
+                call.tone->play(ToneDescVector(1, desc), true);
+                call.tone->startTransmit(media);
+            }
+            break;
+        case MEDIA_ROUTE_BRIDGE:
+            _ensure_clock();
+            if (peer) {
+                // Either side may come up first; the second one makes the link
+                media.startTransmit(*peer);
+                peer->startTransmit(media);
+                call.peer = *peer;
+                call.hasPeer = true;
+            }
+            break;
+        case MEDIA_ROUTE_CONFERENCE:
+            // The room links the call once the manager attaches its port
+            _ensure_clock();
+            break;
+    }
+    call.connected = route.mode;
+}
+
+void MediaRouter::_disconnect(CallMedia& call, AudioMedia& media) {
+    // Ports may already be gone (peer hung up): ignore failures while unlinking
+    try {
+        switch (call.connected) {
+            case MEDIA_ROUTE_SOUND_DEVICE:
+                {
+                    AudDevManager& audioDevManager = Endpoint::instance().audDevManager();
+                    media.stopTransmit(audioDevManager.getPlaybackDevMedia());
+                    audioDevManager.getCaptureDevMedia().stopTransmit(media);
+                }
+                break;
+            case MEDIA_ROUTE_BRIDGE:
+                if (call.hasPeer) {
+                    media.stopTransmit(call.peer);
+                    call.peer.stopTransmit(media);
+                }
+                break;
+            default:
+                break;
+        }
+    } catch (const Error&) {
+    }
+    call.player.reset();
+    call.tone.reset();
+    call.hasPeer = false;
+    call.connected = MEDIA_ROUTE_NULL;
+}
+
+bool MediaRouter::local_source(int index, AudioMedia& out) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return false;
+    lock_guard<recursive_mutex> lock(_mutex);
+    CallMedia& call = _calls[index];
+    switch (call.connected) {
+        case MEDIA_ROUTE_SOUND_DEVICE:
+            out = Endpoint::instance().audDevManager().getCaptureDevMedia();
+            return true;
+        case MEDIA_ROUTE_FILE:
+            if (!call.player) return false;
+            out = *call.player;
+            return true;
+        case MEDIA_ROUTE_TONE:
+            if (!call.tone) return false;
+            out = *call.tone;
+            return true;
+        case MEDIA_ROUTE_BRIDGE:
+            if (!call.hasPeer) return false;
+            out = call.peer;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void MediaRouter::call_ended(int index) {
+    if (index < 0 || index >= PJSUA_MAX_CALLS) return;
+    lock_guard<recursive_mutex> lock(_mutex);
+    CallMedia& call = _calls[index];
+    call.player.reset();
+    call.tone.reset();
+    call.hasPeer = false;
+    call.hasRoute = false;
+    call.route = MediaRoute();
+    call.connected = MEDIA_ROUTE_NULL;
+}
+
+void MediaRouter::refresh_devices() {
+    lock_guard<recursive_mutex> lock(_mutex);
+    _devicesStale = true;
+}
+
+void MediaRouter::set_headless(bool headless) {
+    lock_guard<recursive_mutex> lock(_mutex);
+    _headless = headless;
+    if (headless) {
+        _ensure_clock();
+    } else if (_has_sound_device()) {
+        // Otherwise the null device keeps clocking file, tone and bridge routes
+        _open_sound_device();
+    }
+}
+
+bool MediaRouter::_has_sound_device() {
+    if (_devicesStale) {
+        AudDevManager& audioDevManager = Endpoint::instance().audDevManager();
+        audioDevManager.refreshDevs();
+        _hasSoundDevice = audioDevManager.getDevCount() > 0;
+        _devicesStale = false;
+    }
+    return _hasSoundDevice;
+}
+
+void MediaRouter::_ensure_clock() {
+    if (_nullDevActive) return;
+    if (_headless || !_has_sound_device()) {
+        Endpoint::instance().audDevManager().setNullDev();
+        _nullDevActive = true;
+    }
+}
+
+void MediaRouter::_open_sound_device() {
+    if (!_nullDevActive) return;
+    AudDevManager& audioDevManager = Endpoint::instance().audDevManager();
+    audioDevManager.setCaptureDev(PJMEDIA_AUD_DEFAULT_CAPTURE_DEV);
+    audioDevManager.setPlaybackDev(PJMEDIA_AUD_DEFAULT_PLAYBACK_DEV);
+    _nullDevActive = false;
+}
@@ -0,0 +1,155 @@
+#ifndef MEDIA_ROUTER_H
+#define MEDIA_ROUTER_H
+
+#include <pjsua2.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Where the audio of a call is routed.
+ */
+typedef enum {
+    MEDIA_ROUTE_SOUND_DEVICE = 0, /**< Local capture/playback device (default) */
+    MEDIA_ROUTE_NULL = 1,         /**< Not connected; no sound device needed */
+    MEDIA_ROUTE_FILE = 2,         /**< Loop a WAV file into the call */
+    MEDIA_ROUTE_TONE = 3,         /**< Play a continuous tone into the call */
+    MEDIA_ROUTE_BRIDGE = 4,       /**< Connect directly to another call */
+    MEDIA_ROUTE_CONFERENCE = 5    /**< Linked by a conference room (see ConferenceRooms) */
+} MediaRouteMode;
+
+/**
+ * @brief Routing choice for an account or a call.
+ */
+struct MediaRoute {
+    MediaRouteMode mode = MEDIA_ROUTE_SOUND_DEVICE; /**< Routing mode */
+    std::string filePath;                           /**< WAV file for MEDIA_ROUTE_FILE */
+    unsigned toneFreq = 425;                        /**< Tone frequency in Hz for MEDIA_ROUTE_TONE */
+    int peerHandle = -1;                            /**< Peer call handle for MEDIA_ROUTE_BRIDGE */
+    int roomId = 0;                                 /**< Room for MEDIA_ROUTE_CONFERENCE */
+};
+
+
+/**
+ * @brief Connects call audio according to per-account and per-call routes.
+ *
+ * The sound device list is enumerated once and only re-enumerated after
+ * refresh_devices() (hot-plug), instead of on every media update. When no
+ * sound device is present, or headless mode is set, the null audio device
+ * clocks the conference bridge so file, tone and bridge routes still run;
+ * the default devices are reopened by the next sound device route.
+ * Indices are pjsua call indices.
+ */
+class MediaRouter {
+public:
+    MediaRouter();
+
+    /**
+     * @brief Default route for calls of an account
+     */
+    void set_account_route(int acc_handle, const MediaRoute& route);
+
+    /**
+     * @brief Forget the default route of a removed account
+     */
+    void remove_account(int acc_handle);
+
+    /**
+     * @brief Override the route of one call
+     */
+    void set_call_route(int index, const MediaRoute& route);
+
+    /**
+     * @brief Drop the override of one call, back to the account default
+     */
+    void clear_call_route(int index);
+
+    /**
+     * @brief Route in effect for a call (call override, else account default)
+     */
+    MediaRoute route_for(int index, int acc_handle) const;
+
+    /**
+     * @brief Connect a call's audio to its route
+     *
+     * Any previous connection of the call is removed first, so this is also
+     * used to re-route a live call.
+     *
+     * @param index pjsua call index
+     * @param acc_handle Account owning the call
+     * @param media Audio media of the call
+     * @param peer Audio media of the bridged call, nullptr if not active yet
+     * @throw pj::Error on failure
+     */
+    void connect(int index, int acc_handle, pj::AudioMedia& media, pj::AudioMedia* peer);
+
+    /**
+     * @brief Audio currently sent to a call by its route
+     *
+     * @param index pjsua call index
+     * @param out Receives the source (device capture, file, tone or peer)
+     * @return true if the route has a local source
+     */
+    bool local_source(int index, pj::AudioMedia& out);
+
+    /**
+     * @brief Release per-call resources once the call is disconnected
+     */
+    void call_ended(int index);
+
+    /**
+     * @brief Mark the cached device list stale (audio device hot-plug)
+     */
+    void refresh_devices();
+
+    /**
+     * @brief Never open a sound device; clock the bridge with the null device
+     *
+     * Leaving headless mode reopens the default devices if one is present;
+     * without one the null device stays and sound device routes are refused.
+     */
+    void set_headless(bool headless);
+
+private:
+    struct CallMedia {
+        MediaRoute route;                              /**< Per-call override */
+        bool hasRoute = false;                         /**< route is set */
+        MediaRouteMode connected = MEDIA_ROUTE_NULL;   /**< What is currently connected */
+        bool hasPeer = false;                          /**< peer is connected */
+        pj::AudioMedia peer;                           /**< Bridged peer media */
+        std::unique_ptr<pj::AudioMediaPlayer> player;  /**< File source */
+        std::unique_ptr<pj::ToneGenerator> tone;       /**< Tone source */
+    };
+
+    /**
+     * @brief Remove the current connections of a call (lock held)
+     */
+    void _disconnect(CallMedia& call, pj::AudioMedia& media);
+
+    /**
+     * @brief Re-enumerate devices if stale; returns true if a sound device exists (lock held)
+     */
+    bool _has_sound_device();
+
+    /**
+     * @brief Make sure something clocks the conference bridge (lock held)
+     */
+    void _ensure_clock();
+
+    /**
+     * @brief Replace the null device with the default sound devices (lock held)
+     */
+    void _open_sound_device();
+
+    mutable std::recursive_mutex _mutex;              /**< Guards all routing state */
+    CallMedia _calls[PJSUA_MAX_CALLS];                /**< Indexed by pjsua call index */
+    std::unordered_map<int, MediaRoute> _accountRoutes; /**< Account defaults */
+    bool _devicesStale;                               /**< Device list must be re-enumerated */
+    bool _hasSoundDevice;                             /**< Cached enumeration result */
+    bool _headless;                                   /**< Never use the sound device */
+    bool _nullDevActive;                              /**< Null device installed */
+};
+
+#endif // MEDIA_ROUTER_H
@@ -1,33 +1,154 @@
 #include "pjsua2_manager.hpp"
 
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+
+PJSUA2Manager::PJSUA2Account::~PJSUA2Account() {
+    lock_guard<mutex> lock(m_timerMutex);
+    if (m_timerArmed) {
+        Endpoint::instance().utilTimerCancel(m_timer);
+        m_timerArmed = false;
+    }
+}
+
+void PJSUA2Manager::PJSUA2Account::start(const AccountConfig& config, bool make_default) {
+    m_config = config;
+    m_config.regConfig.registrarUri = m_registrars.current();
+    create(m_config, make_default);
+}
+
+bool PJSUA2Manager::PJSUA2Account::update(const string& sip_user, const string& sip_password, const string& sip_domain,
+                                          const vector<string>& registrars, const RegistrationConfig* reg_config) {
+    const string& user = sip_user.empty() ? m_sipUser : sip_user;
+    const string& domain = sip_domain.empty() ? m_sipDomain : sip_domain;
+    AccountConfig config = m_config;
+    bool changed = false;
+
+    if (user != m_sipUser || domain != m_sipDomain) {
+        config.idUri = "sip:" + user + "@" + domain;
+        changed = true;
+    }
+    for (AuthCredInfo& cred : config.sipConfig.authCreds) {
+        if (cred.username != user || (!sip_password.empty() && cred.data != sip_password)) {
+            cred.username = user;
+            if (!sip_password.empty()) cred.data = sip_password;
+            changed = true;
+        }
+    }
+
+    vector<string> uris = registrars;
+    if (uris.empty() && m_defaultRegistrar && domain != m_sipDomain) {
+        uris.push_back("sip:" + domain);
+    }
+    bool timers = reg_config && memcmp(reg_config, &m_regConfig, sizeof(m_regConfig)) != 0;
+    if (timers) {
+        RegistrarPool::apply_timers(*reg_config, config);
+    }
+    if ((!uris.empty() && uris != m_registrars.uris()) || timers) {
+        m_registrars.reset(uris.empty() ? m_registrars.uris() : uris, timers ? *reg_config : m_regConfig);
+        config.regConfig.registrarUri = m_registrars.current();
+        changed = true;
+    }
+    if (!changed) return false;
+
+    // pjsua keeps the account's calls across modify() and re-registers with the new settings
+    modify(config);
+    m_config = config;
+    m_sipUser = user;
+    m_sipDomain = domain;
+    if (!registrars.empty()) m_defaultRegistrar = false;
+    if (timers) m_regConfig = *reg_config;
+    return true;
+}
+
+void PJSUA2Manager::PJSUA2Account::_schedule(unsigned msec) {
+    lock_guard<mutex> lock(m_timerMutex);
+    Endpoint& endpoint = Endpoint::instance();
+    if (m_timerArmed) {
+        endpoint.utilTimerCancel(m_timer);
+    }
+    // The id may not be assigned yet when create() starts registering: identify by address
+    m_timer = endpoint.utilTimerSchedule(msec, static_cast<Token>(this));
+    m_timerArmed = true;
+}
+
+void PJSUA2Manager::PJSUA2Account::on_registrar_timer() {
+    {
+        lock_guard<mutex> lock(m_timerMutex);
+        m_timerArmed = false;
+    }
+    if (m_registrars.timed_out(CallMetrics::now_us())) {
+        m_manager._push_event(PJSUA2_EVENT_REG_STATE, PJSIP_SC_REQUEST_TIMEOUT, 0, CallRegistry::INVALID_HANDLE, getId(),
+                              "Registrar timeout (" + m_registrars.current() + ")");
+    }
+    string uri;
+    if (m_registrars.take_switch(uri)) {
+        // modify() drops the old registration and registers with the new registrar
+        m_config.regConfig.registrarUri = uri;
+        modify(m_config);
+    }
+}
+
+void PJSUA2Manager::PJSUA2Account::onRegStarted(OnRegStartedParam &prm) {
+    m_manager._trace.record(PJSUA2_TRACE_REG_STARTED, (TraceOp)0, -1, CallRegistry::INVALID_HANDLE, getId(), 0, prm.renew ? 1 : 0);
+    m_registrars.started(prm.renew, CallMetrics::now_us());
+    unsigned timeout = m_registrars.register_timeout_ms();
+    if (prm.renew && timeout > 0) {
+        _schedule(timeout);
+    }
+}
+
 void PJSUA2Manager::PJSUA2Account::onRegState(OnRegStateParam &prm) {
     AccountInfo info = getInfo();
-    if (m_manager._onRegStateCb) {
-        m_manager._onRegStateCb(prm.code, info.regIsActive ? "Active" : "Inactive", prm.reason.c_str());
+    uint64_t latency = 0;
+    string registrar;
+    bool failover = m_registrars.completed(prm.status, prm.code, prm.expiration, CallMetrics::now_us(), latency, registrar);
+    if (failover) {
+        // Switch from the timer callback, outside the registration callback
+        _schedule(0);
+    }
+
+    string reason = prm.reason + " (" + registrar;
+    if (latency) {
+        reason += ", " + to_string(latency / 1000) + " ms";
     }
+    reason += ")";
+    m_manager._trace.record(PJSUA2_TRACE_REG_STATE, (TraceOp)0, -1, CallRegistry::INVALID_HANDLE, getId(), prm.code,
+                            info.regIsActive ? 1 : 0, reason);
+    m_manager._on_reg_state(getId(), prm.code, info.regIsActive, reason);
 }
 
-void PJSUA2Manager::PJSUA2Account::onIncomingCall(OnIncomingCallParam &prm) {
-    if (!m_manager._account) {
-        throw Error(
-            PJ_EBUG, 
-            "Account Error", 
-            "Account not initialized", 
-            __FILE__, 
-            __LINE__
-        );
+void PJSUA2Manager::PJSUA2Endpoint::onTimer(const OnTimerParam &prm) {
+    if (prm.userData == static_cast<Token>(&m_manager._quality)) {
+        m_manager._on_quality_timer();
+    } else if (prm.userData == static_cast<Token>(&m_manager._admission)) {
+        m_manager._on_admission_timer();
+    } else {
+        m_manager._on_registrar_timer(prm.userData);
     }
-    auto call = make_unique<PJSUA2Manager::PJSUA2Call>(m_manager, *this, prm.callId);
-    string callId = call->getInfo().callIdString;
-        
-    {
-        lock_guard<recursive_mutex> lock(m_manager._inboundCallsMutex);
-        m_manager._inboundCalls[callId] = move(call);
+}
+
+void PJSUA2Manager::PJSUA2Account::onIncomingCall(OnIncomingCallParam &prm) {
+    AdmissionVerdict verdict = m_manager._admit_call(getId());
+    if (verdict != ADMISSION_ACCEPT) {
+        // No PJSUA2Call is attached: pjsua leaves the rejected call alone
+        m_manager._reject_call(prm.callId, verdict);
+        return;
     }
-                    
-    if (m_manager._onIncomingCallStateCb) {
-        m_manager._onIncomingCallStateCb(callId.c_str());
+    // pjsua already matched the INVITE to this account: tag the call with it
+    m_manager._metrics.call_started(prm.callId, false);
+    unique_ptr<PJSUA2Call> call(new (m_manager._callPool) PJSUA2Call(m_manager, *this, prm.callId));
+    CallInfo callInfo = call->getInfo();
+    // rdata is only valid during the callback: copy the routing headers now
+    string headers;
+    int dropped = 0;
+    pjsip_rx_data* rdata = static_cast<pjsip_rx_data*>(prm.rdata.pjRxData);
+    if (rdata) {
+        m_manager._inviteHeaders.extract(rdata->msg_info.msg, headers, &dropped);
     }
+    m_manager._trace.record_call(PJSUA2_TRACE_INCOMING_CALL, prm.callId, m_manager._calls.handle_of(prm.callId), callInfo);
+    m_manager._on_incoming_call(prm.callId, move(call), callInfo, getId(), headers, dropped);
 }
 
 PJSUA2Manager::PJSUA2Call::PJSUA2Call(PJSUA2Manager& manager, Account &acc, int call_id) : Call(acc, call_id), m_manager(manager) {}
@@ -36,17 +157,54 @@ void PJSUA2Manager::PJSUA2Call::onCallState(OnCallStateParam &prm) {
     PJ_UNUSED_ARG(prm);
 
     CallInfo callInfo = getInfo();
-            
-    if(m_manager._onCallStateCb){
-        m_manager._onCallStateCb(
-            callInfo.callIdString.c_str(),
-            callInfo.localUri.c_str(),
-            callInfo.remoteUri.c_str(),
-            callInfo.stateText.c_str()
+    int index = getId();
+    m_manager._trace.record_call(PJSUA2_TRACE_CALL_STATE, index, m_manager._calls.handle_of(index), callInfo);
+    m_manager._on_call_state(index, callInfo, this);
+    // A DISCONNECTED call has been deleted: nothing below may touch members
+}
+
+void PJSUA2Manager::_on_reg_state(int acc_handle, int code, bool active, const string& reason){
+    _push_event(PJSUA2_EVENT_REG_STATE, code, active ? 1 : 0, CallRegistry::INVALID_HANDLE, acc_handle, reason);
+    if (_onRegStateCb) {
+        _onRegStateCb(code, active ? "Active" : "Inactive", reason.c_str());
+    }
+}
+
+void PJSUA2Manager::_on_incoming_call(int index, unique_ptr<Call> call, const CallInfo& info, int acc_handle,
+                                      const string& headers, int dropped){
+    int handle = _calls.insert(index, move(call), CALL_DIR_INBOUND, info, acc_handle);
+
+    _push_call_event(PJSUA2_EVENT_INCOMING_CALL, dropped, PJSIP_INV_STATE_INCOMING, index, handle, info, headers);
+    if (_onIncomingCallStateCb) {
+        _onIncomingCallStateCb(info.callIdString.c_str());
+    }
+}
+
+void PJSUA2Manager::_on_call_state(int index, const CallInfo& info, Call* call){
+    _calls.update(index, info);
+    if (info.state == PJSIP_INV_STATE_CALLING) {
+        _metrics.call_started(index, true);
+    }
+    _metrics.call_state(index, info.state);
+
+    _push_call_event(
+        PJSUA2_EVENT_CALL_STATE,
+        info.lastStatusCode,
+        info.state,
+        index,
+        _calls.handle_of(index),
+        info
+    );
+    if(_onCallStateCb){
+        _onCallStateCb(
+            info.callIdString.c_str(),
+            info.localUri.c_str(),
+            info.remoteUri.c_str(),
+            info.stateText.c_str()
         );
     }
     
-    switch(callInfo.state){
+    switch(info.state){
         case PJSIP_INV_STATE_NULL:
             break;
         case PJSIP_INV_STATE_CALLING:
@@ -56,51 +214,33 @@ void PJSUA2Manager::PJSUA2Call::onCallState(OnCallStateParam &prm) {
         case PJSIP_INV_STATE_EARLY:
             break;
         case PJSIP_INV_STATE_CONNECTING:
-            {
-                lock_guard<recursive_mutex> lock(m_manager._inboundCallsMutex);
-                string callId = callInfo.callIdString;
-
-                if (auto it = m_manager._inboundCalls.find(callId); it != m_manager._inboundCalls.end()) {
-                    lock_guard<recursive_mutex> lock(m_manager._activeCallsMutex);
-                    m_manager._activeCalls[callId] = std::move(it->second);
-                    m_manager._inboundCalls.erase(it);
-                }
-                break;
-            }
-            {   
-                lock_guard<recursive_mutex> lock(m_manager._inboundCallsMutex);
-                string callId = callInfo.callIdString;
-
-                if (auto it = m_manager._outboundCalls.find(callId); it != m_manager._outboundCalls.end()) {
-                    lock_guard<recursive_mutex> lock(m_manager._activeCallsMutex);
-                    m_manager._activeCalls[callId] = std::move(it->second);
-                    m_manager._outboundCalls.erase(it);
-                    break;
-                }
-            }
+            _calls.set_state(index, CALL_SLOT_ACTIVE);
             break;
-               
-
         case PJSIP_INV_STATE_CONFIRMED:
-                    break;
+            if (_codecs.take_reoffer(index)) {
+                _submit_reoffer(index);
+            }
+            break;
         case PJSIP_INV_STATE_DISCONNECTED:
-                    string callId = callInfo.callIdString;
-                    {
-                        lock_guard<recursive_mutex> lock(m_manager._activeCallsMutex);
-                        m_manager._activeCalls.erase(callId);
-                    }
-                    // delete call from all maps
-                    {
-                        lock_guard<recursive_mutex> lock(m_manager._outboundCallsMutex);
-                        m_manager._inboundCalls.erase(callId);
-                    }
-                    {
-                        lock_guard<recursive_mutex> lock(m_manager._inboundCallsMutex);
-                        m_manager._outboundCalls.erase(callId);
+            {
+                _recorder.stop(index);
+                _taps.stop(index);
+                _codecs.call_ended(index);
+                _quality.call_ended(index);
+                _rooms.call_ended(index);
+                _media.call_ended(index);
+                shared_ptr<Call> owned;
+                {
+                    lock_guard<recursive_mutex> lock(_calls.mutex());
+                    if (_calls.get(_calls.handle_of(index)) == call) {
+                        owned = _calls.release(index);
                     }
-
-                    break;
+                }
+                // owned deletes the call object on scope exit, unless a
+                // command still has it pinned
             }
+            break;
+    }
 }
 
 void PJSUA2Manager::PJSUA2Call::onCallMediaState(OnCallMediaStateParam &prm) {
@@ -108,13 +248,20 @@ void PJSUA2Manager::PJSUA2Call::onCallMediaState(OnCallMediaStateParam &prm) {
     // bind media
     for(unsigned i = 0; i < callInfo.media.size(); i++){
         if(callInfo.media[i].type == PJMEDIA_TYPE_AUDIO){
+            bool active = callInfo.media[i].status == PJSUA_CALL_MEDIA_ACTIVE;
+            m_manager._trace.record(PJSUA2_TRACE_MEDIA_STATE, (TraceOp)0, getId(), m_manager._calls.handle_of(getId()),
+                                    callInfo.accId, 0, active ? 1 : 0);
+            if (active) {
+                m_manager._metrics.media_active(getId());
+                m_manager._codecs.media_codec(getId(), getStreamInfo(i).codecName);
+                if (callInfo.state == PJSIP_INV_STATE_CONFIRMED && m_manager._codecs.take_reoffer(getId())) {
+                    m_manager._submit_reoffer(getId());
+                }
+            }
             try{
                 AudioMedia aud_media = getAudioMedia(i);
-                // Connect the call audio media to the sound device
-                AudDevManager& audioDevManager = Endpoint::instance().audDevManager();
-                audioDevManager.refreshDevs();
-                aud_media.startTransmit(audioDevManager.getPlaybackDevMedia());
-                audioDevManager.getCaptureDevMedia().startTransmit(aud_media);
+                // Connect the call audio media to its route (sound device by default)
+                m_manager._route_media(getId(), callInfo.accId, aud_media);
 
             }catch(const Error &e){
                 // if _onError is binded call them
@@ -134,7 +281,30 @@ PJSUA2Manager::PJSUA2Manager(
         DartOnRegStateCb onRegStateCb,
         DartCallStateCb onCallStateCb,
         DartOnErrorCb onErrorCb
-):  _isRunning(false),_endpoint(nullptr), _account(nullptr){
+):  PJSUA2Manager(sip_user, sip_password, sip_domain, default_config(),
+                  onIncomingCallCb, onRegStateCb, onCallStateCb, onErrorCb){
+}
+
+PJSUA2Manager::PJSUA2Manager(
+    const string& sip_user,
+        const string& sip_password,
+        const string& sip_domain,
+        const ManagerConfig& config,
+        DartIncomingCallStateCb onIncomingCallCb,
+        DartOnRegStateCb onRegStateCb,
+        DartCallStateCb onCallStateCb,
+        DartOnErrorCb onErrorCb
+):  _isRunning(false), _loopExited(true), _endpoint(nullptr), _defaultAccount(-1), _config(config){
+    _qualityIntervalMs.store(QUALITY_INTERVAL_MS, memory_order_relaxed);
+    _qualityDue.store(false, memory_order_relaxed);
+    _qualityTimer = nullptr;
+    _qualityTimerArmed = false;
+    _admissionTimer = nullptr;
+    _admissionTimerArmed = false;
+    _admissionSampling = true;
+    for (atomic<int>& handle : _internedCalls) {
+        handle.store(CallRegistry::INVALID_HANDLE, memory_order_relaxed);
+    }
      // set callbacks
     _onIncomingCallStateCb = onIncomingCallCb;
     _onRegStateCb = onRegStateCb;
@@ -142,221 +312,1537 @@ PJSUA2Manager::PJSUA2Manager(
     _onErrorCb = onErrorCb;
 
     try{
-        _endpoint = unique_ptr<Endpoint>(new Endpoint());
-       
-        
-         // Initialize Endpoint
-        _endpoint->libCreate();
-         EpConfig epConfig;
-         epConfig.uaConfig.threadCnt = 1;
-         epConfig.uaConfig.maxCalls = 2;
-
-         epConfig.medConfig.ecOptions = PJMEDIA_ECHO_DEFAULT;
-         epConfig.medConfig.ecTailLen = 200;
-         epConfig.medConfig.quality = 10;
-         epConfig.medConfig.ptime = 20;
-
-         epConfig.logConfig.level = 3;
-
-         _endpoint->libInit(epConfig);
-
-         _endpoint->codecSetPriority("opus/48000/2", PJMEDIA_CODEC_PRIO_HIGHEST);
-         _endpoint->codecSetPriority("PCMU/8000/1", PJMEDIA_CODEC_PRIO_HIGHEST);
-         _endpoint->codecSetPriority("PCMA/8000/1", PJMEDIA_CODEC_PRIO_HIGHEST);
-
-         TransportConfig tcfg;
-         tcfg.port = 5060;
-         _endpoint->transportCreate(PJSIP_TRANSPORT_UDP, tcfg);
-
-         _endpoint->libStart();
-
-         AccountConfig accCfg;
-         std::string sipUri = "sip:" + sip_user + "@" + sip_domain;
-         std::string registrarUri = "sip:" + sip_domain;
-         accCfg.idUri = sipUri;
-         accCfg.regConfig.registrarUri = registrarUri;
-
-         AuthCredInfo cred("digest", "*", sip_user, 0, sip_password);
-         accCfg.sipConfig.authCreds.push_back(cred);
-
-         _account = make_unique<PJSUA2Account>(*this);
-         _sipDomain = sip_domain;
-         _sipUser = sip_user;
-         _account->create(accCfg);
+        if (_config.version == 0 || _config.version > PJSUA2_MANAGER_CONFIG_VERSION) {
+            throw Error(
+                PJ_EINVAL,
+                "Config Error",
+                "Unsupported ManagerConfig version",
+                __FILE__,
+                __LINE__
+            );
+        }
+        if (_config.version < 2) {
+            _config.memory_profile = PJSUA2_MEMORY_DEFAULT;
+        }
+        if (_config.max_calls > PJSUA_MAX_CALLS) {
+            // Also the size of the call registry: needs a PJSIP rebuilt with a larger PJSUA_MAX_CALLS
+            throw Error(PJ_ETOOMANY, "Config Error", "max_calls exceeds PJSUA_MAX_CALLS", __FILE__, __LINE__);
+        }
+        // TLS paths belong to the caller: keep copies to compare on reconfigure
+        _set_tls_files(_config);
+        _init(sip_user, sip_password, sip_domain);
     }catch (const Error &e){
         _handle_error(e);
          throw;
     }           
 }
 
+ManagerConfig PJSUA2Manager::default_config(){
+    ManagerConfig config;
+    memset(&config, 0, sizeof(config));
+    config.version = PJSUA2_MANAGER_CONFIG_VERSION;
+    config.max_calls = 2;
+    config.sip_thread_cnt = 1;
+    config.media_thread_cnt = 1;
+    config.udp_port = 5060;
+    config.tcp_port = -1;
+    config.tls_port = -1;
+    config.ec_tail_len = 200;
+    config.ec_options = PJMEDIA_ECHO_DEFAULT;
+    config.media_quality = 10;
+    config.clock_rate = 16000;
+    config.snd_clock_rate = 0;
+    config.ptime = 20;
+    config.log_level = 3;
+    config.memory_profile = PJSUA2_MEMORY_DEFAULT;
+    return config;
+}
+
+void PJSUA2Manager::_init(const string& sip_user, const string& sip_password, const string& sip_domain){
+    _endpoint = unique_ptr<Endpoint>(new PJSUA2Endpoint(*this));
 
-PJSUA2Manager::~PJSUA2Manager(){
-    stop_event_loop();
-    _activeCalls.clear();
-    if (_endpoint) {
-        _endpoint->libDestroy();
+     // Initialize Endpoint
+    _endpoint->libCreate();
+    EpConfig epConfig;
+    epConfig.uaConfig.threadCnt = _config.sip_thread_cnt;
+    epConfig.uaConfig.maxCalls = _config.max_calls;
+
+    epConfig.medConfig.threadCnt = _config.media_thread_cnt;
+    epConfig.medConfig.ecOptions = _config.ec_options;
+    epConfig.medConfig.ecTailLen = _config.ec_tail_len;
+    epConfig.medConfig.quality = _config.media_quality;
+    epConfig.medConfig.clockRate = _config.clock_rate;
+    epConfig.medConfig.sndClockRate = _config.snd_clock_rate;
+    epConfig.medConfig.ptime = _config.ptime;
+    if (_config.memory_profile == PJSUA2_MEMORY_LOW) {
+        // Jitter buffer in ms: enough for Wi-Fi jitter without desktop-sized frame buffers
+        epConfig.medConfig.jbMax = 240;
+        epConfig.medConfig.jbMaxPre = 160;
+        // Sound device plus a stream and one recorder, tap or player per call
+        epConfig.medConfig.maxMediaPorts = 3 * epConfig.uaConfig.maxCalls + 4;
+    }
+
+    // PJSIP threads only hand records to the pipeline; its thread does the I/O
+    _log.set_level(PJSUA2_LOG_CONSOLE, _config.log_level);
+    _log.set_level(PJSUA2_LOG_FILE, _config.log_level);
+    epConfig.logConfig.level = _log.max_level();
+    epConfig.logConfig.consoleLevel = 6;
+    epConfig.logConfig.decor = PJ_LOG_HAS_SENDER | PJ_LOG_HAS_INDENT;
+    epConfig.logConfig.writer = _log.make_writer();
+
+    _endpoint->libInit(epConfig);
+
+    if (_config.memory_profile == PJSUA2_MEMORY_LOW) {
+        // Give released pools back to the heap instead of caching up to the PJSIP default
+        pj_caching_pool* cp = reinterpret_cast<pj_caching_pool*>(pjsua_get_pool_factory());
+        cp->max_capacity = LOW_MEMORY_POOL_CACHE;
+    }
+    // Call objects live in slots allocated once for the configured call count
+    _callPool.reserve(epConfig.uaConfig.maxCalls, sizeof(PJSUA2Call));
+    _accounts.reserve(PJSUA_MAX_ACC);
+
+    {
+        lock_guard<mutex> lock(_codecs.table_mutex());
+        _apply_inbound_codecs();
     }
+
+    _waker.open();
+    _recorder.set_format(_config.clock_rate, _config.ptime);
+    _taps.set_format(_config.clock_rate, _config.ptime);
+
+    _configTransports[PJSIP_TRANSPORT_UDP] = _create_transport(PJSIP_TRANSPORT_UDP, _config.udp_port, nullptr, nullptr, nullptr);
+    _configTransports[PJSIP_TRANSPORT_TCP] = _create_transport(PJSIP_TRANSPORT_TCP, _config.tcp_port, nullptr, nullptr, nullptr);
+    _configTransports[PJSIP_TRANSPORT_TLS] = _create_transport(PJSIP_TRANSPORT_TLS, _config.tls_port,
+                                                               _config.tls_ca_file, _config.tls_cert_file, _config.tls_privkey_file);
+
+    _endpoint->libStart();
+    _schedule_quality_timer();
+    _schedule_admission_timer();
+
+    _defaultAccount = add_account(sip_user, sip_password, sip_domain);
 }
 
-void PJSUA2Manager::start_event_loop(unsigned timeout_ms){
-    _isRunning.store(true, std::memory_order_release);
-    _eventThread = thread([this, timeout_ms]() { 
-        if(!_endpoint->libIsThreadRegistered()){
-            char threadName[16];
-            pthread_getname_np(pthread_self(), threadName, sizeof(threadName));
-            std::string name = threadName;
-            _endpoint->libRegisterThread(threadName);
-        }
-        while (_isRunning.load(std::memory_order_relaxed)) {
-                _handle_events(timeout_ms); 
+AdmissionConfig PJSUA2Manager::default_admission_config(){
+    AdmissionConfig config;
+    memset(&config, 0, sizeof(config));
+    config.version = PJSUA2_ADMISSION_CONFIG_VERSION;
+    config.retry_after_sec = 5;
+    return config;
+}
+
+RegistrationConfig PJSUA2Manager::default_registration_config(){
+    RegistrationConfig config;
+    memset(&config, 0, sizeof(config));
+    config.version = PJSUA2_REGISTRATION_CONFIG_VERSION;
+    config.keep_alive_sec = -1;
+    config.failback_sec = 60;
+    return config;
+}
+
+int PJSUA2Manager::add_account(const string& sip_user, const string& sip_password, const string& sip_domain){
+    return add_account(sip_user, sip_password, sip_domain, vector<string>(), default_registration_config());
+}
+
+int PJSUA2Manager::add_account(const string& sip_user, const string& sip_password, const string& sip_domain,
+                               const vector<string>& registrars, const RegistrationConfig& reg_config){
+    try{
+        if (reg_config.version == 0 || reg_config.version > PJSUA2_REGISTRATION_CONFIG_VERSION) {
+            throw Error(PJ_EINVAL, "Account Error", "Unsupported RegistrationConfig version", __FILE__, __LINE__);
         }
-    });
+        AccountConfig accCfg;
+        std::string sipUri = "sip:" + sip_user + "@" + sip_domain;
+        accCfg.idUri = sipUri;
+        RegistrarPool::apply_timers(reg_config, accCfg);
+
+        // Refreshes reuse the registration's auth session, so only the first REGISTER is challenged
+        AuthCredInfo cred("digest", "*", sip_user, 0, sip_password);
+        accCfg.sipConfig.authCreds.push_back(cred);
+
+        auto account = make_unique<PJSUA2Account>(*this, sip_user, sip_domain, registrars, reg_config);
+        lock_guard<recursive_mutex> lock(_accountsMutex);
+        account->start(accCfg, _accounts.empty());
+        int acc_handle = account->getId();
+        _accounts[acc_handle] = move(account);
+        _trace.record(PJSUA2_TRACE_COMMAND, PJSUA2_TRACE_OP_ACCOUNT_ADD, -1, CallRegistry::INVALID_HANDLE, acc_handle, 0, 0,
+                      sip_user + "@" + sip_domain);
+        return acc_handle;
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
 }
 
-void PJSUA2Manager::_handle_events(unsigned timeout_ms) {
-    _endpoint->libHandleEvents(timeout_ms);
+void PJSUA2Manager::remove_account(int acc_handle){
+    try{
+        lock_guard<recursive_mutex> lock(_accountsMutex);
+        auto it = _accounts.find(acc_handle);
+        if (it == _accounts.end()) {
+            throw Error(
+                PJ_ENOTFOUND,
+                "Account Error",
+                "Unknown account handle",
+                __FILE__,
+                __LINE__
+            );
+        }
+        _trace.record(PJSUA2_TRACE_COMMAND, PJSUA2_TRACE_OP_ACCOUNT_REMOVE, -1, CallRegistry::INVALID_HANDLE, acc_handle, 0, 0);
+
+        // Calls keep a reference to their account: drop them first (Call's destructor hangs up)
+        int handles[CallRegistry::CAPACITY];
+        int count = _calls.collect(handles, CallRegistry::CAPACITY, acc_handle);
+        for (int i = 0; i < count; i++) {
+            shared_ptr<Call> call = _calls.release(CallRegistry::index_of(handles[i]));
+        }
+
+        _accounts.erase(it);
+        _media.remove_account(acc_handle);
+        _codecs.remove_account(acc_handle);
+        int expected = acc_handle;
+        _defaultAccount.compare_exchange_strong(expected, -1);
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
 }
 
-void PJSUA2Manager::stop_event_loop(){
-    _isRunning = false;
-    if (_eventThread.joinable()) {
-        _eventThread.join();
-        _endpoint->libStopWorkerThreads();
+bool PJSUA2Manager::update_account(int acc_handle, const string& sip_user, const string& sip_password,
+                                   const string& sip_domain, const vector<string>& registrars,
+                                   const RegistrationConfig* reg_config){
+    try{
+        if (reg_config && (reg_config->version == 0 || reg_config->version > PJSUA2_REGISTRATION_CONFIG_VERSION)) {
+            throw Error(PJ_EINVAL, "Account Error", "Unsupported RegistrationConfig version", __FILE__, __LINE__);
+        }
+        lock_guard<recursive_mutex> lock(_accountsMutex);
+        auto it = _accounts.find(acc_handle);
+        if (it == _accounts.end()) {
+            throw Error(PJ_ENOTFOUND, "Account Error", "Unknown account handle", __FILE__, __LINE__);
+        }
+        return it->second->update(sip_user, sip_password, sip_domain, registrars, reg_config);
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
     }
 }
 
-void PJSUA2Manager::_handle_error(const Error &e){
-    if(_onErrorCb){
-        _onErrorCb(
-            e.title.c_str(),
-            e.reason.c_str(),
-            e.info(true).c_str(),
-            e.srcFile.c_str(),
-            e.srcLine
-        );
-    }else{
-        cout << e.title << endl;
-        cout <<  e.reason << endl;
-        cout << e.info(true) << endl;
-        cout << e.srcFile<< endl;
-        cout << e.srcLine << endl;
+int PJSUA2Manager::get_registrar_stats(int acc_handle, RegistrarStats* out, int cap){
+    try{
+        lock_guard<recursive_mutex> lock(_accountsMutex);
+        auto it = _accounts.find(acc_handle);
+        if (it == _accounts.end()) {
+            throw Error(PJ_ENOTFOUND, "Account Error", "Unknown account handle", __FILE__, __LINE__);
+        }
+        return it->second->registrars().stats(out, cap, CallMetrics::now_us());
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
     }
 }
 
-string PJSUA2Manager::make_call(const string& dest_uri){
+void PJSUA2Manager::_on_registrar_timer(Token account){
     try{
-        auto newCall =make_unique<PJSUA2Call>(*this, *_account, 0);
-        CallOpParam prm(true); // Use default call settings
-        string sipFullDestUri = "sip:"+dest_uri+"@"+_sipDomain;
+        lock_guard<recursive_mutex> lock(_accountsMutex);
+        // Only dereference accounts that are still registered with the manager
+        for (auto& entry : _accounts) {
+            if (static_cast<Token>(entry.second.get()) == account) {
+                entry.second->on_registrar_timer();
+                break;
+            }
+        }
+    }catch(const Error &e){
+        _handle_error(e);
+    }
+}
+
+int PJSUA2Manager::default_account() const{
+    return _defaultAccount.load();
+}
+
+int PJSUA2Manager::_create_transport(pjsip_transport_type_e type, int port, const char* tls_ca_file,
+                                     const char* tls_cert_file, const char* tls_privkey_file){
+    if (port < 0) {
+        return -1;
+    }
+    TransportConfig tcfg;
+    tcfg.port = (unsigned)port;
+    if (type == PJSIP_TRANSPORT_TLS) {
+        if (tls_ca_file) tcfg.tlsConfig.CaListFile = tls_ca_file;
+        if (tls_cert_file) tcfg.tlsConfig.certFile = tls_cert_file;
+        if (tls_privkey_file) tcfg.tlsConfig.privKeyFile = tls_privkey_file;
+    }
+    return _endpoint->transportCreate(type, tcfg);
+}
 
-        newCall->makeCall(sipFullDestUri, prm);
-        string callId = newCall->getInfo().callIdString;
-        lock_guard<recursive_mutex> lock(_outboundCallsMutex);
-        _outboundCalls[callId] = move(newCall);
-        return callId;
+int PJSUA2Manager::add_transport(pjsip_transport_type_e type, int port, const char* tls_ca_file,
+                                 const char* tls_cert_file, const char* tls_privkey_file){
+    try{
+        if (port < 0 || (type != PJSIP_TRANSPORT_UDP && type != PJSIP_TRANSPORT_TCP && type != PJSIP_TRANSPORT_TLS)) {
+            throw Error(PJ_EINVAL, "Transport Error", "Unsupported transport type or port", __FILE__, __LINE__);
+        }
+        return _create_transport(type, port, tls_ca_file, tls_cert_file, tls_privkey_file);
     }catch(const Error &e){
         _handle_error(e);
         throw;
     }
 }
 
-void PJSUA2Manager::answer_call(const string& call_id){
+void PJSUA2Manager::remove_transport(int transport_id){
     try{
-        lock_guard<recursive_mutex> lock(_inboundCallsMutex);
-        auto it = _inboundCalls.find(call_id);
-        if(it != _inboundCalls.end()){
-            CallOpParam prm;
-            prm.statusCode = PJSIP_SC_OK;
-            it->second.get()->answer(prm);
+        _endpoint->transportClose(transport_id);
+        for (auto& entry : _configTransports) {
+            if (entry.second == transport_id) {
+                entry.second = -1;
+            }
         }
-    }catch(Error &e){
+    }catch(const Error &e){
         _handle_error(e);
         throw;
     }
 }
 
-void PJSUA2Manager::hang_up_call(const string& call_id){
-    try {
+static const char* tls_path(const char* path){
+    return path ? path : "";
+}
 
-        // Helper function to handle hangup with appropriate status code
-        auto hangup_call = [](Call* call, pjsip_status_code default_code) {
-            CallInfo call_info = call->getInfo(); // Get current call state
-            CallOpParam prm;
+void PJSUA2Manager::_set_tls_files(const ManagerConfig& config){
+    _tlsFiles[0] = tls_path(config.tls_ca_file);
+    _tlsFiles[1] = tls_path(config.tls_cert_file);
+    _tlsFiles[2] = tls_path(config.tls_privkey_file);
+    _config.tls_ca_file = _tlsFiles[0].empty() ? nullptr : _tlsFiles[0].c_str();
+    _config.tls_cert_file = _tlsFiles[1].empty() ? nullptr : _tlsFiles[1].c_str();
+    _config.tls_privkey_file = _tlsFiles[2].empty() ? nullptr : _tlsFiles[2].c_str();
+}
 
-            // Select status code based on call state
-            switch (call_info.state) {
-                case PJSIP_INV_STATE_CONFIRMED:
-                    prm.statusCode = PJSIP_SC_OK;         // 200 OK for established call
-                    break;
-                case PJSIP_INV_STATE_EARLY:
-                    break;
-                case PJSIP_INV_STATE_CALLING:
-                    prm.statusCode = PJSIP_SC_REQUEST_TERMINATED; // 487 for unconnected outgoing call
-                    break;
-                case PJSIP_INV_STATE_INCOMING:
-                    prm.statusCode = PJSIP_SC_DECLINE;    // 603 for unaccepted incoming call
-                    break;
-                default:
-                    prm.statusCode = default_code;        // Fallback status code
+bool PJSUA2Manager::_tls_files_changed(const ManagerConfig& config) const{
+    return _tlsFiles[0] != tls_path(config.tls_ca_file)
+        || _tlsFiles[1] != tls_path(config.tls_cert_file)
+        || _tlsFiles[2] != tls_path(config.tls_privkey_file);
+}
+
+bool PJSUA2Manager::_reconfigure_transports(const ManagerConfig& config){
+    const pjsip_transport_type_e types[3] = {PJSIP_TRANSPORT_UDP, PJSIP_TRANSPORT_TCP, PJSIP_TRANSPORT_TLS};
+    int* ports[3] = {&_config.udp_port, &_config.tcp_port, &_config.tls_port};
+    const int newPorts[3] = {config.udp_port, config.tcp_port, config.tls_port};
+    bool changed[3] = {false, false, false};
+    int previous[3] = {-1, -1, -1}; // transports in effect before the change
+    bool closed[3] = {false, false, false}; // previous closed already to free its port
+    int opened[3] = {-1, -1, -1};
+    try{
+        for (int i = 0; i < 3; i++) {
+            bool tls_files = types[i] == PJSIP_TRANSPORT_TLS && newPorts[i] >= 0 && _tls_files_changed(config);
+            if (*ports[i] == newPorts[i] && !tls_files) continue;
+            changed[i] = true;
+            previous[i] = _configTransports[types[i]];
+            if (previous[i] >= 0 && *ports[i] == newPorts[i]) {
+                // Same port: the listener must be closed before the replacement can bind it
+                _endpoint->transportClose(previous[i]);
+                _configTransports[types[i]] = -1;
+                closed[i] = true;
+            }
+            // On a new port, open the replacement first so the endpoint is never left without the transport
+            opened[i] = _create_transport(types[i], newPorts[i], config.tls_ca_file,
+                                          config.tls_cert_file, config.tls_privkey_file);
+            _configTransports[types[i]] = opened[i];
+        }
+    }catch(const Error&){
+        // Put every transport back as it was; _config still describes it
+        for (int i = 0; i < 3; i++) {
+            if (!changed[i]) continue;
+            _configTransports[types[i]] = closed[i] ? -1 : previous[i];
+            try{
+                if (opened[i] >= 0) {
+                    _endpoint->transportClose(opened[i]);
+                }
+                if (closed[i]) {
+                    _configTransports[types[i]] = _create_transport(types[i], *ports[i], _config.tls_ca_file,
+                                                                    _config.tls_cert_file, _config.tls_privkey_file);
+                }
+            }catch(const Error&){
+                // Report the transport as closed rather than as the port asked for
+                _log.write(1, "Cannot restore transport " + to_string(types[i]) + " on port " + to_string(*ports[i]));
+                *ports[i] = -1;
+            }
+        }
+        throw;
+    }
+    bool any = false;
+    for (int i = 0; i < 3; i++) {
+        if (!changed[i]) continue;
+        if (previous[i] >= 0 && !closed[i]) {
+            try{
+                _endpoint->transportClose(previous[i]);
+            }catch(const Error&){
+                _log.write(2, "Cannot close replaced transport " + to_string(previous[i]));
             }
+        }
+        *ports[i] = newPorts[i];
+        any = true;
+    }
+    _set_tls_files(config);
+    return any;
+}
 
-            call->hangup(prm); // Send hangup request
-        };
+void PJSUA2Manager::reconfigure(const ManagerConfig& config){
+    try{
+        if (config.version == 0 || config.version > PJSUA2_MANAGER_CONFIG_VERSION) {
+            throw Error(PJ_EINVAL, "Config Error", "Unsupported ManagerConfig version", __FILE__, __LINE__);
+        }
+        if (config.max_calls != _config.max_calls
+                || (config.version >= 2 && config.memory_profile != _config.memory_profile)
+                || config.sip_thread_cnt != _config.sip_thread_cnt
+                || config.media_thread_cnt != _config.media_thread_cnt
+                || config.media_quality != _config.media_quality
+                || config.clock_rate != _config.clock_rate
+                || config.snd_clock_rate != _config.snd_clock_rate
+                || config.ptime != _config.ptime) {
+            throw Error(PJ_ENOTSUP, "Config Error", "Change requires recreating the manager", __FILE__, __LINE__);
+        }
 
-        // Check and process call in inbound/outbound/active maps
-        {
-            lock_guard<recursive_mutex> lock(_inboundCallsMutex);
-            if (auto it = _inboundCalls.find(call_id); it != _inboundCalls.end()) {
-                hangup_call(it->second.get(), PJSIP_SC_DECLINE);
-            } 
+        const int ports[3] = {config.udp_port, config.tcp_port, config.tls_port};
+        for (int port : ports) {
+            if (port < -1 || port > 65535) {
+                throw Error(PJ_EINVAL, "Config Error", "Invalid transport port", __FILE__, __LINE__);
+            }
         }
-        {
-            lock_guard<recursive_mutex> lock(_outboundCallsMutex);
-            if (auto it = _outboundCalls.find(call_id); it != _outboundCalls.end()) {
-                hangup_call(it->second.get(), PJSIP_SC_REQUEST_TERMINATED);
-            } 
+        if (config.tls_port >= 0) {
+            for (const char* path : {config.tls_ca_file, config.tls_cert_file, config.tls_privkey_file}) {
+                if (path && path[0] && access(path, R_OK) != 0) {
+                    throw Error(PJ_ENOTFOUND, "Config Error", string("Cannot read TLS file ") + path, __FILE__, __LINE__);
+                }
+            }
         }
-        {
-            lock_guard<recursive_mutex> lock(_activeCallsMutex);
-            if (auto it = _activeCalls.find(call_id); it != _activeCalls.end()) {
-                hangup_call(it->second.get(), PJSIP_SC_BUSY_HERE);
+
+        // Validated: apply the steps that can fail, undoing the earlier ones if a later one does
+        bool ec = config.ec_tail_len != _config.ec_tail_len || config.ec_options != _config.ec_options;
+        if (ec) {
+            _endpoint->audDevManager().setEcOptions(config.ec_tail_len, config.ec_options);
+        }
+        bool transports;
+        try{
+            transports = _reconfigure_transports(config);
+        }catch(const Error&){
+            if (ec) {
+                try{
+                    _endpoint->audDevManager().setEcOptions(_config.ec_tail_len, _config.ec_options);
+                }catch(const Error&){
+                    // Still in effect: report it
+                    _config.ec_tail_len = config.ec_tail_len;
+                    _config.ec_options = config.ec_options;
+                }
             }
+            throw;
         }
-       
+        _config.ec_tail_len = config.ec_tail_len;
+        _config.ec_options = config.ec_options;
 
-    } catch (const Error& e) {
+        if (transports) {
+            // Contacts carry the listen address: refresh every registration
+            lock_guard<recursive_mutex> lock(_accountsMutex);
+            for (auto& entry : _accounts) {
+                entry.second->setRegistration(true);
+            }
+        }
+
+        if (config.log_level != _config.log_level) {
+            _log.set_level(PJSUA2_LOG_CONSOLE, config.log_level);
+            _log.set_level(PJSUA2_LOG_FILE, config.log_level);
+            pj_log_set_level(_log.max_level());
+            _config.log_level = config.log_level;
+        }
+    }catch(const Error &e){
         _handle_error(e);
         throw;
     }
 }
 
 
-CallData PJSUA2Manager::get_call_info(const string& call_id){
-    CallData result;
-    memset(&result, 0, sizeof(result));
-    const initializer_list<const decltype(_activeCalls)*> maps = {
-        &_activeCalls,
-        &_inboundCalls, 
-        &_outboundCalls
-    };
-    for (const auto& map : maps) {
-        if (auto it = map->find(call_id); it != map->end()) {
-            const CallInfo& ci = it->second->getInfo();
-            
-            // Copy data with buffer size checking
-            strncpy(result.call_id, ci.callIdString.c_str(), sizeof(result.call_id) - 1);
-            strncpy(result.remote_uri, ci.remoteUri.c_str(), sizeof(result.remote_uri) - 1);
-            strncpy(result.local_uri, ci.localUri.c_str(), sizeof(result.local_uri) - 1);
-            strncpy(result.actual_state, ci.stateText.c_str(), sizeof(result.actual_state) - 1);
-            
-            // Assure null-terminated
-            result.call_id[sizeof(result.call_id)-1] = '\0';
-            result.remote_uri[sizeof(result.remote_uri)-1] = '\0';
-            result.local_uri[sizeof(result.local_uri)-1] = '\0';
-            result.actual_state[sizeof(result.actual_state)-1] = '\0';
-            
-            return result;
+PJSUA2Manager::~PJSUA2Manager(){
+    stop_event_loop();
+    {
+        lock_guard<mutex> lock(_qualityTimerMutex);
+        _qualityIntervalMs.store(0, memory_order_relaxed);
+        if (_endpoint && _qualityTimerArmed) {
+            _endpoint->utilTimerCancel(_qualityTimer);
+            _qualityTimerArmed = false;
         }
     }
-    return result;
+    {
+        lock_guard<mutex> lock(_admissionTimerMutex);
+        _admissionSampling = false;
+        if (_endpoint && _admissionTimerArmed) {
+            _endpoint->utilTimerCancel(_admissionTimer);
+            _admissionTimerArmed = false;
+        }
+    }
+    _waker.close();
+    _recorder.stop_all();
+    _taps.stop_all();
+    _calls.clear();
+    _accounts.clear();
+    if (_endpoint) {
+        _endpoint->libDestroy();
+    }
+}
+
+void PJSUA2Manager::start_event_loop(unsigned timeout_ms){
+    if (_eventThread.joinable()) return;
+    _isRunning.store(true, std::memory_order_release);
+    _loopExited.store(false, std::memory_order_release);
+    _eventThread = thread([this, timeout_ms]() { 
+        _register_thread();
+        while (_isRunning.load(std::memory_order_relaxed)) {
+                _handle_events(timeout_ms); 
+        }
+        _loopExited.store(true, std::memory_order_release);
+    });
+}
+
+void PJSUA2Manager::start_event_loop_blocking(){
+    // Timers still bound each poll; wakes cut it short
+    start_event_loop(BLOCKING_WAIT_MS);
+}
+
+int PJSUA2Manager::handle_events(unsigned timeout_ms){
+    _register_thread();
+    return _handle_events(timeout_ms);
+}
+
+void PJSUA2Manager::wake(){
+    _waker.wake();
+}
+
+int PJSUA2Manager::get_poll_fds(int* fds, int cap){
+    if (!fds || cap <= 0) return 0;
+
+    int n = 0;
+    if (_waker.fd() >= 0) {
+        fds[n++] = _waker.fd();
+    }
+    for (int id : _endpoint->transportEnum()) {
+        if (n >= cap) break;
+        pjsua_transport_info info;
+        if (pjsua_transport_get_info(id, &info) != PJ_SUCCESS) continue;
+        // Only UDP exposes its socket; TCP/TLS connections come and go inside the ioqueue
+        if (info.type == PJSIP_TRANSPORT_UDP && info.tp) {
+            fds[n++] = pjsip_udp_transport_get_socket(static_cast<pjsip_transport*>(info.tp));
+        }
+    }
+    return n;
+}
+
+int PJSUA2Manager::next_timer_ms() const{
+    pj_time_val next, now;
+    pj_timer_heap_t* heap = pjsip_endpt_get_timer_heap(pjsua_get_pjsip_endpt());
+    if (!heap || pj_timer_heap_earliest_time(heap, &next) != PJ_SUCCESS) {
+        return -1;
+    }
+    pj_gettickcount(&now);
+    long ms = (next.sec - now.sec) * 1000 + (next.msec - now.msec);
+    return ms < 0 ? 0 : (int)min<long>(ms, PJ_MAXINT32);
+}
+
+void PJSUA2Manager::_register_thread(){
+    if(!_endpoint->libIsThreadRegistered()){
+        char threadName[16];
+        pthread_getname_np(pthread_self(), threadName, sizeof(threadName));
+        _endpoint->libRegisterThread(threadName);
+    }
+}
+
+int PJSUA2Manager::_handle_events(unsigned timeout_ms) {
+    int count = _endpoint->libHandleEvents(timeout_ms);
+    _run_commands();
+    if (_codecs.take_budget_change()) {
+        try {
+            lock_guard<mutex> lock(_codecs.table_mutex());
+            _apply_inbound_codecs();
+        } catch (const Error& e) {
+            _handle_error(e);
+        }
+    }
+    if (_qualityDue.exchange(false, memory_order_acq_rel)) {
+        _sample_quality();
+        _schedule_quality_timer();
+    }
+    return count;
+}
+
+int PJSUA2Manager::submit_make_call(int acc_handle, const string& dest_uri){
+    Command command;
+    command.type = CMD_MAKE_CALL;
+    command.acc_handle = acc_handle;
+    command.call_handle = CallRegistry::INVALID_HANDLE;
+    command.uri = dest_uri;
+    int request_id = _commands.push(move(command));
+    _waker.wake();
+    _trace.record(PJSUA2_TRACE_COMMAND, PJSUA2_TRACE_OP_SUBMIT_MAKE_CALL, -1, CallRegistry::INVALID_HANDLE, acc_handle,
+                  request_id, 0, dest_uri);
+    return request_id;
+}
+
+void PJSUA2Manager::submit_make_calls(int acc_handle, const vector<string>& dest_uris, int* out_request_ids){
+    vector<Command> commands(dest_uris.size());
+    for (size_t i = 0; i < dest_uris.size(); i++) {
+        commands[i].type = CMD_MAKE_CALL;
+        commands[i].acc_handle = acc_handle;
+        commands[i].call_handle = CallRegistry::INVALID_HANDLE;
+        commands[i].uri = dest_uris[i];
+    }
+    _commands.push_batch(commands, out_request_ids);
+    _waker.wake();
+    for (size_t i = 0; i < dest_uris.size() && _trace.active(); i++) {
+        _trace.record(PJSUA2_TRACE_COMMAND, PJSUA2_TRACE_OP_SUBMIT_MAKE_CALL, -1, CallRegistry::INVALID_HANDLE, acc_handle,
+                      out_request_ids ? out_request_ids[i] : 0, 0, dest_uris[i]);
+    }
+}
+
+int PJSUA2Manager::submit_answer_call(int handle){
+    Command command;
+    command.type = CMD_ANSWER_CALL;
+    command.acc_handle = -1;
+    command.call_handle = handle;
+    int request_id = _commands.push(move(command));
+    _waker.wake();
+    _trace.record(PJSUA2_TRACE_COMMAND, PJSUA2_TRACE_OP_SUBMIT_ANSWER, CallRegistry::index_of(handle), handle, -1, request_id, 0);
+    return request_id;
+}
+
+int PJSUA2Manager::submit_hang_up_call(int handle){
+    Command command;
+    command.type = CMD_HANGUP_CALL;
+    command.acc_handle = -1;
+    command.call_handle = handle;
+    int request_id = _commands.push(move(command));
+    _waker.wake();
+    _trace.record(PJSUA2_TRACE_COMMAND, PJSUA2_TRACE_OP_SUBMIT_HANGUP, CallRegistry::index_of(handle), handle, -1, request_id, 0);
+    return request_id;
+}
+
+void PJSUA2Manager::_run_commands(){
+    if (!_commands.drain(_runningCommands)) return;
+
+    for (const Command& command : _runningCommands) {
+        EventData event;
+        memset(&event, 0, sizeof(event));
+        string reason;
+        event.type = PJSUA2_EVENT_COMMAND_DONE;
+        event.request_id = command.request_id;
+        event.call_handle = command.call_handle;
+        event.acc_handle = command.acc_handle;
+        try {
+            switch (command.type) {
+                case CMD_MAKE_CALL:
+                    {
+                        string callId = make_call(command.acc_handle, command.uri);
+                        event.call_handle = _calls.find(callId);
+                    }
+                    break;
+                case CMD_ANSWER_CALL:
+                case CMD_HANGUP_CALL:
+                    if (_calls.state(command.call_handle) == CALL_SLOT_FREE) {
+                        Error error(PJ_ENOTFOUND, "Command Error", "Unknown call handle", __FILE__, __LINE__);
+                        _handle_error(error);
+                        throw error;
+                    }
+                    event.acc_handle = _calls.account(command.call_handle);
+                    if (command.type == CMD_ANSWER_CALL) {
+                        answer_call(command.call_handle);
+                    } else {
+                        hang_up_call(command.call_handle);
+                    }
+                    break;
+                case CMD_REOFFER_CALL:
+                    _reoffer_call(command.call_handle);
+                    break;
+            }
+            event.code = PJ_SUCCESS;
+        } catch (const Error& e) {
+            // Already reported through _handle_error; tie the failure to the request
+            event.code = e.status != PJ_SUCCESS ? e.status : PJ_EBUG;
+            reason = e.reason;
+        }
+        if (command.type != CMD_REOFFER_CALL) {
+            _queue_event(event, reason);
+        }
+    }
+    _runningCommands.clear();
+}
+
+void PJSUA2Manager::stop_event_loop(){
+    _isRunning = false;
+    if (_eventThread.joinable()) {
+        // SIP worker threads poll the same ioqueue and may swallow a wake: repeat until the loop is out
+        while (!_loopExited.load(std::memory_order_acquire)) {
+            _waker.wake();
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        _eventThread.join();
+        _endpoint->libStopWorkerThreads();
+    }
+}
+
+void PJSUA2Manager::_handle_error(const Error &e){
+    _push_event(PJSUA2_EVENT_ERROR, e.srcLine, e.status, CallRegistry::INVALID_HANDLE, -1, e.title);
+    if(_onErrorCb){
+        _onErrorCb(
+            e.title.c_str(),
+            e.reason.c_str(),
+            e.info(true).c_str(),
+            e.srcFile.c_str(),
+            e.srcLine
+        );
+    }else{
+        _log.write(1, e.title + ": " + e.reason + " [" + e.srcFile + ":" + to_string(e.srcLine) + "]");
+    }
+}
+
+string PJSUA2Manager::make_call(const string& dest_uri){
+    return make_call(_defaultAccount.load(), dest_uri);
+}
+
+string PJSUA2Manager::make_call(int acc_handle, const string& dest_uri, const CodecList& codecs){
+    _trace.record(PJSUA2_TRACE_COMMAND, PJSUA2_TRACE_OP_MAKE_CALL, -1, CallRegistry::INVALID_HANDLE, acc_handle, 0, 0, dest_uri);
+    try{
+        lock_guard<recursive_mutex> lock(_accountsMutex);
+        auto it = _accounts.find(acc_handle);
+        if (it == _accounts.end()) {
+            throw Error(
+                PJ_ENOTFOUND,
+                "Account Error",
+                "Unknown account handle",
+                __FILE__,
+                __LINE__
+            );
+        }
+        PJSUA2Account& account = *it->second;
+
+        unique_ptr<PJSUA2Call> newCall(new (_callPool) PJSUA2Call(*this, account, PJSUA_INVALID_ID));
+        CallOpParam prm(true); // Use default call settings
+        string sipFullDestUri = "sip:"+dest_uri+"@"+account.sip_domain();
+
+        // Only the table lock is held across makeCall: it takes PJSUA_LOCK, and
+        // callbacks running under PJSUA_LOCK take the registry lock. Until the
+        // insert below, update() ignores the slot.
+        {
+            // The offer is built inside makeCall from the table programmed here
+            lock_guard<mutex> codecLock(_codecs.table_mutex());
+            _codecs.apply(*_endpoint, _codecs.order_for(-1, acc_handle, codecs));
+            try {
+                newCall->makeCall(sipFullDestUri, prm);
+            } catch (const Error&) {
+                _apply_inbound_codecs();
+                throw;
+            }
+            _apply_inbound_codecs();
+        }
+        CallInfo callInfo = newCall->getInfo();
+        lock_guard<recursive_mutex> callsLock(_calls.mutex());
+        // Re-checked under the lock: a DISCONNECTED reported since makeCall
+        // returned found no slot to release
+        if (newCall->isActive()) {
+            _calls.insert(move(newCall), CALL_DIR_OUTBOUND, callInfo, acc_handle);
+        } else {
+            // Already disconnected: its events went out under the slot's
+            // current handle, so retire that handle before the slot is reused
+            int index = newCall->getId();
+            if (_calls.state(_calls.handle_of(index)) == CALL_SLOT_FREE) {
+                _calls.release(index);
+            }
+        }
+        return callInfo.callIdString;
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::answer_call(const string& call_id){
+    answer_call(_calls.find(call_id));
+}
+
+void PJSUA2Manager::answer_call(int handle){
+    answer_call(handle, CodecList());
+}
+
+void PJSUA2Manager::answer_call(int handle, const CodecList& codecs){
+    _trace.record(PJSUA2_TRACE_COMMAND, PJSUA2_TRACE_OP_ANSWER, CallRegistry::index_of(handle), handle, -1, 0, 0);
+    try{
+        shared_ptr<Call> call = _calls.pin(handle);
+        if(call && _calls.direction(handle) == CALL_DIR_INBOUND && _calls.state(handle) == CALL_SLOT_PENDING){
+            CodecList order = _codecs.order_for(-1, _calls.account(handle), codecs);
+            if (order != _codecs.order_for(-1, -1)) {
+                _codecs.set_call(CallRegistry::index_of(handle), order);
+            }
+            CallOpParam prm;
+            prm.statusCode = PJSIP_SC_OK;
+            call->answer(prm);
+        }
+    }catch(Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::hang_up_call(const string& call_id){
+    hang_up_call(_calls.find(call_id));
+}
+
+void PJSUA2Manager::hang_up_call(int handle){
+    _trace.record(PJSUA2_TRACE_COMMAND, PJSUA2_TRACE_OP_HANGUP, CallRegistry::index_of(handle), handle, -1, 0, 0);
+    try {
+        shared_ptr<Call> call = _calls.pin(handle);
+        if (!call) return;
+        _metrics.hangup_requested(CallRegistry::index_of(handle));
+
+        // Fallback status code depends on where the call is in its lifecycle
+        pjsip_status_code default_code = PJSIP_SC_BUSY_HERE;
+        if (_calls.state(handle) == CALL_SLOT_PENDING) {
+            default_code = _calls.direction(handle) == CALL_DIR_INBOUND
+                ? PJSIP_SC_DECLINE
+                : PJSIP_SC_REQUEST_TERMINATED;
+        }
+
+        CallInfo call_info = call->getInfo(); // Get current call state
+        CallOpParam prm;
+
+        // Select status code based on call state
+        switch (call_info.state) {
+            case PJSIP_INV_STATE_CONFIRMED:
+                prm.statusCode = PJSIP_SC_OK;         // 200 OK for established call
+                break;
+            case PJSIP_INV_STATE_EARLY:
+                break;
+            case PJSIP_INV_STATE_CALLING:
+                prm.statusCode = PJSIP_SC_REQUEST_TERMINATED; // 487 for unconnected outgoing call
+                break;
+            case PJSIP_INV_STATE_INCOMING:
+                prm.statusCode = PJSIP_SC_DECLINE;    // 603 for unaccepted incoming call
+                break;
+            default:
+                prm.statusCode = default_code;        // Fallback status code
+        }
+
+        call->hangup(prm); // Send hangup request
+    } catch (const Error& e) {
+        _handle_error(e);
+        throw;
+    }
+}
+
+
+CallData PJSUA2Manager::get_call_info(const string& call_id){
+    return get_call_info(_calls.find(call_id));
+}
+
+CallData PJSUA2Manager::get_call_info(int handle){
+    CallData result;
+    if (!_calls.read(handle, result)) {
+        memset(&result, 0, sizeof(result));
+        result.call_handle = CallRegistry::INVALID_HANDLE;
+        result.acc_handle = -1;
+    }
+    return result;
+}
+
+void PJSUA2Manager::set_account_media_route(int acc_handle, const MediaRoute& route){
+    _media.set_account_route(acc_handle, route);
+}
+
+void PJSUA2Manager::set_call_media_route(int handle, const MediaRoute& route){
+    try{
+        shared_ptr<Call> call = _calls.pin(handle);
+        if (!call) {
+            throw Error(PJ_ENOTFOUND, "Media Error", "Unknown call handle", __FILE__, __LINE__);
+        }
+        int index = CallRegistry::index_of(handle);
+        if (route.mode != MEDIA_ROUTE_CONFERENCE) {
+            _rooms.remove(index);
+        }
+        _media.set_call_route(index, route);
+        if (call->hasMedia()) {
+            // Live call: re-route now instead of waiting for the next media update
+            AudioMedia aud_media = call->getAudioMedia(-1);
+            _route_media(index, _calls.account(handle), aud_media);
+        }
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::bridge_calls(int handle_a, int handle_b){
+    MediaRoute route_a;
+    route_a.mode = MEDIA_ROUTE_BRIDGE;
+    route_a.peerHandle = handle_b;
+    MediaRoute route_b;
+    route_b.mode = MEDIA_ROUTE_BRIDGE;
+    route_b.peerHandle = handle_a;
+
+    set_call_media_route(handle_b, route_b);
+    set_call_media_route(handle_a, route_a);
+}
+
+int PJSUA2Manager::conference_create(bool with_local){
+    return _rooms.create(with_local);
+}
+
+void PJSUA2Manager::conference_destroy(int room){
+    try{
+        vector<int> indices;
+        if (!_rooms.destroy(room, indices)) {
+            throw Error(PJ_ENOTFOUND, "Conference Error", "Unknown room", __FILE__, __LINE__);
+        }
+        for (int index : indices) {
+            _media.clear_call_route(index);
+            shared_ptr<Call> call = _calls.pin(_calls.handle_of(index));
+            if (call && call->hasMedia()) {
+                AudioMedia aud_media = call->getAudioMedia(-1);
+                _route_media(index, call->getInfo().accId, aud_media);
+            }
+        }
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::conference_add(int room, int handle){
+    try{
+        if (!_calls.pin(handle)) {
+            throw Error(PJ_ENOTFOUND, "Conference Error", "Unknown call handle", __FILE__, __LINE__);
+        }
+        if (!_rooms.add(room, CallRegistry::index_of(handle))) {
+            throw Error(PJ_ENOTFOUND, "Conference Error", "Unknown room", __FILE__, __LINE__);
+        }
+        MediaRoute route;
+        route.mode = MEDIA_ROUTE_CONFERENCE;
+        route.roomId = room;
+        // Drops the previous route's links and attaches the call's port to the room
+        set_call_media_route(handle, route);
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::conference_remove(int room, int handle){
+    try{
+        shared_ptr<Call> call = _calls.pin(handle);
+        int index = CallRegistry::index_of(handle);
+        if (!call || _rooms.room_of(index) != room) {
+            throw Error(PJ_ENOTFOUND, "Conference Error", "Call is not in the room", __FILE__, __LINE__);
+        }
+        _rooms.remove(index);
+        _media.clear_call_route(index);
+        if (call->hasMedia()) {
+            AudioMedia aud_media = call->getAudioMedia(-1);
+            _route_media(index, _calls.account(handle), aud_media);
+        }
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::conference_mute(int room, int handle, bool muted){
+    try{
+        int index = handle < 0 ? ConferenceRooms::LOCAL : CallRegistry::index_of(handle);
+        if (handle >= 0 && _calls.state(handle) == CALL_SLOT_FREE) {
+            throw Error(PJ_ENOTFOUND, "Conference Error", "Unknown call handle", __FILE__, __LINE__);
+        }
+        if (!_rooms.set_muted(room, index, muted)) {
+            throw Error(PJ_ENOTFOUND, "Conference Error", "Participant is not in the room", __FILE__, __LINE__);
+        }
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+int PJSUA2Manager::conference_members(int room, int* out, int cap){
+    try{
+        if (!out || cap <= 0) return 0;
+        int indices[PJSUA_MAX_CALLS];
+        int n = _rooms.members(room, indices, min(cap, (int)PJSUA_MAX_CALLS));
+        if (n < 0) {
+            throw Error(PJ_ENOTFOUND, "Conference Error", "Unknown room", __FILE__, __LINE__);
+        }
+        for (int i = 0; i < n; i++) {
+            out[i] = _calls.handle_of(indices[i]);
+        }
+        return n;
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::refresh_audio_devices(){
+    _media.refresh_devices();
+}
+
+void PJSUA2Manager::set_headless(bool headless){
+    try{
+        _media.set_headless(headless);
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::_route_media(int index, int acc_handle, AudioMedia& media){
+    MediaRoute route = _media.route_for(index, acc_handle);
+    AudioMedia peerMedia;
+    AudioMedia* peer = nullptr;
+    if (route.mode == MEDIA_ROUTE_BRIDGE) {
+        shared_ptr<Call> peerCall = _calls.pin(route.peerHandle);
+        if (peerCall && peerCall->hasMedia()) {
+            peerMedia = peerCall->getAudioMedia(-1);
+            peer = &peerMedia;
+        }
+    }
+    _media.connect(index, acc_handle, media, peer);
+    if (route.mode == MEDIA_ROUTE_CONFERENCE) {
+        _rooms.attach(index, media.getPortId());
+    }
+
+    if (_recorder.is_recording(index)) {
+        AudioMedia local;
+        bool hasLocal = _media.local_source(index, local);
+        _recorder.attach(index, media, hasLocal ? &local : nullptr);
+    }
+    _taps.attach(index, media);
+}
+
+void PJSUA2Manager::start_recording(int handle, const string& path, bool compressed){
+    try{
+        shared_ptr<Call> call = _calls.pin(handle);
+        if (!call) {
+            throw Error(PJ_ENOTFOUND, "Recorder Error", "Unknown call handle", __FILE__, __LINE__);
+        }
+        int index = CallRegistry::index_of(handle);
+        _recorder.start(index, path, compressed);
+        if (call->hasMedia()) {
+            // Otherwise attached by the first onCallMediaState
+            AudioMedia aud_media = call->getAudioMedia(-1);
+            AudioMedia local;
+            bool hasLocal = _media.local_source(index, local);
+            _recorder.attach(index, aud_media, hasLocal ? &local : nullptr);
+        }
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::stop_recording(int handle){
+    if (_calls.state(handle) == CALL_SLOT_FREE) return;
+    _recorder.stop(CallRegistry::index_of(handle));
+}
+
+FrameTapHeader* PJSUA2Manager::start_frame_tap(int handle, unsigned frames){
+    try{
+        shared_ptr<Call> call = _calls.pin(handle);
+        if (!call) {
+            throw Error(PJ_ENOTFOUND, "Frame Tap Error", "Unknown call handle", __FILE__, __LINE__);
+        }
+        int index = CallRegistry::index_of(handle);
+        FrameTapHeader* region = _taps.start(index, frames);
+        if (call->hasMedia()) {
+            // Otherwise attached by the first onCallMediaState
+            AudioMedia aud_media = call->getAudioMedia(-1);
+            _taps.attach(index, aud_media);
+        }
+        return region;
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+FrameTapHeader* PJSUA2Manager::get_frame_tap(int handle) const{
+    if (_calls.state(handle) == CALL_SLOT_FREE) return nullptr;
+    return _taps.region_of(CallRegistry::index_of(handle));
+}
+
+void PJSUA2Manager::stop_frame_tap(int handle){
+    if (_calls.state(handle) == CALL_SLOT_FREE) return;
+    _taps.stop(CallRegistry::index_of(handle));
+}
+
+bool PJSUA2Manager::release_frame_tap(FrameTapHeader* region){
+    return _taps.release(region);
+}
+
+void PJSUA2Manager::set_codec_priorities(int acc_handle, const CodecList& codecs){
+    try{
+        if (acc_handle < 0) {
+            if (codecs.empty()) {
+                throw Error(PJ_EINVAL, "Codec Error", "Default codec list cannot be empty", __FILE__, __LINE__);
+            }
+            _codecs.set_default(codecs);
+        } else {
+            _codecs.set_account(acc_handle, codecs);
+        }
+        lock_guard<mutex> lock(_codecs.table_mutex());
+        _apply_inbound_codecs();
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::set_opus_settings(const OpusSettings& settings){
+    try{
+        CodecPolicy::apply_opus(*_endpoint, settings);
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::set_codec_cpu_budget(int max_opus_calls){
+    _codecs.set_cpu_budget(max_opus_calls);
+    // The event thread reprograms the table if the budget state flipped
+    _waker.wake();
+}
+
+void PJSUA2Manager::set_log_level(LogSink sink, int level){
+    _log.set_level(sink, level);
+    // Messages no sink wants are not even formatted
+    pj_log_set_level(_log.max_level());
+}
+
+void PJSUA2Manager::set_log_rate_limit(unsigned burst, unsigned window_ms){
+    _log.set_rate_limit(burst, window_ms);
+}
+
+void PJSUA2Manager::open_log_file(const string& path, size_t max_bytes, unsigned max_files){
+    try{
+        if (!_log.open_file(path, max_bytes, max_files)) {
+            throw Error(PJ_ENOTFOUND, "Log Error", "Cannot open log file " + path, __FILE__, __LINE__);
+        }
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::close_log_file(){
+    _log.close_file();
+}
+
+int PJSUA2Manager::poll_logs(LogRecord* out, int max){
+    return _log.poll(out, max);
+}
+
+void PJSUA2Manager::start_trace(const string& path){
+    try{
+        if (!_trace.start(path)) {
+            throw Error(PJ_ENOTFOUND, "Trace Error", "Cannot open trace file " + path, __FILE__, __LINE__);
+        }
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::stop_trace(){
+    _trace.stop();
+}
+
+TraceReplayStats PJSUA2Manager::replay_trace(const string& path, double speed){
+    try{
+        TraceReader reader;
+        if (!reader.open(path)) {
+            throw Error(PJ_EINVAL, "Trace Error", "Not a trace file " + path, __FILE__, __LINE__);
+        }
+        int live;
+        if (_calls.collect(&live, 1, -1) > 0) {
+            throw Error(PJ_EBUSY, "Trace Error", "Calls in progress", __FILE__, __LINE__);
+        }
+
+        TraceReplayStats stats;
+        memset(&stats, 0, sizeof(stats));
+        // Call-ID and URIs of each replayed call, from its first record
+        vector<CallInfo> calls(CallRegistry::CAPACITY);
+        TraceRecord record;
+        string strings;
+        const uint64_t start = CallMetrics::now_us();
+
+        while (reader.next(record, strings)) {
+            stats.records++;
+            if (speed > 0) {
+                uint64_t due = start + (uint64_t)(record.timestamp_us / speed);
+                uint64_t now = CallMetrics::now_us();
+                if (due > now) {
+                    this_thread::sleep_for(chrono::microseconds(due - now));
+                } else {
+                    stats.max_lag_us = max(stats.max_lag_us, now - due);
+                }
+            }
+
+            int index = record.index;
+            bool known = index >= 0 && index < CallRegistry::CAPACITY;
+            switch (record.kind) {
+                case PJSUA2_TRACE_REG_STATE:
+                    _on_reg_state(record.acc_handle, record.code, record.state != 0, TraceReader::field(strings, 0));
+                    stats.reg_events++;
+                    break;
+                case PJSUA2_TRACE_INCOMING_CALL:
+                case PJSUA2_TRACE_CALL_STATE:
+                    {
+                        bool placed = known && _calls.state(_calls.handle_of(index)) != CALL_SLOT_FREE;
+                        // A call's first record carries its strings: without them the call began before the trace
+                        bool usable = known && (record.kind == PJSUA2_TRACE_INCOMING_CALL ? !placed : placed || !strings.empty());
+                        if (!usable) {
+                            stats.skipped++;
+                            break;
+                        }
+                        CallInfo& info = calls[index];
+                        if (!strings.empty()) {
+                            info.callIdString = TraceReader::field(strings, 0);
+                            info.localUri = TraceReader::field(strings, 1);
+                            info.remoteUri = TraceReader::field(strings, 2);
+                        }
+                        info.id = index;
+                        info.accId = record.acc_handle;
+                        info.state = (pjsip_inv_state)record.state;
+                        info.stateText = pjsip_inv_state_name(info.state);
+                        info.lastStatusCode = (pjsip_status_code)record.code;
+
+                        if (record.kind == PJSUA2_TRACE_INCOMING_CALL) {
+                            _metrics.call_started(index, false);
+                            _on_incoming_call(index, nullptr, info, record.acc_handle);
+                        } else {
+                            _on_call_state(index, info, nullptr);
+                            // Outgoing calls enter the registry when makeCall returns, after their first state
+                            if (!placed && info.state != PJSIP_INV_STATE_DISCONNECTED) {
+                                _calls.insert(index, nullptr, CALL_DIR_OUTBOUND, info, record.acc_handle);
+                            }
+                        }
+                        stats.call_events++;
+                    }
+                    break;
+                case PJSUA2_TRACE_MEDIA_STATE:
+                    if (known && record.state) {
+                        _metrics.media_active(index);
+                    }
+                    break;
+                case PJSUA2_TRACE_COMMAND:
+                    stats.commands++;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // Calls still up when the trace ended
+        int handles[CallRegistry::CAPACITY];
+        int count = _calls.collect(handles, CallRegistry::CAPACITY, -1);
+        for (int i = 0; i < count; i++) {
+            lock_guard<recursive_mutex> lock(_calls.mutex());
+            if (!_calls.get(handles[i])) {
+                _calls.release(CallRegistry::index_of(handles[i]));
+            }
+        }
+        stats.elapsed_us = CallMetrics::now_us() - start;
+        return stats;
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::_apply_inbound_codecs(){
+    _codecs.apply(*_endpoint, _codecs.order_for(-1, -1));
+}
+
+void PJSUA2Manager::_submit_reoffer(int index){
+    Command command;
+    command.type = CMD_REOFFER_CALL;
+    command.acc_handle = -1;
+    command.call_handle = _calls.handle_of(index);
+    _commands.push(move(command));
+    _waker.wake();
+}
+
+void PJSUA2Manager::_reoffer_call(int handle){
+    try{
+        shared_ptr<Call> call = _calls.pin(handle);
+        if (!call) return;
+        int index = CallRegistry::index_of(handle);
+
+        lock_guard<mutex> codecLock(_codecs.table_mutex());
+        _codecs.apply(*_endpoint, _codecs.order_for(index, _calls.account(handle)));
+        try {
+            CallOpParam prm(true);
+            call->reinvite(prm);
+        } catch (const Error&) {
+            _apply_inbound_codecs();
+            throw;
+        }
+        _apply_inbound_codecs();
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::set_quality_interval(unsigned interval_ms){
+    unsigned previous = _qualityIntervalMs.exchange(interval_ms, memory_order_acq_rel);
+    if (previous == 0 && interval_ms > 0) {
+        _schedule_quality_timer();
+    }
+}
+
+void PJSUA2Manager::set_quality_thresholds(const QualityThresholds& thresholds){
+    _quality.set_thresholds(thresholds);
+}
+
+int PJSUA2Manager::get_call_quality(CallQualityData* out, int cap) const{
+    return _quality.snapshot(out, cap);
+}
+
+void PJSUA2Manager::_on_quality_timer(){
+    {
+        lock_guard<mutex> lock(_qualityTimerMutex);
+        _qualityTimerArmed = false;
+    }
+    // Sample on the event thread, whichever thread polled the timer heap
+    _qualityDue.store(true, memory_order_release);
+    _waker.wake();
+}
+
+void PJSUA2Manager::_schedule_quality_timer(){
+    lock_guard<mutex> lock(_qualityTimerMutex);
+    unsigned interval = _qualityIntervalMs.load(memory_order_acquire);
+    if (interval == 0 || _qualityTimerArmed) return;
+    try{
+        _qualityTimer = _endpoint->utilTimerSchedule(interval, static_cast<Token>(&_quality));
+        _qualityTimerArmed = true;
+    }catch(const Error &e){
+        _handle_error(e);
+    }
+}
+
+void PJSUA2Manager::_on_admission_timer(){
+    {
+        lock_guard<mutex> lock(_admissionTimerMutex);
+        _admissionTimerArmed = false;
+    }
+    _admission.timer_fired(CallMetrics::now_us());
+    _schedule_admission_timer();
+}
+
+void PJSUA2Manager::_schedule_admission_timer(){
+    lock_guard<mutex> lock(_admissionTimerMutex);
+    // Idle endpoints are not woken up unless a lag or CPU limit is set
+    if (!_admissionSampling || _admissionTimerArmed || !_admission.sampling()) return;
+    try{
+        _admissionTimer = _endpoint->utilTimerSchedule(AdmissionControl::SAMPLE_INTERVAL_MS, static_cast<Token>(&_admission));
+        _admission.timer_armed(CallMetrics::now_us() + AdmissionControl::SAMPLE_INTERVAL_MS * 1000ull);
+        _admissionTimerArmed = true;
+    }catch(const Error &e){
+        _handle_error(e);
+    }
+}
+
+void PJSUA2Manager::_cancel_admission_timer(){
+    lock_guard<mutex> lock(_admissionTimerMutex);
+    if (_endpoint && _admissionTimerArmed) {
+        _endpoint->utilTimerCancel(_admissionTimer);
+        _admissionTimerArmed = false;
+    }
+    _admission.timer_armed(0);
+}
+
+AdmissionVerdict PJSUA2Manager::_admit_call(int acc_handle){
+    int calls = 0;
+    if (_admission.account_limit() > 0) {
+        int handles[CallRegistry::CAPACITY];
+        calls = _calls.collect(handles, CallRegistry::CAPACITY, acc_handle);
+    }
+    return _admission.admit(calls, _events.depth());
+}
+
+void PJSUA2Manager::_reject_call(int index, AdmissionVerdict verdict){
+    pjsua_msg_data msgData;
+    pjsua_msg_data_init(&msgData);
+    pjsip_generic_string_hdr retryAfter;
+    char seconds[16];
+    unsigned retry = _admission.retry_after_sec();
+    if (retry > 0) {
+        snprintf(seconds, sizeof(seconds), "%u", retry);
+        pj_str_t name = pj_str((char*)"Retry-After");
+        pj_str_t value = pj_str(seconds);
+        pjsip_generic_string_hdr_init2(&retryAfter, &name, &value);
+        pj_list_push_back(&msgData.hdr_list, &retryAfter);
+    }
+    pj_str_t reason = pj_str((char*)AdmissionControl::reason(verdict));
+    int code = AdmissionControl::status_code(verdict);
+    if (pjsua_call_hangup(index, code, &reason, &msgData) != PJ_SUCCESS) {
+        _log.write(2, "Cannot reject incoming call " + to_string(index) + " with " + to_string(code));
+    } else {
+        _log.write(4, "Rejected incoming call: " + string(AdmissionControl::reason(verdict)) + " (" + to_string(code) + ")");
+    }
+}
+
+void PJSUA2Manager::_sample_quality(){
+    int handles[CallRegistry::CAPACITY];
+    int count = _calls.collect(handles, CallRegistry::CAPACITY);
+    uint64_t now = CallMetrics::now_us();
+    for (int i = 0; i < count; i++) {
+        int handle = handles[i];
+        int index = CallRegistry::index_of(handle);
+        try{
+            // getInfo() and the stream getters take PJSUA_LOCK: no registry lock here
+            shared_ptr<Call> call = _calls.pin(handle);
+            if (!call) continue;
+            CallInfo info = call->getInfo();
+            for (unsigned m = 0; m < info.media.size(); m++) {
+                if (info.media[m].type != PJMEDIA_TYPE_AUDIO || info.media[m].status != PJSUA_CALL_MEDIA_ACTIVE) {
+                    continue;
+                }
+                bool changed = false;
+                const CallQualityData& data = _quality.sample(index, handle, call->getStreamStat(m),
+                                                              call->getStreamInfo(m), now, changed);
+                if (changed) {
+                    _push_event(PJSUA2_EVENT_QUALITY_ALERT, (int)(data.mos * 100.0f), data.alerts,
+                                handle, _calls.account(handle), data.codec);
+                }
+                break;
+            }
+        }catch(const Error &e){
+            // The call went away between collect() and the sample
+        }
+    }
+}
+
+void PJSUA2Manager::get_memory_stats(MemoryStats& out) const{
+    memset(&out, 0, sizeof(out));
+    long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (fscanf(statm, "%ld %ld", &pages, &resident) == 2) {
+            out.rss_bytes = (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+        }
+        fclose(statm);
+    }
+    const pj_caching_pool* cp = reinterpret_cast<const pj_caching_pool*>(pjsua_get_pool_factory());
+    if (cp) {
+        out.pj_pool_used_bytes = cp->used_size;
+        out.pj_pool_peak_bytes = cp->peak_used_size;
+        out.pj_pool_cached_bytes = cp->capacity;
+    }
+    out.call_pool_capacity = _callPool.capacity();
+    out.call_pool_in_use = _callPool.in_use();
+    out.call_pool_overflow = _callPool.overflow();
+}
+
+void PJSUA2Manager::get_metrics(MetricsData& out) const{
+    _metrics.read(out);
+}
+
+void PJSUA2Manager::reset_metrics(){
+    _metrics.reset();
+    _admission.reset();
+}
+
+void PJSUA2Manager::set_admission_config(const AdmissionConfig& config){
+    try{
+        if (config.version == 0 || config.version > PJSUA2_ADMISSION_CONFIG_VERSION) {
+            throw Error(PJ_EINVAL, "Admission Error", "Unsupported AdmissionConfig version", __FILE__, __LINE__);
+        }
+        _admission.configure(config);
+        if (_admission.sampling()) {
+            _schedule_admission_timer();
+        } else {
+            _cancel_admission_timer();
+        }
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+void PJSUA2Manager::get_admission_stats(AdmissionStats& out) const{
+    _admission.read(out);
+    out.event_queue = (uint32_t)_events.depth();
+}
+
+void PJSUA2Manager::set_invite_headers(const vector<string>& names){
+    try{
+        for (const string& name : names) {
+            if (name.empty() || name.find_first_of(": \t\r\n") != string::npos) {
+                throw Error(PJ_EINVAL, "Invite Headers Error", "Invalid header name: " + name, __FILE__, __LINE__);
+            }
+        }
+        _inviteHeaders.configure(names);
+    }catch(const Error &e){
+        _handle_error(e);
+        throw;
+    }
+}
+
+int PJSUA2Manager::get_calls_snapshot(CallData* out, int cap) const{
+    return _calls.snapshot(out, cap);
+}
+
+int PJSUA2Manager::get_call_handle(const string& call_id) const{
+    return _calls.find(call_id);
+}
+
+void PJSUA2Manager::_queue_event(EventData& event, const string& text){
+    event.version = PJSUA2_EVENT_VERSION;
+    event.timestamp_us = CallMetrics::now_us();
+    // Keep the terminating NUL so Dart can read the arena as C strings
+    _events.push(event, text.c_str(), text.empty() ? 0 : text.size() + 1);
+}
+
+void PJSUA2Manager::_push_event(EventType type, int code, int state, int call_handle, int acc_handle, const string& text){
+    EventData event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.code = code;
+    event.state = state;
+    event.call_handle = call_handle;
+    event.acc_handle = acc_handle;
+    _queue_event(event, text);
+}
+
+void PJSUA2Manager::_push_call_event(EventType type, int code, int state, int index, int call_handle, const CallInfo& info,
+                                     const string& extra){
+    EventData event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.code = code;
+    event.state = state;
+    event.call_handle = call_handle;
+    event.acc_handle = info.accId;
+
+    // Intern: only the first event of each call carries its Call-ID and URIs
+    string strings;
+    if (index >= 0 && index < PJSUA_MAX_CALLS
+            && _internedCalls[index].exchange(call_handle, memory_order_relaxed) != call_handle) {
+        strings.reserve(info.callIdString.size() + info.localUri.size() + info.remoteUri.size() + extra.size() + 3);
+        strings.append(info.callIdString).push_back('\0');
+        strings.append(info.localUri).push_back('\0');
+        strings.append(info.remoteUri);
+        // Extra strings only go with the whole call prefix (the queue keeps a terminating NUL)
+        if (strings.size() + extra.size() < EventQueue::MAX_STRINGS) {
+            strings.append(extra);
+        } else {
+            // Count the dropped pairs so they are not mistaken for absent headers
+            event.code += (int)(count(extra.begin(), extra.end(), '\0') / 2);
+        }
+    }
+    _queue_event(event, strings);
+}
+
+int PJSUA2Manager::poll_events(EventData* out, int max, char* strings, size_t strings_cap){
+    return _events.pop_batch(out, max, strings, strings_cap);
+}
+
+int PJSUA2Manager::event_fd() const{
+    return _events.notify_fd();
 }
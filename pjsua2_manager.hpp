@@ -13,22 +13,66 @@
 #include <atomic>
 #include <memory>
 
+#include "event_queue.hpp"
+#include "call_registry.hpp"
+#include "event_waker.hpp"
+#include "command_queue.hpp"
+#include "call_metrics.hpp"
+#include "media_router.hpp"
+#include "call_recorder.hpp"
+#include "frame_tap.hpp"
+#include "codec_policy.hpp"
+#include "registrar_pool.hpp"
+#include "log_pipeline.hpp"
+#include "call_pool.hpp"
+#include "call_quality.hpp"
+#include "conference_rooms.hpp"
+#include "sip_trace.hpp"
+#include "invite_headers.hpp"
+#include "admission_control.hpp"
+#include "pjsua2_manager_interface.hpp"
+
 using namespace pj;
 using namespace std;
 
 
+#define PJSUA2_MANAGER_CONFIG_VERSION 2 /**< Current ManagerConfig layout version */
+
 /**
- * @brief Structure containing call information data.
+ * @brief Memory profile of the endpoint.
+ */
+typedef enum {
+    PJSUA2_MEMORY_DEFAULT = 0, /**< PJSIP defaults, sized for desktops */
+    PJSUA2_MEMORY_LOW = 1      /**< Small pool cache, short jitter buffer, bridge sized to max_calls */
+} MemoryProfile;
+
+/**
+ * @brief Endpoint configuration passed to pjsua2_manager_create_ex.
  * 
- * This structure holds details about a SIP call including call identifiers,
- * remote/local URIs, and current call state.
+ * Always start from pjsua2_manager_config_default() so fields added in later
+ * versions keep sane defaults. Ports set to -1 disable the transport, 0 binds
+ * any free port.
  */
 typedef struct {
-    char call_id[128];       /**< Unique call identifier (null-terminated string) */
-    char remote_uri[128];    /**< Remote party URI (null-terminated string) */
-    char local_uri[128];     /**< Local party URI (null-terminated string) */
-    char actual_state[64];   /**< Current call state description (null-terminated string) */
-} CallData;
+    unsigned version;              /**< Must be PJSUA2_MANAGER_CONFIG_VERSION */
+    unsigned max_calls;            /**< Maximum concurrent calls, at most PJSUA_MAX_CALLS (PJ_ETOOMANY otherwise) */
+    unsigned sip_thread_cnt;       /**< SIP worker threads in addition to the event loop */
+    unsigned media_thread_cnt;     /**< Media ioqueue worker threads */
+    int udp_port;                  /**< UDP listen port, -1 to disable */
+    int tcp_port;                  /**< TCP listen port, -1 to disable */
+    int tls_port;                  /**< TLS listen port, -1 to disable */
+    const char* tls_ca_file;       /**< TLS CA list file (may be NULL) */
+    const char* tls_cert_file;     /**< TLS certificate file (may be NULL) */
+    const char* tls_privkey_file;  /**< TLS private key file (may be NULL) */
+    unsigned ec_tail_len;          /**< Echo canceller tail in ms, 0 disables it */
+    unsigned ec_options;           /**< PJMEDIA_ECHO_* flags */
+    unsigned media_quality;        /**< Resampling/codec quality 1-10 */
+    unsigned clock_rate;           /**< Conference bridge clock rate in Hz */
+    unsigned snd_clock_rate;       /**< Sound device clock rate in Hz, 0 follows clock_rate */
+    unsigned ptime;                /**< Packet time in ms */
+    unsigned log_level;            /**< Initial level of the console and file log sinks 0-6 */
+    unsigned memory_profile;       /**< MemoryProfile (version 2) */
+} ManagerConfig;
 
 typedef void (*DartIncomingCallStateCb)(const char* call_id); /**< Incoming call state callback */
 typedef void (*DartOnRegStateCb)(int code, const char* status, const char* reason); /**< Registration state callback */
@@ -42,7 +86,7 @@ typedef void (*DartOnErrorCb)(const char* title, const char* reason, const char*
  * Provides SIP account management, call control, and event handling capabilities.
  * Manages threading, synchronization, and interaction with PJSIP stack.
  */
-class PJSUA2Manager {
+class PJSUA2Manager : public IPJSUA2Manager {
 public:
 
     /**
@@ -66,24 +110,229 @@ public:
         DartOnErrorCb onErrorCb = nullptr
     );
 
+    /**
+     * @brief Construct a new PJSUA2Manager object from an explicit configuration
+     * 
+     * @param sip_user SIP account username
+     * @param sip_password SIP account password
+     * @param sip_domain SIP domain/server address
+     * @param config Endpoint configuration
+     * @param onIncomingCallCb Incoming call notification callback (optional)
+     * @param onRegStateCb Registration state change callback (optional)
+     * @param onCallStateCb Call state change callback (optional)
+     * @param onErrorCb Error reporting callback (optional)
+     * @throw Error if the configuration version is unsupported or PJSIP fails
+     */
+    PJSUA2Manager(
+        const string& sip_user,
+        const string& sip_password,
+        const string& sip_domain,
+        const ManagerConfig& config,
+        DartIncomingCallStateCb onIncomingCallCb = nullptr,
+        DartOnRegStateCb onRegStateCb = nullptr,
+        DartCallStateCb onCallStateCb = nullptr,
+        DartOnErrorCb onErrorCb = nullptr
+    );
+
+    /**
+     * @brief Get the default configuration (two-line handset profile)
+     * 
+     * @return ManagerConfig Configuration matching the legacy constructor
+     */
+    static ManagerConfig default_config();
+
+    /**
+     * @brief Get the default registration settings (PJSIP timers, no fast failover)
+     */
+    static RegistrationConfig default_registration_config();
+
+    /**
+     * @brief Get the default admission limits (every limit disabled, Retry-After 5 s)
+     */
+    static AdmissionConfig default_admission_config();
+
     /**
      * @brief Destroy the PJSUA2Manager object
      * 
      * Stops event loop and cleans up SIP resources
      */
-    ~PJSUA2Manager();
+    ~PJSUA2Manager() override;
 
     /**
      * @brief Start the event processing loop
      * 
      * @param timeout_ms Timeout for event polling in milliseconds
      */
-    void start_event_loop(unsigned timeout_ms);
+    void start_event_loop(unsigned timeout_ms) override;
+
+    /**
+     * @brief Start an event loop that sleeps until I/O, a timer or wake()
+     * 
+     * Stop latency no longer depends on a polling timeout. Use
+     * sip_thread_cnt = 0 so the loop thread is the only ioqueue poller.
+     */
+    void start_event_loop_blocking();
 
     /**
      * @brief Stop the event processing loop
      */
-    void stop_event_loop();
+    void stop_event_loop() override;
+
+    /**
+     * @brief Process pending events on the calling thread
+     * 
+     * For embedders driving the stack from their own poll loop instead of
+     * start_event_loop(). Call it when a descriptor from get_poll_fds() is
+     * readable or the next_timer_ms() deadline expires.
+     * 
+     * @param timeout_ms Maximum time to wait for events
+     * @return int Number of events processed
+     */
+    int handle_events(unsigned timeout_ms);
+
+    /**
+     * @brief Interrupt a blocked event poll (any thread)
+     */
+    void wake();
+
+    /**
+     * @brief Collect the descriptors an external poller must watch
+     * 
+     * Contains the wake handle and the UDP transport sockets. TCP/TLS
+     * connections are not exposed; with those transports also honour
+     * next_timer_ms().
+     * 
+     * @param fds Destination array
+     * @param cap Capacity of the destination array
+     * @return int Number of descriptors written
+     */
+    int get_poll_fds(int* fds, int cap);
+
+    /**
+     * @brief Time until the earliest SIP timer fires
+     * 
+     * @return int Milliseconds (0 if already due), -1 if no timer is scheduled
+     */
+    int next_timer_ms() const;
+
+    /**
+     * @brief Register an additional SIP account on the shared endpoint
+     * 
+     * @param sip_user SIP account username
+     * @param sip_password SIP account password
+     * @param sip_domain SIP domain/server address
+     * @return int Account handle
+     * @throw Error on failure
+     */
+    int add_account(const string& sip_user, const string& sip_password, const string& sip_domain);
+
+    /**
+     * @brief Register an account with an ordered list of registrars
+     * 
+     * The account uses the first healthy registrar and fails over to the
+     * next one on timeout, transport error or 5xx/6xx, falling back once
+     * the failed one's hold-off has expired. Credentials are kept with the
+     * account so switches never involve Dart.
+     * 
+     * @param sip_user SIP account username
+     * @param sip_password SIP account password
+     * @param sip_domain SIP domain used in the account URI
+     * @param registrars Registrar URIs in preference order (empty: sip:domain)
+     * @param reg_config Timers and failover settings
+     * @return int Account handle
+     * @throw Error on failure
+     */
+    int add_account(const string& sip_user, const string& sip_password, const string& sip_domain,
+                    const vector<string>& registrars, const RegistrationConfig& reg_config);
+
+    /**
+     * @brief Health and REGISTER latency of an account's registrars
+     * 
+     * @param acc_handle Account handle
+     * @param out Destination array
+     * @param cap Capacity of the destination array
+     * @return int Number of registrars written
+     * @throw Error if the handle is unknown
+     */
+    int get_registrar_stats(int acc_handle, RegistrarStats* out, int cap);
+
+    /**
+     * @brief Remove an account, hanging up its calls
+     * 
+     * @param acc_handle Account handle
+     * @throw Error if the handle is unknown
+     */
+    void remove_account(int acc_handle);
+
+    /**
+     * @brief Change an account's identity, credentials or registrars in place
+     *
+     * Only what differs from the current account is applied, through
+     * Account::modify(); calls of the account keep running and the account
+     * re-registers. Empty strings, an empty registrar list and a null
+     * reg_config keep the current value.
+     *
+     * @param acc_handle Account to update
+     * @param sip_user New user (empty to keep)
+     * @param sip_password New password (empty to keep)
+     * @param sip_domain New domain (empty to keep)
+     * @param registrars New registrar URIs in preference order (empty to keep)
+     * @param reg_config New registration settings (nullptr to keep)
+     * @return true if the account was modified, false if nothing changed
+     * @throw Error on unknown handle or PJSIP failure
+     */
+    bool update_account(int acc_handle, const string& sip_user, const string& sip_password, const string& sip_domain,
+                        const vector<string>& registrars = vector<string>(), const RegistrationConfig* reg_config = nullptr);
+
+    /**
+     * @brief Open an additional listening transport
+     *
+     * Descriptors from get_poll_fds() must be collected again afterwards.
+     *
+     * @param type PJSIP_TRANSPORT_UDP, PJSIP_TRANSPORT_TCP or PJSIP_TRANSPORT_TLS
+     * @param port Listen port, 0 for any free port
+     * @param tls_ca_file TLS CA list file (may be NULL)
+     * @param tls_cert_file TLS certificate file (may be NULL)
+     * @param tls_privkey_file TLS private key file (may be NULL)
+     * @return int Transport id
+     * @throw Error on failure
+     */
+    int add_transport(pjsip_transport_type_e type, int port, const char* tls_ca_file = nullptr,
+                      const char* tls_cert_file = nullptr, const char* tls_privkey_file = nullptr);
+
+    /**
+     * @brief Close a transport; calls using other transports are not affected
+     *
+     * @param transport_id Id returned by add_transport()
+     * @throw Error on failure
+     */
+    void remove_transport(int transport_id);
+
+    /**
+     * @brief Apply a new ManagerConfig to the running endpoint
+     *
+     * Only fields that differ are applied: a changed port opens the new
+     * transport before closing the old one, changed TLS files (NULL meaning
+     * none) rebuild the TLS transport on its port, and both re-register the
+     * accounts; echo canceller settings are changed on the sound port and the
+     * log level on the console and file sinks. Fields the endpoint is sized or
+     * clocked with (max_calls, thread counts, media_quality, clock rates,
+     * ptime) cannot change without recreating the manager: nothing is applied
+     * and PJ_ENOTSUP is thrown. Ports and TLS files are checked before
+     * anything changes, and a PJSIP failure undoes the steps already applied,
+     * so the configuration in effect is never a mix of old and new.
+     *
+     * @param config New configuration
+     * @throw Error on unsupported change or PJSIP failure
+     */
+    void reconfigure(const ManagerConfig& config);
+
+    /**
+     * @brief Get the handle of the account created by the constructor
+     * 
+     * @return int Account handle, -1 if it has been removed
+     */
+    int default_account() const;
 
       /**
      * @brief Initiate an outgoing call
@@ -92,7 +341,18 @@ public:
      * @return string The created call's ID
      * @throw Error on failure
      */
-    string make_call(const string& dest_uri);
+    string make_call(const string& dest_uri) override;
+
+    /**
+     * @brief Initiate an outgoing call from a given account
+     * 
+     * @param acc_handle Account placing the call
+     * @param dest_uri Destination user, completed with the account's domain
+     * @param codecs Codecs to offer in preference order, empty for the account's list
+     * @return string The created call's ID
+     * @throw Error on failure
+     */
+    string make_call(int acc_handle, const string& dest_uri, const CodecList& codecs = CodecList());
 
     /**
     * @brief Answer an incoming call
@@ -100,7 +360,29 @@ public:
     * @param call_id ID of the call to answer
     * @throw Error on failure
     */
-    void answer_call(const string& call_id);
+    void answer_call(const string& call_id) override;
+
+    /**
+    * @brief Answer an incoming call with its account's codec list
+    * 
+    * @param handle Registry handle of the call to answer
+    * @throw Error on failure
+    */
+    void answer_call(int handle) override;
+
+    /**
+    * @brief Answer an incoming call
+    * 
+    * The SDP answer is built when the INVITE arrives, from the default list.
+    * If the call's list (codecs, else the account's) prefers another codec
+    * than the one negotiated, the call is re-offered once after it is
+    * confirmed.
+    * 
+    * @param handle Registry handle of the call to answer
+    * @param codecs Codecs for this call in preference order, empty for the account's list
+    * @throw Error on failure
+    */
+    void answer_call(int handle, const CodecList& codecs);
 
     /**
     * @brief Terminate a call
@@ -108,37 +390,463 @@ public:
     * @param call_id ID of the call to terminate
     * @throw Error on failure
     */
-    void hang_up_call(const string& call_id);
+    void hang_up_call(const string& call_id) override;
+
+    /**
+    * @brief Terminate a call
+    * 
+    * @param handle Registry handle of the call to terminate
+    * @throw Error on failure
+    */
+    void hang_up_call(int handle) override;
 
     /**
     * @brief Retrieve call information
     * 
     * @param call_id ID of the target call
-    * @return CallData Structure containing call details
-    * @throw Error if call not found
+    * @return CallData Structure containing call details (zeroed if not found)
+    */
+    CallData get_call_info(const string& call_id) override;
+
+    /**
+    * @brief Retrieve call information from the cached call state
+    * 
+    * @param handle Registry handle of the target call
+    * @return CallData Structure containing call details (zeroed, handle -1, if not found)
+    */
+    CallData get_call_info(int handle) override;
+
+    /**
+    * @brief Copy the cached state of every live call
+    * 
+    * The cache is maintained in onCallState, so this makes no PJSIP calls.
+    * 
+    * @param out Destination array
+    * @param cap Capacity of the destination array
+    * @return int Number of calls written
+    */
+    int get_calls_snapshot(CallData* out, int cap) const override;
+
+    /**
+    * @brief Resolve a SIP Call-ID to its registry handle
+    * 
+    * @param call_id ID of the target call
+    * @return int Handle, CallRegistry::INVALID_HANDLE if not found
+    */
+    int get_call_handle(const string& call_id) const override;
+
+    /**
+    * @brief Set the default media route for calls of an account
+    * 
+    * @param acc_handle Account handle
+    * @param route Route applied at the next media update of each call
+    */
+    void set_account_media_route(int acc_handle, const MediaRoute& route);
+
+    /**
+    * @brief Override the media route of one call, re-routing it if live
+    * 
+    * @param handle Registry handle of the call
+    * @param route Route to apply
+    * @throw Error if the handle is unknown or the route cannot be connected
+    */
+    void set_call_media_route(int handle, const MediaRoute& route);
+
+    /**
+    * @brief Connect two calls directly through the conference bridge
+    * 
+    * @param handle_a Registry handle of the first call
+    * @param handle_b Registry handle of the second call
+    * @throw Error on failure
+    */
+    void bridge_calls(int handle_a, int handle_b);
+
+    /**
+    * @brief Create a conference room
+    * 
+    * @param with_local Whether the local sound device takes part
+    * @return int Room id
+    */
+    int conference_create(bool with_local);
+
+    /**
+    * @brief Delete a room; its calls go back to their account route
+    * 
+    * @param room Room id
+    * @throw Error if the room does not exist
+    */
+    void conference_destroy(int room);
+
+    /**
+    * @brief Move a call into a room (out of its previous route or room)
+    * 
+    * @param room Room id
+    * @param handle Registry handle of the call
+    * @throw Error if the room or call does not exist, or linking fails
+    */
+    void conference_add(int room, int handle);
+
+    /**
+    * @brief Take a call out of a room, back to its account route
+    * 
+    * @param room Room id
+    * @param handle Registry handle of the call
+    * @throw Error if the call is not in the room
+    */
+    void conference_remove(int room, int handle);
+
+    /**
+    * @brief Mute or unmute a participant
+    * 
+    * @param room Room id
+    * @param handle Registry handle of the call, -1 for the local sound device
+    * @param muted Stop (true) or resume (false) sending its audio to the room
+    * @throw Error if the participant is not in the room
+    */
+    void conference_mute(int room, int handle, bool muted);
+
+    /**
+    * @brief Handles of the calls in a room
+    * 
+    * @param room Room id
+    * @param out Destination array
+    * @param cap Capacity of the destination array
+    * @return int Number of handles written
+    * @throw Error if the room does not exist
+    */
+    int conference_members(int room, int* out, int cap);
+
+    /**
+    * @brief Re-enumerate sound devices at the next use (hot-plug)
+    */
+    void refresh_audio_devices();
+
+    /**
+    * @brief Run without a sound device (gateway mode)
+    * 
+    * @param headless true to clock the bridge with the null device
+    */
+    void set_headless(bool headless);
+
+    /**
+    * @brief Record a call to a WAV file
+    * 
+    * Both parties are mixed into one mono track. Frames go through a ring
+    * buffer to a background writer, so the media clock never waits on disk.
+    * 
+    * @param handle Registry handle of the call
+    * @param path Output file path
+    * @param compressed Write G.711 mu-law instead of 16-bit PCM
+    * @throw Error if the call is unknown, already recorded or the file cannot be created
+    */
+    void start_recording(int handle, const string& path, bool compressed);
+
+    /**
+    * @brief Stop recording a call (also done automatically on disconnect)
+    * 
+    * @param handle Registry handle of the call
+    */
+    void stop_recording(int handle);
+
+    /**
+    * @brief Stream the received audio of a call into a shared-memory ring
+    * 
+    * @param handle Registry handle of the call
+    * @param frames Ring capacity in frames (ptime each)
+    * @return FrameTapHeader* Region the consumer reads in place
+    * @throw Error if the call is unknown or already tapped
+    */
+    FrameTapHeader* start_frame_tap(int handle, unsigned frames);
+
+    /**
+    * @brief Region of a tapped call
+    * 
+    * @return FrameTapHeader* nullptr if the call is not tapped
+    */
+    FrameTapHeader* get_frame_tap(int handle) const;
+
+    /**
+    * @brief Stop a tap (also done automatically on disconnect); the region stays valid
+    * 
+    * @param handle Registry handle of the call
+    */
+    void stop_frame_tap(int handle);
+
+    /**
+    * @brief Free a stopped tap region
+    * 
+    * @return true if the region was released
+    */
+    bool release_frame_tap(FrameTapHeader* region);
+
+    /**
+    * @brief Set the codec preference list of an account or of the endpoint
+    * 
+    * Codecs not in the list are disabled for those calls.
+    * 
+    * @param acc_handle Account handle, -1 for the default list
+    * @param codecs Codec ids (or prefixes) in preference order; empty resets an account
+    * @throw Error on failure
+    */
+    void set_codec_priorities(int acc_handle, const CodecList& codecs);
+
+    /**
+    * @brief Configure the Opus encoder (bitrate, complexity, channels)
+    * 
+    * @param settings New settings, 0 fields keep their value
+    * @throw Error if Opus is not available
+    */
+    void set_opus_settings(const OpusSettings& settings);
+
+    /**
+    * @brief Fall back to G.711 while max_opus_calls calls already use Opus
+    * 
+    * @param max_opus_calls Concurrent Opus call limit, -1 for no limit
     */
-    CallData get_call_info(const string& call_id);
+    void set_codec_cpu_budget(int max_opus_calls);
+
+    /**
+    * @brief Change the level of a log sink at runtime
+    *
+    * PJSIP itself logs at the highest sink level, so lowering every sink
+    * also stops messages from being formatted.
+    *
+    * @param sink Console, file or Dart
+    * @param level 0 (off) to 6
+    */
+    void set_log_level(LogSink sink, int level);
+
+    /**
+    * @brief Limit identical log messages to burst per window
+    *
+    * @param burst Messages let through per window, 0 disables the limit
+    * @param window_ms Window length in ms
+    */
+    void set_log_rate_limit(unsigned burst, unsigned window_ms);
+
+    /**
+    * @brief Write the log to a size-rotated file
+    *
+    * @param path Log file, appended to
+    * @param max_bytes Size that triggers a rotation, 0 never rotates
+    * @param max_files Rotated files kept (path.1 is the newest)
+    * @throw Error if the file cannot be opened
+    */
+    void open_log_file(const string& path, size_t max_bytes, unsigned max_files);
+
+    /**
+    * @brief Stop writing the log file
+    */
+    void close_log_file();
+
+    /**
+    * @brief Drain log records queued for Dart (PJSUA2_LOG_DART level)
+    *
+    * @param out Destination array
+    * @param max Capacity of the destination array
+    * @return int Number of records copied
+    */
+    int poll_logs(LogRecord* out, int max);
+
+    /**
+    * @brief Record signalling callbacks and call-control commands to a binary trace
+    *
+    * @param path Trace file, truncated
+    * @throw Error if the file cannot be opened
+    */
+    void start_trace(const string& path);
+
+    /**
+    * @brief Flush and close the trace
+    */
+    void stop_trace();
+
+    /**
+    * @brief Feed a recorded trace through the registry and callback layer
+    *
+    * Calls are replayed in their recorded pjsua slots without a pj::Call and
+    * produce the same events, metrics and legacy callbacks as live traffic;
+    * nothing is sent on the network and recorded commands are not executed.
+    * Runs on the calling thread and requires a manager without live calls.
+    *
+    * @param path Trace written by start_trace()
+    * @param speed 1.0 replays at the recorded pace, 2.0 twice as fast, 0 as fast as possible
+    * @return TraceReplayStats What was replayed
+    * @throw Error if the file is not a trace or calls are in progress
+    */
+    TraceReplayStats replay_trace(const string& path, double speed);
+
+    /**
+    * @brief Set how often the event thread samples RTP/RTCP statistics
+    * 
+    * @param interval_ms Sampling period, 0 stops sampling
+    */
+    void set_quality_interval(unsigned interval_ms);
+
+    /**
+    * @brief Set the thresholds raising PJSUA2_EVENT_QUALITY_ALERT events
+    * 
+    * @param thresholds New thresholds, 0 fields disabled
+    */
+    void set_quality_thresholds(const QualityThresholds& thresholds);
+
+    /**
+    * @brief Copy the latest quality block of every sampled call
+    * 
+    * @param out Destination array
+    * @param cap Capacity of the destination array
+    * @return int Number of blocks written
+    */
+    int get_call_quality(CallQualityData* out, int cap) const;
+
+    /**
+    * @brief Report process RSS, PJSIP pool usage and call pool occupancy
+    * 
+    * @param out Destination
+    */
+    void get_memory_stats(MemoryStats& out) const;
+
+    /**
+    * @brief Export call counters and signalling latency histograms
+    * 
+    * @param out Destination
+    */
+    void get_metrics(MetricsData& out) const;
+
+    /**
+    * @brief Reset call counters, signalling latency histograms and admission counters
+    */
+    void reset_metrics();
+
+    /**
+    * @brief Set the limits applied to incoming INVITEs
+    * 
+    * Refused calls are answered with 486 (account at its limit) or 503
+    * (call rate, event queue depth, SIP timer lag, CPU) and Retry-After,
+    * before any call object or event is created.
+    * 
+    * @param config New limits, 0 fields disabled
+    * @throw Error if the version is unsupported
+    */
+    void set_admission_config(const AdmissionConfig& config);
+
+    /**
+    * @brief Export admission counters and the latest load samples
+    * 
+    * @param out Destination
+    */
+    void get_admission_stats(AdmissionStats& out) const;
+
+    /**
+    * @brief Set the INVITE headers attached to incoming call events
+    * 
+    * Their values are appended as "name\0value" pairs to the strings of
+    * PJSUA2_EVENT_INCOMING_CALL, after the Call-ID and URIs.
+    * 
+    * @param names Header names (e.g. X-Caller-Id, P-Asserted-Identity), empty disables
+    * @throw Error if a name is empty or not a header token
+    */
+    void set_invite_headers(const vector<string>& names);
+
+    /**
+    * @brief Queue an outgoing call to be placed on the event thread
+    * 
+    * Completion is reported as a PJSUA2_EVENT_COMMAND_DONE event carrying the
+    * returned request id. Requires a running or externally driven event loop.
+    * 
+    * @param acc_handle Account placing the call
+    * @param dest_uri Destination user, completed with the account's domain
+    * @return int Request id
+    */
+    int submit_make_call(int acc_handle, const string& dest_uri) override;
+
+    /**
+    * @brief Queue several outgoing calls in one submission
+    * 
+    * @param acc_handle Account placing the calls
+    * @param dest_uris Destinations
+    * @param out_request_ids Receives one request id per destination (may be null)
+    */
+    void submit_make_calls(int acc_handle, const vector<string>& dest_uris, int* out_request_ids);
+
+    /**
+    * @brief Queue answering an incoming call on the event thread
+    * 
+    * @param handle Registry handle of the call
+    * @return int Request id
+    */
+    int submit_answer_call(int handle) override;
+
+    /**
+    * @brief Queue terminating a call on the event thread
+    * 
+    * @param handle Registry handle of the call
+    * @return int Request id
+    */
+    int submit_hang_up_call(int handle) override;
+
+    /**
+    * @brief Drain queued events without blocking the SIP threads
+    * 
+    * @param out Destination array
+    * @param max Capacity of the destination array
+    * @return int Number of events copied
+    */
+    int poll_events(EventData* out, int max, char* strings, size_t strings_cap) override;
+
+    /**
+    * @brief Get the event notification handle
+    * 
+    * @return int eventfd readable while events are pending, -1 if unavailable
+    */
+    int event_fd() const override;
 private:
+    class PJSUA2Account;
+    class PJSUA2Endpoint;
     friend class PJSUA2Account;  /**< Friend class for account management */
+    friend class PJSUA2Endpoint; /**< Friend class for endpoint timers */
     friend class PJSUA2Call;     /**< Friend class for call operations */
 
+    static const unsigned BLOCKING_WAIT_MS = 3600 * 1000; /**< Poll timeout of the blocking loop */
+    static const size_t LOW_MEMORY_POOL_CACHE = 256 * 1024; /**< Released PJSIP pools kept for reuse in the low memory profile */
+    static const unsigned QUALITY_INTERVAL_MS = 5000; /**< Default RTP/RTCP sampling period */
+
     atomic<bool> _isRunning;                     /**< Event loop control flag */
+    atomic<bool> _loopExited;                    /**< Event thread has left its loop */
+    LogPipeline _log;                            /**< PJSIP and manager log (outlives the endpoint) */
     unique_ptr<Endpoint> _endpoint;               /**< PJSUA2 endpoint instance */
-    unique_ptr<Account> _account;                 /**< SIP account instance */
-    unordered_map<string, unique_ptr<Call>> _activeCalls;   /**< Active calls map */
-    unordered_map<string, unique_ptr<Call>> _inboundCalls;  /**< Incoming calls map */
-    unordered_map<string, unique_ptr<Call>> _outboundCalls; /**< Outgoing calls map */
+    EventWaker _waker;                            /**< Interrupts blocked ioqueue polls */
+    unordered_map<int, unique_ptr<PJSUA2Account>> _accounts; /**< Accounts by handle */
+    atomic<int> _defaultAccount;                  /**< Handle of the constructor's account */
+    CallPool _callPool;                           /**< Preallocated PJSUA2Call storage (outlives _calls) */
+    CallRegistry _calls;                          /**< Calls indexed by pjsua call index */
+    CallMetrics _metrics;                         /**< Call lifecycle timestamps and histograms */
+    MediaRouter _media;                           /**< Call audio routing */
+    ConferenceRooms _rooms;                       /**< Conference rooms */
+    CallRecorder _recorder;                       /**< Call recordings */
+    FrameTap _taps;                               /**< Shared-memory audio taps */
+    CodecPolicy _codecs;                          /**< Codec preference lists */
+    CallQuality _quality;                         /**< Per-call RTP/RTCP quality blocks */
+    TraceRecorder _trace;                         /**< Signalling and command trace */
+    AdmissionControl _admission;                  /**< Limits on incoming calls */
+    InviteHeaders _inviteHeaders;                 /**< Headers copied into incoming call events */
+    mutex _admissionTimerMutex;                   /**< Guards the load sampling timer */
+    Token _admissionTimer;                        /**< Pending load sampling timer */
+    bool _admissionTimerArmed;                    /**< _admissionTimer is scheduled */
+    bool _admissionSampling;                      /**< Load sampling runs, cleared on destruction */
+    atomic<unsigned> _qualityIntervalMs;          /**< Sampling period, 0 disabled */
+    atomic<bool> _qualityDue;                     /**< Sampling timer fired, event thread must sample */
+    mutex _qualityTimerMutex;                     /**< Guards the sampling timer */
+    Token _qualityTimer;                          /**< Pending sampling timer */
+    bool _qualityTimerArmed;                      /**< _qualityTimer is scheduled */
     thread _eventThread;                          /**< Event processing thread */
 
-    // Account infos
-    string _sipDomain; /**< Sip domain */
-    string _sipUser; /**< Sip user */
+    ManagerConfig _config;                        /**< Configuration in effect */
+    string _tlsFiles[3];                          /**< Storage of the TLS paths of _config (CA, certificate, key) */
+    unordered_map<int, int> _configTransports;    /**< Transport id by pjsip_transport_type_e, for those opened from _config */
 
     // Mutex
-    recursive_mutex _activeCallsMutex;                                 /**< Synchronization active calls mutex */
-    recursive_mutex _inboundCallsMutex;                                 /**< Synchronization inbound calls mutex */
-    recursive_mutex _outboundCallsMutex;                                 /**< Synchronization outbound calls mutex */
-
+    recursive_mutex _accountsMutex;               /**< Synchronization accounts mutex */
 
     // Callback handlers
     DartIncomingCallStateCb _onIncomingCallStateCb; /**< Incoming call callback */
@@ -146,14 +854,156 @@ private:
     DartCallStateCb _onCallStateCb;               /**< Call state callback */
     DartOnErrorCb _onErrorCb;                     /**< Error callback */
 
+    EventQueue _events;                           /**< Events awaiting pjsua2_poll_events */
+    CommandQueue _commands;                       /**< Commands awaiting the event thread */
+    vector<Command> _runningCommands;             /**< Batch being run (event thread only) */
+    atomic<int> _internedCalls[PJSUA_MAX_CALLS];  /**< Handle whose strings were sent, per call index */
+
+    /**
+     * @brief Create and start the endpoint, transports and account
+     * 
+     * @param sip_user SIP account username
+     * @param sip_password SIP account password
+     * @param sip_domain SIP domain/server address
+     */
+    void _init(const string& sip_user, const string& sip_password, const string& sip_domain);
+
+    /**
+     * @brief Create one SIP transport if its port is enabled
+     * 
+     * @param type Transport type
+     * @param port Listen port, -1 to skip
+     * @param tls_ca_file TLS CA list file (may be NULL)
+     * @param tls_cert_file TLS certificate file (may be NULL)
+     * @param tls_privkey_file TLS private key file (may be NULL)
+     * @return int Transport id, -1 if skipped
+     */
+    int _create_transport(pjsip_transport_type_e type, int port, const char* tls_ca_file,
+                          const char* tls_cert_file, const char* tls_privkey_file);
+
+    /**
+     * @brief Copy the TLS paths of config and point _config at the copies
+     */
+    void _set_tls_files(const ManagerConfig& config);
+
+    /**
+     * @brief True if config names other TLS files than those in effect (NULL as empty)
+     */
+    bool _tls_files_changed(const ManagerConfig& config) const;
+
+    /**
+     * @brief Move the ManagerConfig transports to new ports or TLS files
+     *
+     * All replacements are opened before any replaced transport is closed,
+     * except on the same port where the old one must go first. If one fails,
+     * the others are put back and _config is left as it was; a transport
+     * that cannot be restored is reported with port -1.
+     *
+     * @param config New configuration (ports, TLS files, may be NULL)
+     * @return true if a transport was replaced
+     */
+    bool _reconfigure_transports(const ManagerConfig& config);
+
+    /**
+     * @brief Register the calling thread with PJLIB if needed
+     */
+    void _register_thread();
+
     /**
      * @brief Internal event processing method
      * 
      * @param timeout_ms Event polling timeout
+     * @return int Number of events processed
      */
-    void _handle_events(unsigned timeout_ms);
+    int _handle_events(unsigned timeout_ms);
 
 
+    /**
+     * @brief Connect a call's audio according to its media route
+     * 
+     * @param index pjsua call index
+     * @param acc_handle Account owning the call
+     * @param media Audio media of the call
+     */
+    void _route_media(int index, int acc_handle, AudioMedia& media);
+
+    /**
+     * @brief Registrar timer of an account expired (SIP/event thread)
+     * 
+     * @param account PJSUA2Account the timer belongs to
+     */
+    void _on_registrar_timer(Token account);
+
+    /**
+     * @brief Quality sampling timer expired (SIP/event thread): hand over to the event thread
+     */
+    void _on_quality_timer();
+
+    /**
+     * @brief Arm the quality sampling timer if sampling is enabled
+     */
+    void _schedule_quality_timer();
+
+    /**
+     * @brief Sample the audio streams of every call (event thread)
+     */
+    void _sample_quality();
+
+    /**
+     * @brief Load sampling timer expired (SIP/event thread): sample lag and CPU, re-arm
+     */
+    void _on_admission_timer();
+
+    /**
+     * @brief Arm the load sampling timer, if a lag or CPU limit is set
+     */
+    void _schedule_admission_timer();
+
+    /**
+     * @brief Disarm the load sampling timer
+     */
+    void _cancel_admission_timer();
+
+    /**
+     * @brief Run admission control on an incoming INVITE (SIP thread)
+     * 
+     * @param acc_handle Account receiving the call
+     * @return AdmissionVerdict ADMISSION_ACCEPT or the reason to refuse it
+     */
+    AdmissionVerdict _admit_call(int acc_handle);
+
+    /**
+     * @brief Refuse an incoming INVITE with 486/503 and Retry-After (SIP thread)
+     * 
+     * @param index pjsua call index
+     * @param verdict Reason of the rejection
+     */
+    void _reject_call(int index, AdmissionVerdict verdict);
+
+    /**
+     * @brief Run the commands queued since the last poll (event thread)
+     */
+    void _run_commands();
+
+    /**
+     * @brief Program the codec table used for incoming INVITEs (table mutex held)
+     */
+    void _apply_inbound_codecs();
+
+    /**
+     * @brief Queue a re-INVITE of a call with its own codec list
+     * 
+     * @param index pjsua call index
+     */
+    void _submit_reoffer(int index);
+
+    /**
+     * @brief Re-INVITE a call offering its own codec list (event thread)
+     * 
+     * @param handle Registry handle of the call
+     */
+    void _reoffer_call(int handle);
+
     /**
      * @brief Error handling method
      * 
@@ -161,14 +1011,143 @@ private:
      */
     void _handle_error(const Error &e);
 
+    /**
+     * @brief Stamp an event record and queue it for Dart
+     * 
+     * @param event Record with its type and payload filled in
+     * @param text Reason attached to the record (may be empty)
+     */
+    void _queue_event(EventData& event, const string& text);
+
+    /**
+     * @brief Queue a registration, error or command event for Dart
+     * 
+     * @param type Event type
+     * @param code SIP status code
+     * @param state Registration state or status
+     * @param call_handle Registry handle of the call (or -1)
+     * @param acc_handle Handle of the account (or -1)
+     * @param text Reason (may be empty)
+     */
+    void _push_event(EventType type, int code, int state, int call_handle, int acc_handle, const string& text);
+
+    /**
+     * @brief Queue a call event, attaching the call's strings to its first event
+     * 
+     * @param type Event type
+     * @param code SIP status code
+     * @param state pjsip_inv_state
+     * @param index pjsua call index
+     * @param call_handle Registry handle of the call
+     * @param info Current call info
+     * @param extra Strings appended after the call's strings when they are attached;
+     * "\0name\0value" pairs that do not fit are added to code
+     */
+    void _push_call_event(EventType type, int code, int state, int index, int call_handle, const CallInfo& info,
+                          const string& extra = string());
+
+    /**
+     * @brief Report a registration result (SIP thread or trace replay)
+     * 
+     * @param acc_handle Handle of the account
+     * @param code SIP status code
+     * @param active Registration is active
+     * @param reason Reason with the registrar and latency
+     */
+    void _on_reg_state(int acc_handle, int code, bool active, const string& reason);
+
+    /**
+     * @brief Store an incoming call and report it (SIP thread or trace replay)
+     * 
+     * @param index pjsua call index
+     * @param call Call object, null for a replayed call
+     * @param info Current call info
+     * @param acc_handle Handle of the account receiving the call
+     * @param headers Extracted INVITE headers ("\0name\0value" pairs)
+     * @param dropped Configured headers present in the INVITE but not extracted
+     */
+    void _on_incoming_call(int index, unique_ptr<Call> call, const CallInfo& info, int acc_handle,
+                           const string& headers = string(), int dropped = 0);
+
+    /**
+     * @brief Apply a call state change (SIP thread or trace replay)
+     * 
+     * On DISCONNECTED the registry releases and deletes call if it still owns it.
+     * 
+     * @param index pjsua call index
+     * @param info Current call info
+     * @param call Call object reporting the change, null for a replayed call
+     */
+    void _on_call_state(int index, const CallInfo& info, Call* call);
+
     /**
      * @brief Nested class for SIP account management
      */
     class PJSUA2Account : public Account {
     private:
         PJSUA2Manager& m_manager; /**< Reference to parent manager */
+        string m_sipUser;         /**< Sip user */
+        string m_sipDomain;       /**< Sip domain */
+        AccountConfig m_config;   /**< Config with credentials, reused on registrar switch */
+        RegistrationConfig m_regConfig; /**< Registration settings in effect */
+        bool m_defaultRegistrar;  /**< Registrar derived from the domain */
+        RegistrarPool m_registrars; /**< Registrars and their health */
+        mutex m_timerMutex;       /**< Guards the timer */
+        Token m_timer;            /**< Pending registrar timer */
+        bool m_timerArmed;        /**< m_timer is scheduled */
+
+        /**
+         * @brief (Re)arm the registrar timer
+         */
+        void _schedule(unsigned msec);
     public:
-        PJSUA2Account(PJSUA2Manager& manager) : m_manager(manager) {}
+        PJSUA2Account(PJSUA2Manager& manager, const string& sip_user, const string& sip_domain,
+                      const vector<string>& registrars, const RegistrationConfig& reg_config)
+            : m_manager(manager), m_sipUser(sip_user), m_sipDomain(sip_domain), m_regConfig(reg_config),
+              m_defaultRegistrar(registrars.empty()),
+              m_registrars(registrars.empty() ? vector<string>{"sip:" + sip_domain} : registrars, reg_config),
+              m_timer(nullptr), m_timerArmed(false) {}
+
+        /**
+         * @brief Cancel the registrar timer
+         */
+        ~PJSUA2Account();
+
+        /**
+         * @brief Create the account on its first registrar
+         */
+        void start(const AccountConfig& config, bool make_default);
+
+        /**
+         * @brief Apply changed identity, credentials or registrars with modify()
+         *
+         * Empty strings, an empty registrar list and a null reg_config keep
+         * the current value. Calls of the account are not touched.
+         *
+         * @return true if the account was modified
+         */
+        bool update(const string& sip_user, const string& sip_password, const string& sip_domain,
+                    const vector<string>& registrars, const RegistrationConfig* reg_config);
+
+        /**
+         * @brief Sip domain used to complete outgoing destinations
+         */
+        const string& sip_domain() const { return m_sipDomain; }
+
+        /**
+         * @brief Registrar health
+         */
+        const RegistrarPool& registrars() const { return m_registrars; }
+
+        /**
+         * @brief REGISTER deadline or pending switch (timer callback)
+         */
+        void on_registrar_timer();
+
+        /**
+         * @brief Time REGISTER transactions
+         */
+        virtual void onRegStarted(OnRegStartedParam &prm) override;
 
          /**
          * @brief Handle registration state changes
@@ -181,6 +1160,21 @@ private:
         virtual void onIncomingCall(OnIncomingCallParam &prm) override;
     };
 
+    /**
+     * @brief Endpoint forwarding timer callbacks to the manager
+     */
+    class PJSUA2Endpoint : public Endpoint {
+    private:
+        PJSUA2Manager& m_manager; /**< Reference to parent manager */
+    public:
+        explicit PJSUA2Endpoint(PJSUA2Manager& manager) : m_manager(manager) {}
+
+        /**
+         * @brief Timers scheduled with utilTimerSchedule (user data: an account, the quality or the load sampler)
+         */
+        virtual void onTimer(const OnTimerParam &prm) override;
+    };
+
     /**
      * @brief Nested class for call operations
      */
@@ -190,6 +1184,21 @@ private:
     public:
         PJSUA2Call(PJSUA2Manager& manager, Account &acc, int call_id);
 
+        /**
+         * @brief Place the call in a slot of the manager's call pool
+         */
+        static void* operator new(size_t size, CallPool& pool) { return pool.allocate(size); }
+
+        /**
+         * @brief Return the slot if the constructor throws
+         */
+        static void operator delete(void* ptr, CallPool& pool) { PJ_UNUSED_ARG(pool); CallPool::deallocate(ptr); }
+
+        /**
+         * @brief Recycle the slot when the registry drops the call
+         */
+        static void operator delete(void* ptr) { CallPool::deallocate(ptr); }
+
          /**
          * @brief Handle call state changes
          */
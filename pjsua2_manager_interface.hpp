@@ -0,0 +1,115 @@
+#ifndef PJSUA2_MANAGER_INTERFACE_H
+#define PJSUA2_MANAGER_INTERFACE_H
+
+#include "call_registry.hpp"
+#include "event_queue.hpp"
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Call-control surface of the manager behind the FFI handle.
+ *
+ * PJSUA2Manager implements it on top of PJSIP. The call-control shims of
+ * ffi_bindings.cpp only go through this interface, so tests and benchmarks
+ * can hand them a mock or fake backend instead of a live SIP stack. A
+ * PJSUA2ManagerPtr always points at an IPJSUA2Manager.
+ */
+class IPJSUA2Manager {
+public:
+    virtual ~IPJSUA2Manager() = default;
+
+    /**
+     * @brief Place a call from the default account
+     *
+     * @return std::string Call-ID of the new call
+     */
+    virtual std::string make_call(const std::string& dest_uri) = 0;
+
+    /**
+     * @brief Answer an incoming call by Call-ID
+     */
+    virtual void answer_call(const std::string& call_id) = 0;
+
+    /**
+     * @brief Hang up a call by Call-ID
+     */
+    virtual void hang_up_call(const std::string& call_id) = 0;
+
+    /**
+     * @brief Cached information of a call by Call-ID
+     */
+    virtual CallData get_call_info(const std::string& call_id) = 0;
+
+    /**
+     * @brief Start processing events on a background thread
+     */
+    virtual void start_event_loop(unsigned timeout_ms) = 0;
+
+    /**
+     * @brief Stop the background event thread
+     */
+    virtual void stop_event_loop() = 0;
+
+    /**
+     * @brief Handle of a call by Call-ID, -1 if unknown
+     */
+    virtual int get_call_handle(const std::string& call_id) const = 0;
+
+    /**
+     * @brief Answer an incoming call by handle
+     */
+    virtual void answer_call(int handle) = 0;
+
+    /**
+     * @brief Hang up a call by handle
+     */
+    virtual void hang_up_call(int handle) = 0;
+
+    /**
+     * @brief Cached information of a call by handle
+     */
+    virtual CallData get_call_info(int handle) = 0;
+
+    /**
+     * @brief Copy the cached information of every live call
+     *
+     * @return int Number of records written
+     */
+    virtual int get_calls_snapshot(CallData* out, int cap) const = 0;
+
+    /**
+     * @brief Queue an outgoing call, completed by a PJSUA2_EVENT_COMMAND_DONE event
+     *
+     * @return int Request id
+     */
+    virtual int submit_make_call(int acc_handle, const std::string& dest_uri) = 0;
+
+    /**
+     * @brief Queue answering a call
+     *
+     * @return int Request id
+     */
+    virtual int submit_answer_call(int handle) = 0;
+
+    /**
+     * @brief Queue hanging up a call
+     *
+     * @return int Request id
+     */
+    virtual int submit_hang_up_call(int handle) = 0;
+
+    /**
+     * @brief Drain queued events (single consumer)
+     *
+     * @return int Number of records copied
+     */
+    virtual int poll_events(EventData* out, int max, char* strings, size_t strings_cap) = 0;
+
+    /**
+     * @brief Handle readable while events are pending, -1 if unavailable
+     */
+    virtual int event_fd() const = 0;
+};
+
+#endif // PJSUA2_MANAGER_INTERFACE_H
@@ -0,0 +1,166 @@
+#include "registrar_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace pj;
+using namespace std;
+
+RegistrarPool::RegistrarPool(const vector<string>& uris, const RegistrationConfig& config)
+    : _current(0), _next(0), _switchPending(false), _inFlight(false), _unregistering(false), _startedUs(0),
+      _registerTimeoutMs(config.register_timeout_ms), _failbackUs((uint64_t)config.failback_sec * 1000000) {
+    for (const string& uri : uris) {
+        Registrar registrar;
+        registrar.uri = uri;
+        _registrars.push_back(registrar);
+    }
+}
+
+void RegistrarPool::reset(const vector<string>& uris, const RegistrationConfig& config) {
+    lock_guard<mutex> lock(_mutex);
+    _registrars.clear();
+    for (const string& uri : uris) {
+        Registrar registrar;
+        registrar.uri = uri;
+        _registrars.push_back(registrar);
+    }
+    _current = 0;
+    _next = 0;
+    _switchPending = false;
+    _inFlight = false;
+    _registerTimeoutMs = config.register_timeout_ms;
+    _failbackUs = (uint64_t)config.failback_sec * 1000000;
+}
+
+vector<string> RegistrarPool::uris() const {
+    lock_guard<mutex> lock(_mutex);
+    vector<string> uris;
+    for (const Registrar& registrar : _registrars) {
+        uris.push_back(registrar.uri);
+    }
+    return uris;
+}
+
+string RegistrarPool::current() const {
+    lock_guard<mutex> lock(_mutex);
+    return _registrars[_current].uri;
+}
+
+void RegistrarPool::started(bool renew, uint64_t now_us) {
+    lock_guard<mutex> lock(_mutex);
+    _unregistering = !renew;
+    _inFlight = renew;
+    _startedUs = now_us;
+}
+
+bool RegistrarPool::completed(pj_status_t status, int code, int expiration, uint64_t now_us,
+                              uint64_t& latency_us, string& uri) {
+    lock_guard<mutex> lock(_mutex);
+    Registrar& registrar = _registrars[_current];
+    uri = registrar.uri;
+    latency_us = 0;
+
+    if (_unregistering || (!_inFlight && expiration == 0)) {
+        // Un-REGISTER (account removed or registrar switch): says nothing about health
+        _unregistering = false;
+        return false;
+    }
+    if (_inFlight) {
+        latency_us = now_us - _startedUs;
+        _inFlight = false;
+    }
+    registrar.lastCode = code;
+
+    if (status == PJ_SUCCESS && code / 100 == 2) {
+        registrar.failures = 0;
+        registrar.downUntilUs = 0;
+        if (latency_us) {
+            registrar.lastLatencyUs = latency_us;
+            registrar.avgLatencyUs = registrar.avgLatencyUs
+                ? (registrar.avgLatencyUs * 7 + latency_us) / 8
+                : latency_us;
+        }
+        // Fail back to the first earlier registrar whose hold-off is over
+        for (size_t i = 0; i < _current; i++) {
+            if (_registrars[i].downUntilUs <= now_us) {
+                _next = i;
+                _switchPending = true;
+                break;
+            }
+        }
+        return _switchPending;
+    }
+
+    if (status == PJ_SUCCESS && code != 408 && code / 100 == 4) {
+        // Credentials or request problem: another registrar would answer the same
+        return false;
+    }
+    return _fail(code ? code : 408, now_us);
+}
+
+bool RegistrarPool::timed_out(uint64_t now_us) {
+    lock_guard<mutex> lock(_mutex);
+    if (!_inFlight || _registerTimeoutMs == 0) return false;
+    if (now_us - _startedUs < (uint64_t)_registerTimeoutMs * 1000) return false;
+    _inFlight = false;
+    _registrars[_current].lastCode = 408;
+    return _fail(408, now_us);
+}
+
+bool RegistrarPool::_fail(int code, uint64_t now_us) {
+    Registrar& registrar = _registrars[_current];
+    registrar.failures++;
+    registrar.lastCode = code;
+    registrar.downUntilUs = now_us + _failbackUs;
+
+    // Next healthy registrar after the current one, wrapping around
+    for (size_t step = 1; step < _registrars.size(); step++) {
+        size_t i = (_current + step) % _registrars.size();
+        if (_registrars[i].downUntilUs <= now_us) {
+            _next = i;
+            _switchPending = true;
+            return true;
+        }
+    }
+    // All down: stay and let the account's retry interval run
+    return false;
+}
+
+bool RegistrarPool::take_switch(string& uri) {
+    lock_guard<mutex> lock(_mutex);
+    if (!_switchPending) return false;
+    _switchPending = false;
+    if (_next == _current) return false;
+    _current = _next;
+    _inFlight = false;
+    uri = _registrars[_current].uri;
+    return true;
+}
+
+int RegistrarPool::stats(RegistrarStats* out, int cap, uint64_t now_us) const {
+    if (!out || cap <= 0) return 0;
+    lock_guard<mutex> lock(_mutex);
+    int n = 0;
+    for (size_t i = 0; i < _registrars.size() && n < cap; i++, n++) {
+        const Registrar& registrar = _registrars[i];
+        RegistrarStats& stat = out[n];
+        memset(&stat, 0, sizeof(stat));
+        size_t len = min(registrar.uri.size(), sizeof(stat.uri) - 1);
+        memcpy(stat.uri, registrar.uri.data(), len);
+        stat.active = i == _current ? 1 : 0;
+        stat.healthy = registrar.downUntilUs <= now_us ? 1 : 0;
+        stat.failures = registrar.failures;
+        stat.last_code = registrar.lastCode;
+        stat.last_latency_us = registrar.lastLatencyUs;
+        stat.avg_latency_us = registrar.avgLatencyUs;
+    }
+    return n;
+}
+
+void RegistrarPool::apply_timers(const RegistrationConfig& config, AccountConfig& accCfg) {
+    if (config.reg_timeout_sec) accCfg.regConfig.timeoutSec = config.reg_timeout_sec;
+    if (config.retry_interval_sec) accCfg.regConfig.retryIntervalSec = config.retry_interval_sec;
+    if (config.first_retry_interval_sec) accCfg.regConfig.firstRetryIntervalSec = config.first_retry_interval_sec;
+    if (config.delay_before_refresh_sec) accCfg.regConfig.delayBeforeRefreshSec = config.delay_before_refresh_sec;
+    if (config.keep_alive_sec >= 0) accCfg.natConfig.udpKaIntervalSec = config.keep_alive_sec;
+}
@@ -0,0 +1,160 @@
+#ifndef REGISTRAR_POOL_H
+#define REGISTRAR_POOL_H
+
+#include <pjsua2.hpp>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define PJSUA2_REGISTRATION_CONFIG_VERSION 1
+
+/**
+ * @brief Registration timers and failover settings of an account.
+ *
+ * Fill it with pjsua2_registration_config_default() and override fields;
+ * 0 (or -1 for keep_alive_sec) keeps the PJSIP default.
+ */
+typedef struct {
+    int version;                      /**< PJSUA2_REGISTRATION_CONFIG_VERSION */
+    unsigned reg_timeout_sec;         /**< Registration expiry (re-register interval) */
+    unsigned retry_interval_sec;      /**< Retry delay once registration failed */
+    unsigned first_retry_interval_sec;/**< First retry delay after a failure */
+    unsigned delay_before_refresh_sec;/**< Refresh this long before expiry */
+    int keep_alive_sec;               /**< UDP keep-alive interval, 0 disables, -1 default */
+    unsigned register_timeout_ms;     /**< Fail over when a REGISTER gets no final response in time, 0 waits for the transaction timeout */
+    unsigned failback_sec;            /**< Time a failed registrar is skipped before being tried again */
+} RegistrationConfig;
+
+/**
+ * @brief Health of one registrar, as exported to Dart.
+ */
+typedef struct {
+    char uri[128];                    /**< Registrar URI */
+    int active;                       /**< 1 if the account currently uses it */
+    int healthy;                      /**< 0 while it is skipped after a failure */
+    int failures;                     /**< Consecutive failures */
+    int last_code;                    /**< Last final status code (408 for local timeouts) */
+    uint64_t last_latency_us;         /**< Last REGISTER round trip */
+    uint64_t avg_latency_us;          /**< Smoothed REGISTER round trip */
+} RegistrarStats;
+
+
+/**
+ * @brief Ordered registrars of an account with health tracking.
+ *
+ * The account registers with the first healthy registrar. A transport
+ * error, timeout or 5xx/6xx marks the current registrar unhealthy for
+ * failback_sec and asks for a switch to the next healthy one; a successful
+ * registration on a backup asks to switch back once an earlier registrar's
+ * hold-off has expired. Authentication and other 4xx failures do not count
+ * against the registrar. The pool only decides: the account applies a
+ * switch from the event thread with Account::modify().
+ */
+class RegistrarPool {
+public:
+    /**
+     * @brief Construct a new RegistrarPool
+     *
+     * @param uris Registrar URIs in preference order (at least one)
+     * @param config Registration settings
+     */
+    RegistrarPool(const std::vector<std::string>& uris, const RegistrationConfig& config);
+
+    /**
+     * @brief Replace the registrars and settings, starting over with the first
+     *
+     * @param uris Registrar URIs in preference order (at least one)
+     * @param config Registration settings
+     */
+    void reset(const std::vector<std::string>& uris, const RegistrationConfig& config);
+
+    /**
+     * @brief Registrar URIs in preference order
+     */
+    std::vector<std::string> uris() const;
+
+    /**
+     * @brief URI of the registrar in use
+     */
+    std::string current() const;
+
+    /**
+     * @brief REGISTER (renew) or un-REGISTER sent (onRegStarted)
+     */
+    void started(bool renew, uint64_t now_us);
+
+    /**
+     * @brief Final response received (onRegState)
+     *
+     * @param status Transport/transaction status
+     * @param code SIP status code
+     * @param expiration Granted expiry, 0 for an un-registration
+     * @param now_us Current monotonic time
+     * @param latency_us Receives the round trip, 0 if not timed
+     * @param uri Receives the registrar the response belongs to
+     * @return true if the account should switch registrar
+     */
+    bool completed(pj_status_t status, int code, int expiration, uint64_t now_us,
+                   uint64_t& latency_us, std::string& uri);
+
+    /**
+     * @brief Check the REGISTER deadline; an expired one counts as a failure
+     *
+     * @return true if the account should switch registrar
+     */
+    bool timed_out(uint64_t now_us);
+
+    /**
+     * @brief Move to the registrar chosen by the last failure or failback
+     *
+     * @param uri Receives the new registrar URI
+     * @return true if there was a switch to apply
+     */
+    bool take_switch(std::string& uri);
+
+    /**
+     * @brief Copy the health of each registrar
+     *
+     * @return int Number of registrars written
+     */
+    int stats(RegistrarStats* out, int cap, uint64_t now_us) const;
+
+    /**
+     * @brief REGISTER deadline in ms, 0 if disabled
+     */
+    unsigned register_timeout_ms() const { return _registerTimeoutMs; }
+
+    /**
+     * @brief Apply the timers of a registration config to an account config
+     */
+    static void apply_timers(const RegistrationConfig& config, pj::AccountConfig& accCfg);
+
+private:
+    struct Registrar {
+        std::string uri;            /**< Registrar URI */
+        int failures = 0;           /**< Consecutive failures */
+        int lastCode = 0;           /**< Last final status */
+        uint64_t lastLatencyUs = 0; /**< Last round trip */
+        uint64_t avgLatencyUs = 0;  /**< Smoothed round trip */
+        uint64_t downUntilUs = 0;   /**< Skipped until this time */
+    };
+
+    /**
+     * @brief Record a failure of the current registrar and pick the next (lock held)
+     */
+    bool _fail(int code, uint64_t now_us);
+
+    mutable std::mutex _mutex;          /**< Guards the pool */
+    std::vector<Registrar> _registrars; /**< In preference order */
+    size_t _current;                    /**< Registrar in use */
+    size_t _next;                       /**< Switch target */
+    bool _switchPending;                /**< _next must be applied */
+    bool _inFlight;                     /**< REGISTER awaiting its final response */
+    bool _unregistering;                /**< Next response belongs to an un-REGISTER */
+    uint64_t _startedUs;                /**< When the REGISTER was sent */
+    unsigned _registerTimeoutMs;        /**< REGISTER deadline */
+    uint64_t _failbackUs;               /**< Hold-off of a failed registrar */
+};
+
+#endif // REGISTRAR_POOL_H
@@ -0,0 +1,47 @@
+#include "shard_ipc.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+using namespace std;
+
+bool shard_send(int fd, const void* head, size_t head_len, const void* body, size_t body_len, bool wait) {
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<void*>(head);
+    iov[0].iov_len = head_len;
+    iov[1].iov_base = const_cast<void*>(body);
+    iov[1].iov_len = body_len;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = body_len ? 2 : 1;
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(fd, &msg, MSG_NOSIGNAL | (wait ? 0 : MSG_DONTWAIT));
+    } while (sent < 0 && errno == EINTR);
+    return sent == (ssize_t)(head_len + body_len);
+}
+
+ssize_t shard_recv(int fd, void* buf, size_t cap, bool wait) {
+    ssize_t len;
+    do {
+        len = recv(fd, buf, cap, wait ? 0 : MSG_DONTWAIT);
+    } while (len < 0 && errno == EINTR);
+    return len;
+}
+
+vector<string> shard_split(const char* data, size_t len) {
+    vector<string> out;
+    size_t start = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == '\0') {
+            out.emplace_back(data + start, i - start);
+            start = i + 1;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,76 @@
+#ifndef SHARD_IPC_H
+#define SHARD_IPC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * @brief Requests sent by the supervisor to a shard worker.
+ */
+typedef enum {
+    SHARD_OP_INIT = 1,               /**< ManagerConfig followed by "ca\0cert\0key\0" */
+    SHARD_OP_ACCOUNT_ADD = 2,        /**< "user\0password\0domain\0", value: account handle */
+    SHARD_OP_ACCOUNT_REMOVE = 3,     /**< args[0]: account handle */
+    SHARD_OP_MAKE_CALL = 4,          /**< args[0]: account handle, "uri\0", value: call handle */
+    SHARD_OP_ANSWER_CALL = 5,        /**< args[0]: call handle */
+    SHARD_OP_HANGUP_CALL = 6,        /**< args[0]: call handle */
+    SHARD_OP_SUBMIT_MAKE_CALL = 7,   /**< args[0]: account handle, "uri\0", value: request id */
+    SHARD_OP_SUBMIT_ANSWER_CALL = 8, /**< args[0]: call handle, value: request id */
+    SHARD_OP_SUBMIT_HANGUP_CALL = 9, /**< args[0]: call handle, value: request id */
+    SHARD_OP_GET_CALLS = 10,         /**< value: count, body: CallData array */
+    SHARD_OP_SHUTDOWN = 11           /**< Destroy the manager and exit */
+} ShardOp;
+
+/**
+ * @brief Header of a request message, followed by its body.
+ */
+typedef struct {
+    uint32_t op;             /**< One of ShardOp */
+    int32_t args[3];         /**< Integer arguments */
+} ShardRequest;
+
+/**
+ * @brief Header of a reply message, followed by the error reason or result body.
+ */
+typedef struct {
+    int32_t status;          /**< PJ_SUCCESS or the pj_status_t of the failure */
+    int32_t value;           /**< Handle, request id or count */
+} ShardReply;
+
+/**
+ * @brief Header of an event message: count EventData records, then their strings.
+ */
+typedef struct {
+    uint32_t count;          /**< Number of records */
+    uint32_t strings_len;    /**< Bytes of the string arena after the records */
+} ShardEventBatch;
+
+static const size_t SHARD_MAX_MESSAGE = 64 * 1024;  /**< Largest message on either socket */
+static const int SHARD_EVENT_BATCH = 64;            /**< Records per event message */
+
+/**
+ * @brief Send one message made of a header and a body (never blocks on SIGPIPE)
+ *
+ * @param wait Block while the socket buffer is full; otherwise fail with errno EAGAIN
+ * @return true if the whole message was sent
+ */
+bool shard_send(int fd, const void* head, size_t head_len, const void* body = nullptr, size_t body_len = 0,
+                bool wait = true);
+
+/**
+ * @brief Receive one message
+ *
+ * @param wait Block until a message arrives
+ * @return ssize_t Message length, 0 if the peer closed, -1 if none is pending or on error
+ */
+ssize_t shard_recv(int fd, void* buf, size_t cap, bool wait);
+
+/**
+ * @brief Split a body of NUL-terminated strings
+ */
+std::vector<std::string> shard_split(const char* data, size_t len);
+
+#endif // SHARD_IPC_H
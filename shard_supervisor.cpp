@@ -0,0 +1,462 @@
+#include "shard_supervisor.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace pj;
+using namespace std;
+
+static const int INDEX_MASK = (1 << CallRegistry::INDEX_BITS) - 1;
+// Generation bits left in a positive handle once the worker index is added
+static const int GENERATION_MASK = (1 << (31 - CallRegistry::INDEX_BITS - ShardSupervisor::SHARD_BITS)) - 1;
+static const int SHARD_MASK = ShardSupervisor::SHARD_MAX_WORKERS - 1;
+// Generation bits of a worker's own call handles
+static const uint32_t LOCAL_GENERATION_MASK = (1u << (31 - CallRegistry::INDEX_BITS)) - 1;
+// Time given to workers to unregister and exit before they are killed
+static const int SHUTDOWN_TIMEOUT_MS = 2000;
+static const char WORKER_EXECUTABLE[] = "pjsua2_worker";
+
+static int encode_call(unsigned shard, int local) {
+    int generation = (local >> CallRegistry::INDEX_BITS) & GENERATION_MASK;
+    return (generation << (CallRegistry::INDEX_BITS + ShardSupervisor::SHARD_BITS))
+         | (int)(shard << CallRegistry::INDEX_BITS) | (local & INDEX_MASK);
+}
+
+// True if local is a later call of its slot than stored (generations wrap)
+static bool newer_call(int local, int stored) {
+    if (stored < 0) return true;
+    uint32_t ahead = (((uint32_t)local >> CallRegistry::INDEX_BITS) - ((uint32_t)stored >> CallRegistry::INDEX_BITS))
+                   & LOCAL_GENERATION_MASK;
+    return ahead != 0 && ahead <= LOCAL_GENERATION_MASK / 2;
+}
+
+static int encode_id(unsigned shard, int local) {
+    return (int)((((uint32_t)local << ShardSupervisor::SHARD_BITS) | shard) & 0x7fffffff);
+}
+
+// pjsua2_worker is installed next to this library
+static string default_worker_path() {
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(&ShardSupervisor::default_config), &info) && info.dli_fname) {
+        string path(info.dli_fname);
+        size_t slash = path.rfind('/');
+        if (slash != string::npos) {
+            return path.substr(0, slash + 1) + WORKER_EXECUTABLE;
+        }
+    }
+    return WORKER_EXECUTABLE;
+}
+
+ShardConfig ShardSupervisor::default_config() {
+    ShardConfig config;
+    config.version = PJSUA2_SHARD_CONFIG_VERSION;
+    config.workers = 0;
+    config.port_step = 1;
+    config.worker_path = nullptr;
+    return config;
+}
+
+ShardSupervisor::ShardSupervisor(const ShardConfig& shard_config, const ManagerConfig& manager_config)
+    : _epollFd(-1), _batch(nullptr), _batchStrings(nullptr), _batchShard(0), _batchCount(0), _batchNext(0),
+      _nextShard(0) {
+    if (shard_config.version != PJSUA2_SHARD_CONFIG_VERSION) {
+        throw Error(PJ_EINVAL, "Shard Error", "Unsupported ShardConfig version", __FILE__, __LINE__);
+    }
+    if (manager_config.version == 0 || manager_config.version > PJSUA2_MANAGER_CONFIG_VERSION) {
+        throw Error(PJ_EINVAL, "Shard Error", "Unsupported ManagerConfig version", __FILE__, __LINE__);
+    }
+
+    unsigned workers = shard_config.workers;
+    if (workers == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    workers = min(workers, SHARD_MAX_WORKERS);
+    string path = shard_config.worker_path ? shard_config.worker_path : default_worker_path();
+
+    _message.resize(SHARD_MAX_MESSAGE);
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (_epollFd < 0) {
+        throw Error(PJ_EINVAL, "Shard Error", "epoll_create1() failed", __FILE__, __LINE__);
+    }
+
+    try {
+        for (unsigned shard = 0; shard < workers; shard++) {
+            ManagerConfig config = manager_config;
+            int offset = (int)(shard * shard_config.port_step);
+            // 0 binds any free port and -1 disables the transport: both stay as they are
+            if (config.udp_port > 0) config.udp_port += offset;
+            if (config.tcp_port > 0) config.tcp_port += offset;
+            if (config.tls_port > 0) config.tls_port += offset;
+            _spawn(shard, path, config);
+        }
+    } catch (const Error&) {
+        _shutdown();
+        throw;
+    }
+}
+
+ShardSupervisor::~ShardSupervisor() {
+    _shutdown();
+}
+
+void ShardSupervisor::_spawn(unsigned shard, const string& path, const ManagerConfig& config) {
+    int cmd[2];
+    int evt[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, cmd) != 0) {
+        throw Error(PJ_EINVAL, "Shard Error", "socketpair() failed", __FILE__, __LINE__);
+    }
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, evt) != 0) {
+        ::close(cmd[0]);
+        ::close(cmd[1]);
+        throw Error(PJ_EINVAL, "Shard Error", "socketpair() failed", __FILE__, __LINE__);
+    }
+
+    // Everything the child needs is prepared before fork(): it may only make async-signal-safe calls
+    char shardArg[16], cmdArg[16], evtArg[16];
+    snprintf(shardArg, sizeof(shardArg), "%u", shard);
+    snprintf(cmdArg, sizeof(cmdArg), "%d", cmd[1]);
+    snprintf(evtArg, sizeof(evtArg), "%d", evt[1]);
+    const char* argv[] = {path.c_str(), shardArg, cmdArg, evtArg, nullptr};
+
+    // No parent-death signal: it follows the forking thread, not the process. A worker exits
+    // instead when its request socket closes, which also covers the supervisor crashing.
+    pid_t pid = fork();
+    if (pid == 0) {
+        fcntl(cmd[1], F_SETFD, 0);
+        fcntl(evt[1], F_SETFD, 0);
+        execv(path.c_str(), const_cast<char* const*>(argv));
+        _exit(127);
+    }
+    ::close(cmd[1]);
+    ::close(evt[1]);
+    if (pid < 0) {
+        ::close(cmd[0]);
+        ::close(evt[0]);
+        throw Error(PJ_EINVAL, "Shard Error", "fork() failed", __FILE__, __LINE__);
+    }
+
+    unique_ptr<Worker> worker(new Worker());
+    worker->pid = pid;
+    worker->cmdFd = cmd[0];
+    worker->eventFd = evt[0];
+    worker->alive.store(true, memory_order_release);
+    worker->reply.resize(SHARD_MAX_MESSAGE);
+    for (atomic<int>& call : worker->calls) {
+        call.store(-1, memory_order_relaxed);
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = shard;
+    epoll_ctl(_epollFd, EPOLL_CTL_ADD, evt[0], &ev);
+    _workers.push_back(move(worker));
+
+    // Pointers are meaningless in the worker: the TLS file names follow the struct
+    string body(reinterpret_cast<const char*>(&config), sizeof(config));
+    for (const char* file : {config.tls_ca_file, config.tls_cert_file, config.tls_privkey_file}) {
+        if (file) body += file;
+        body += '\0';
+    }
+    _request(shard, SHARD_OP_INIT, 0, body);
+}
+
+int ShardSupervisor::_request(unsigned shard, ShardOp op, int arg, const string& body, string* body_out) {
+    Worker& worker = *_workers[shard];
+    lock_guard<mutex> lock(worker.mutex);
+    if (!worker.alive.load(memory_order_acquire)) {
+        throw Error(PJ_EINVALIDOP, "Shard Error", "Worker is not running", __FILE__, __LINE__);
+    }
+
+    ShardRequest request;
+    memset(&request, 0, sizeof(request));
+    request.op = op;
+    request.args[0] = arg;
+    if (!shard_send(worker.cmdFd, &request, sizeof(request), body.data(), body.size())) {
+        throw Error(PJ_EINVALIDOP, "Shard Error", "Cannot reach worker", __FILE__, __LINE__);
+    }
+    ssize_t len = shard_recv(worker.cmdFd, worker.reply.data(), worker.reply.size(), true);
+    if (len < (ssize_t)sizeof(ShardReply)) {
+        throw Error(PJ_EINVALIDOP, "Shard Error", "Worker exited", __FILE__, __LINE__);
+    }
+
+    ShardReply reply;
+    memcpy(&reply, worker.reply.data(), sizeof(reply));
+    const char* data = worker.reply.data() + sizeof(reply);
+    size_t data_len = (size_t)len - sizeof(reply);
+    if (reply.status != PJ_SUCCESS) {
+        throw Error(reply.status, "Shard Error", string(data, strnlen(data, data_len)), __FILE__, __LINE__);
+    }
+    if (body_out) {
+        body_out->assign(data, data_len);
+    }
+    return reply.value;
+}
+
+int ShardSupervisor::_export_call(unsigned shard, int local) {
+    if (local < 0) return CallRegistry::INVALID_HANDLE;
+    // A late event of the slot's previous call must not hide the live one
+    atomic<int>& slot = _workers[shard]->calls[local & INDEX_MASK];
+    int stored = slot.load(memory_order_acquire);
+    while (newer_call(local, stored) && !slot.compare_exchange_weak(stored, local, memory_order_acq_rel)) {
+    }
+    return encode_call(shard, local);
+}
+
+unsigned ShardSupervisor::_import_call(int handle, int& local) {
+    unsigned shard = (unsigned)(handle >> CallRegistry::INDEX_BITS) & SHARD_MASK;
+    int index = handle & INDEX_MASK;
+    if (handle < 0 || shard >= _workers.size() || index >= PJSUA_MAX_CALLS) {
+        throw Error(PJ_ENOTFOUND, "Shard Error", "Unknown call handle", __FILE__, __LINE__);
+    }
+    local = _workers[shard]->calls[index].load(memory_order_acquire);
+    if (local < 0 || encode_call(shard, local) != handle) {
+        throw Error(PJ_ENOTFOUND, "Shard Error", "Unknown call handle", __FILE__, __LINE__);
+    }
+    return shard;
+}
+
+unsigned ShardSupervisor::_import_account(int acc_handle, int& local) {
+    unsigned shard = (unsigned)acc_handle & SHARD_MASK;
+    if (acc_handle < 0 || shard >= _workers.size()) {
+        throw Error(PJ_ENOTFOUND, "Shard Error", "Unknown account handle", __FILE__, __LINE__);
+    }
+    local = acc_handle >> SHARD_BITS;
+    return shard;
+}
+
+int ShardSupervisor::add_account(const string& sip_user, const string& sip_password, const string& sip_domain) {
+    lock_guard<mutex> lock(_placementMutex);
+    unsigned best = 0;
+    bool found = false;
+    for (unsigned shard = 0; shard < _workers.size(); shard++) {
+        const Worker& worker = *_workers[shard];
+        if (!worker.alive.load(memory_order_acquire)) continue;
+        if (!found || worker.accounts < _workers[best]->accounts) {
+            best = shard;
+            found = true;
+        }
+    }
+    if (!found) {
+        throw Error(PJ_EINVALIDOP, "Shard Error", "No worker is running", __FILE__, __LINE__);
+    }
+
+    string body = sip_user + '\0' + sip_password + '\0' + sip_domain + '\0';
+    int local = _request(best, SHARD_OP_ACCOUNT_ADD, 0, body);
+    _workers[best]->accounts++;
+    return encode_id(best, local);
+}
+
+void ShardSupervisor::remove_account(int acc_handle) {
+    int local;
+    unsigned shard = _import_account(acc_handle, local);
+    lock_guard<mutex> lock(_placementMutex);
+    _request(shard, SHARD_OP_ACCOUNT_REMOVE, local, string());
+    _workers[shard]->accounts--;
+}
+
+int ShardSupervisor::make_call(int acc_handle, const string& dest_uri) {
+    int local;
+    unsigned shard = _import_account(acc_handle, local);
+    return _export_call(shard, _request(shard, SHARD_OP_MAKE_CALL, local, dest_uri + '\0'));
+}
+
+void ShardSupervisor::answer_call(int handle) {
+    int local;
+    unsigned shard = _import_call(handle, local);
+    _request(shard, SHARD_OP_ANSWER_CALL, local, string());
+}
+
+void ShardSupervisor::hang_up_call(int handle) {
+    int local;
+    unsigned shard = _import_call(handle, local);
+    _request(shard, SHARD_OP_HANGUP_CALL, local, string());
+}
+
+int ShardSupervisor::submit_make_call(int acc_handle, const string& dest_uri) {
+    int local;
+    unsigned shard = _import_account(acc_handle, local);
+    return encode_id(shard, _request(shard, SHARD_OP_SUBMIT_MAKE_CALL, local, dest_uri + '\0'));
+}
+
+int ShardSupervisor::submit_answer_call(int handle) {
+    int local;
+    unsigned shard = _import_call(handle, local);
+    return encode_id(shard, _request(shard, SHARD_OP_SUBMIT_ANSWER_CALL, local, string()));
+}
+
+int ShardSupervisor::submit_hang_up_call(int handle) {
+    int local;
+    unsigned shard = _import_call(handle, local);
+    return encode_id(shard, _request(shard, SHARD_OP_SUBMIT_HANGUP_CALL, local, string()));
+}
+
+int ShardSupervisor::get_calls_snapshot(CallData* out, int cap) {
+    if (!out || cap <= 0) return 0;
+    int n = 0;
+    string body;
+    for (unsigned shard = 0; shard < _workers.size() && n < cap; shard++) {
+        if (!_workers[shard]->alive.load(memory_order_acquire)) continue;
+        int count;
+        try {
+            count = _request(shard, SHARD_OP_GET_CALLS, 0, string(), &body);
+        } catch (const Error&) {
+            // A worker that has no account yet or just exited has no calls
+            continue;
+        }
+        count = min(count, (int)(body.size() / sizeof(CallData)));
+        for (int i = 0; i < count && n < cap; i++) {
+            CallData& data = out[n++];
+            memcpy(&data, body.data() + i * sizeof(CallData), sizeof(CallData));
+            data.call_handle = _export_call(shard, data.call_handle);
+            data.acc_handle = data.acc_handle >= 0 ? encode_id(shard, data.acc_handle) : -1;
+        }
+    }
+    return n;
+}
+
+void ShardSupervisor::_translate(unsigned shard, EventData& event) {
+    if (event.call_handle >= 0) {
+        event.call_handle = _export_call(shard, event.call_handle);
+    }
+    if (event.acc_handle >= 0) {
+        event.acc_handle = encode_id(shard, event.acc_handle);
+    }
+    if (event.request_id != 0) {
+        event.request_id = encode_id(shard, event.request_id);
+    }
+}
+
+void ShardSupervisor::_worker_exited(unsigned shard) {
+    Worker& worker = *_workers[shard];
+    worker.alive.store(false, memory_order_release);
+    epoll_ctl(_epollFd, EPOLL_CTL_DEL, worker.eventFd, nullptr);
+    ::close(worker.eventFd);
+    worker.eventFd = -1;
+
+    static const char reason[] = "Shard worker exited";
+    ShardEventBatch header;
+    header.count = 1;
+    header.strings_len = sizeof(reason);
+    EventData event;
+    memset(&event, 0, sizeof(event));
+    event.version = PJSUA2_EVENT_VERSION;
+    event.type = PJSUA2_EVENT_ERROR;
+    event.state = PJ_EINVALIDOP;
+    event.call_handle = -1;
+    event.acc_handle = -1;
+    event.timestamp_us = CallMetrics::now_us();
+    event.strings_offset = 0;
+    event.strings_len = sizeof(reason);
+
+    char* data = _message.data();
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + sizeof(header), &event, sizeof(event));
+    memcpy(data + sizeof(header) + sizeof(event), reason, sizeof(reason));
+    _batch = reinterpret_cast<const EventData*>(data + sizeof(header));
+    _batchStrings = data + sizeof(header) + sizeof(event);
+    // Handles of an error event are already -1: the translation is a no-op
+    _batchShard = shard;
+    _batchCount = 1;
+    _batchNext = 0;
+}
+
+bool ShardSupervisor::_receive_batch() {
+    for (size_t tried = 0; tried < _workers.size(); tried++) {
+        unsigned shard = _nextShard;
+        _nextShard = (_nextShard + 1) % _workers.size();
+        Worker& worker = *_workers[shard];
+        if (worker.eventFd < 0) continue;
+
+        ssize_t len = shard_recv(worker.eventFd, _message.data(), _message.size(), false);
+        if (len == 0) {
+            _worker_exited(shard);
+            return true;
+        }
+        if (len < (ssize_t)sizeof(ShardEventBatch)) continue;
+
+        ShardEventBatch header;
+        memcpy(&header, _message.data(), sizeof(header));
+        size_t records = (size_t)header.count * sizeof(EventData);
+        if (sizeof(header) + records + header.strings_len != (size_t)len) continue;
+
+        _batch = reinterpret_cast<const EventData*>(_message.data() + sizeof(header));
+        _batchStrings = _message.data() + sizeof(header) + records;
+        _batchShard = shard;
+        _batchCount = header.count;
+        _batchNext = 0;
+        return true;
+    }
+    return false;
+}
+
+int ShardSupervisor::poll_events(EventData* out, int max, char* strings, size_t strings_cap) {
+    if (!out || max <= 0) return 0;
+    int n = 0;
+    size_t used = 0;
+    while (n < max) {
+        if (_batchNext >= _batchCount && !_receive_batch()) break;
+        if (_batchNext >= _batchCount) continue;
+
+        EventData event = _batch[_batchNext];
+        if (event.strings_len > 0) {
+            if (!strings || event.strings_len > strings_cap) {
+                event.strings_len = 0;
+            } else if (used + event.strings_len > strings_cap) {
+                break;
+            } else {
+                memcpy(strings + used, _batchStrings + event.strings_offset, event.strings_len);
+                event.strings_offset = (uint32_t)used;
+                used += event.strings_len;
+            }
+        }
+        _translate(_batchShard, event);
+        out[n++] = event;
+        _batchNext++;
+    }
+    return n;
+}
+
+void ShardSupervisor::_shutdown() {
+    ShardRequest request;
+    memset(&request, 0, sizeof(request));
+    request.op = SHARD_OP_SHUTDOWN;
+    for (unique_ptr<Worker>& worker : _workers) {
+        lock_guard<mutex> lock(worker->mutex);
+        if (worker->alive.exchange(false, memory_order_acq_rel)) {
+            shard_send(worker->cmdFd, &request, sizeof(request));
+        }
+    }
+
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(SHUTDOWN_TIMEOUT_MS);
+    for (unique_ptr<Worker>& worker : _workers) {
+        while (worker->pid > 0) {
+            if (waitpid(worker->pid, nullptr, WNOHANG) != 0) {
+                worker->pid = -1;
+            } else if (chrono::steady_clock::now() >= deadline) {
+                kill(worker->pid, SIGKILL);
+                waitpid(worker->pid, nullptr, 0);
+                worker->pid = -1;
+            } else {
+                usleep(10000);
+            }
+        }
+        if (worker->cmdFd >= 0) ::close(worker->cmdFd);
+        if (worker->eventFd >= 0) ::close(worker->eventFd);
+        worker->cmdFd = -1;
+        worker->eventFd = -1;
+    }
+    _workers.clear();
+    if (_epollFd >= 0) {
+        ::close(_epollFd);
+        _epollFd = -1;
+    }
+}
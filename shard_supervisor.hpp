@@ -0,0 +1,240 @@
+#ifndef SHARD_SUPERVISOR_H
+#define SHARD_SUPERVISOR_H
+
+#include "pjsua2_manager.hpp"
+#include "shard_ipc.hpp"
+
+#include <sys/types.h>
+
+#define PJSUA2_SHARD_CONFIG_VERSION 1 /**< Current ShardConfig layout version */
+
+/**
+ * @brief Supervisor configuration passed to pjsua2_supervisor_create.
+ *
+ * Always start from pjsua2_shard_config_default().
+ */
+typedef struct {
+    unsigned version;         /**< Must be PJSUA2_SHARD_CONFIG_VERSION */
+    unsigned workers;         /**< Worker processes, 0 for one per online CPU (at most SHARD_MAX_WORKERS) */
+    unsigned port_step;       /**< Added to each non-zero listen port of ManagerConfig per worker */
+    const char* worker_path;  /**< pjsua2_worker executable, NULL to use the one next to the library */
+} ShardConfig;
+
+
+/**
+ * @brief Spreads accounts over worker processes, each with its own endpoint.
+ *
+ * PJSIP's Endpoint is a process-wide singleton, so one process has one SIP
+ * event loop and one conference bridge clock. The supervisor forks and execs
+ * N pjsua2_worker processes; worker i runs a PJSUA2Manager listening on the
+ * configured ports plus i * port_step, created when its first account is
+ * added. Accounts are placed on the worker with the fewest accounts.
+ *
+ * Each worker has two local SOCK_SEQPACKET socket pairs: requests are sent
+ * synchronously on the first (one outstanding request per worker), events
+ * are pushed on the second in batches of EventData records. Handles seen by
+ * the caller carry the worker index: account and request ids are shifted
+ * left by SHARD_BITS, call handles keep their slot index and the low
+ * generation bits, and are checked against the last local handle seen for
+ * that slot so a stale handle never reaches a newer call.
+ */
+class ShardSupervisor {
+public:
+    static const int SHARD_BITS = 6;                            /**< Bits of a handle holding the worker index */
+    static const unsigned SHARD_MAX_WORKERS = 1u << SHARD_BITS; /**< Maximum number of workers */
+
+    /**
+     * @brief Start the workers
+     *
+     * @param shard_config Number of workers and worker executable
+     * @param manager_config Endpoint configuration of every worker
+     * @throw Error if a configuration version is unsupported or a worker cannot start
+     */
+    ShardSupervisor(const ShardConfig& shard_config, const ManagerConfig& manager_config);
+
+    /**
+     * @brief Shut the workers down (killed if they do not exit in time)
+     */
+    ~ShardSupervisor();
+
+    ShardSupervisor(const ShardSupervisor&) = delete;
+    ShardSupervisor& operator=(const ShardSupervisor&) = delete;
+
+    /**
+     * @brief Get the default configuration (one worker per CPU)
+     */
+    static ShardConfig default_config();
+
+    /**
+     * @brief Number of worker processes
+     */
+    int worker_count() const { return (int)_workers.size(); }
+
+    /**
+     * @brief Register an account on the least loaded worker
+     *
+     * @return int Account handle
+     * @throw Error if the worker fails or is gone
+     */
+    int add_account(const string& sip_user, const string& sip_password, const string& sip_domain);
+
+    /**
+     * @brief Unregister an account
+     *
+     * @throw Error on unknown handle
+     */
+    void remove_account(int acc_handle);
+
+    /**
+     * @brief Place a call from an account, on the account's worker
+     *
+     * @return int Call handle
+     * @throw Error on unknown handle or PJSIP failure
+     */
+    int make_call(int acc_handle, const string& dest_uri);
+
+    /**
+     * @brief Answer an incoming call
+     *
+     * @throw Error on unknown handle or PJSIP failure
+     */
+    void answer_call(int handle);
+
+    /**
+     * @brief Hang up a call
+     *
+     * @throw Error on unknown handle or PJSIP failure
+     */
+    void hang_up_call(int handle);
+
+    /**
+     * @brief Queue an outgoing call on the account's worker
+     *
+     * @return int Request id, matched by a PJSUA2_EVENT_COMMAND_DONE event
+     * @throw Error on unknown handle
+     */
+    int submit_make_call(int acc_handle, const string& dest_uri);
+
+    /**
+     * @brief Queue answering a call
+     *
+     * @return int Request id
+     * @throw Error on unknown handle
+     */
+    int submit_answer_call(int handle);
+
+    /**
+     * @brief Queue hanging up a call
+     *
+     * @return int Request id
+     * @throw Error on unknown handle
+     */
+    int submit_hang_up_call(int handle);
+
+    /**
+     * @brief Collect the live calls of every worker
+     *
+     * @return int Number of records written
+     */
+    int get_calls_snapshot(CallData* out, int cap);
+
+    /**
+     * @brief Drain events of all workers (single consumer)
+     *
+     * Same contract as PJSUA2Manager::poll_events(); handles are translated.
+     * A worker that exits produces one PJSUA2_EVENT_ERROR.
+     */
+    int poll_events(EventData* out, int max, char* strings, size_t strings_cap);
+
+    /**
+     * @brief Pollable handle, readable while a worker has events pending
+     *
+     * Events already received but not returned by a full poll_events() batch
+     * do not make it readable: drain until fewer than max are returned.
+     */
+    int event_fd() const { return _epollFd; }
+
+private:
+    struct Worker {
+        pid_t pid = -1;                     /**< Worker process */
+        int cmdFd = -1;                     /**< Request/reply socket */
+        int eventFd = -1;                   /**< Event socket */
+        std::atomic<bool> alive{false};     /**< Worker still running */
+        int accounts = 0;                   /**< Accounts placed on this worker */
+        std::mutex mutex;                   /**< One outstanding request per worker */
+        std::vector<char> reply;            /**< Reply buffer (guarded by mutex) */
+        std::atomic<int> calls[PJSUA_MAX_CALLS]; /**< Last local handle seen per call slot, -1 if none */
+    };
+
+    /**
+     * @brief Fork and exec one worker, then send it its configuration
+     */
+    void _spawn(unsigned shard, const string& path, const ManagerConfig& config);
+
+    /**
+     * @brief Send a request and wait for the reply
+     *
+     * @param body_out Receives the reply body (nullptr to ignore)
+     * @return int Reply value
+     * @throw Error with the worker's status if the request failed
+     */
+    int _request(unsigned shard, ShardOp op, int arg, const string& body, std::string* body_out = nullptr);
+
+    /**
+     * @brief Global handle of a worker's call handle
+     *
+     * Records it as the slot's live call unless a later call of the slot
+     * was already recorded.
+     */
+    int _export_call(unsigned shard, int local);
+
+    /**
+     * @brief Worker and local handle of a global call handle
+     *
+     * @throw Error if the handle is unknown or stale
+     */
+    unsigned _import_call(int handle, int& local);
+
+    /**
+     * @brief Worker and local handle of a global account handle
+     *
+     * @throw Error if the handle is unknown
+     */
+    unsigned _import_account(int acc_handle, int& local);
+
+    /**
+     * @brief Rewrite the handles of a worker's event
+     */
+    void _translate(unsigned shard, EventData& event);
+
+    /**
+     * @brief Receive the next event batch of any worker into _batch
+     *
+     * @return true if a batch was received
+     */
+    bool _receive_batch();
+
+    /**
+     * @brief Turn the exit of a worker into an error event batch
+     */
+    void _worker_exited(unsigned shard);
+
+    /**
+     * @brief Stop every worker and close the sockets
+     */
+    void _shutdown();
+
+    std::vector<std::unique_ptr<Worker>> _workers;  /**< Worker processes */
+    std::mutex _placementMutex;                     /**< Serialises account placement */
+    int _epollFd;                                   /**< Watches every event socket */
+
+    std::vector<char> _message;                     /**< Receive buffer of the event consumer */
+    const EventData* _batch;                        /**< Records of the batch being returned */
+    const char* _batchStrings;                      /**< String arena of that batch */
+    unsigned _batchShard;                           /**< Worker of that batch */
+    uint32_t _batchCount;                           /**< Records in that batch */
+    uint32_t _batchNext;                            /**< Next record to return */
+    unsigned _nextShard;                            /**< Worker polled first next time */
+};
+
+#endif // SHARD_SUPERVISOR_H
@@ -0,0 +1,262 @@
+// pjsua2_worker: one shard of a ShardSupervisor, started as
+//   pjsua2_worker <shard> <request fd> <event fd>
+#include "pjsua2_manager.hpp"
+#include "shard_ipc.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <poll.h>
+
+using namespace pj;
+using namespace std;
+
+// Only bounds the wait if the event queue has no eventfd to wake on
+static const int EVENT_POLL_MS = 20;
+static const size_t EVENT_STRINGS_CAP = 32 * 1024;
+// Event messages kept while the supervisor is not reading; later ones are dropped
+static const size_t EVENT_BACKLOG_BYTES = 4 * 1024 * 1024;
+
+namespace {
+
+class ShardWorker {
+public:
+    ShardWorker(int cmd_fd, int event_fd)
+        : _cmdFd(cmd_fd), _eventFd(event_fd), _config(PJSUA2Manager::default_config()),
+          _request(SHARD_MAX_MESSAGE), _events(SHARD_EVENT_BATCH), _message(SHARD_MAX_MESSAGE),
+          _backlogBytes(0), _dropped(0) {
+    }
+
+    /**
+     * @brief Serve requests and forward events until shutdown or supervisor exit
+     *
+     * The endpoint runs on the manager's blocking event loop, which sees
+     * every transport (TCP/TLS included) and its timers and is woken by the
+     * EventWaker for submitted commands. This thread only sleeps until a
+     * request, a queued event or room on the event socket.
+     */
+    int run() {
+        while (true) {
+            struct pollfd fds[3];
+            int count = 0;
+            fds[count].fd = _cmdFd;
+            fds[count++].events = POLLIN;
+            if (!_backlog.empty()) {
+                fds[count].fd = _eventFd;
+                fds[count++].events = POLLOUT;
+            }
+            int timeout = -1;
+            if (_manager) {
+                if (_manager->event_fd() >= 0) {
+                    fds[count].fd = _manager->event_fd();
+                    fds[count++].events = POLLIN;
+                } else {
+                    timeout = EVENT_POLL_MS;
+                }
+            }
+            if (poll(fds, count, timeout) < 0 && errno != EINTR) {
+                return EXIT_FAILURE;
+            }
+
+            if (!_serve()) break;
+            if (_manager && !_forward_events()) break;
+        }
+        _manager.reset();
+        return EXIT_SUCCESS;
+    }
+
+private:
+    /**
+     * @brief Handle every pending request
+     *
+     * @return false on shutdown or when the supervisor is gone
+     */
+    bool _serve() {
+        while (true) {
+            ssize_t len = shard_recv(_cmdFd, _request.data(), _request.size(), false);
+            if (len == 0) return false;
+            if (len < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+            if (len < (ssize_t)sizeof(ShardRequest)) continue;
+
+            ShardRequest request;
+            memcpy(&request, _request.data(), sizeof(request));
+            if (request.op == SHARD_OP_SHUTDOWN) return false;
+
+            ShardReply reply;
+            reply.status = PJ_SUCCESS;
+            reply.value = 0;
+            string body;
+            try {
+                reply.value = _dispatch(request, _request.data() + sizeof(request), (size_t)len - sizeof(request), body);
+            } catch (const Error& e) {
+                reply.status = e.status != PJ_SUCCESS ? e.status : PJ_EUNKNOWN;
+                body = e.reason;
+                body += '\0';
+            }
+            if (!shard_send(_cmdFd, &reply, sizeof(reply), body.data(), body.size())) return false;
+        }
+    }
+
+    int _dispatch(const ShardRequest& request, const char* data, size_t len, string& body) {
+        if (request.op == SHARD_OP_INIT) {
+            if (len < sizeof(ManagerConfig)) {
+                throw Error(PJ_EINVAL, "Shard Error", "Truncated configuration", __FILE__, __LINE__);
+            }
+            memcpy(&_config, data, sizeof(ManagerConfig));
+            vector<string> files = shard_split(data + sizeof(ManagerConfig), len - sizeof(ManagerConfig));
+            files.resize(3);
+            for (int i = 0; i < 3; i++) {
+                _tlsFiles[i] = files[i];
+            }
+            _config.tls_ca_file = _tlsFiles[0].empty() ? nullptr : _tlsFiles[0].c_str();
+            _config.tls_cert_file = _tlsFiles[1].empty() ? nullptr : _tlsFiles[1].c_str();
+            _config.tls_privkey_file = _tlsFiles[2].empty() ? nullptr : _tlsFiles[2].c_str();
+            return 0;
+        }
+
+        vector<string> args = shard_split(data, len);
+        if (request.op == SHARD_OP_ACCOUNT_ADD) {
+            if (args.size() < 3) {
+                throw Error(PJ_EINVAL, "Shard Error", "Missing account fields", __FILE__, __LINE__);
+            }
+            if (!_manager) {
+                // The endpoint is created with the first account placed on this worker
+                _manager.reset(new PJSUA2Manager(args[0], args[1], args[2], _config));
+                _manager->start_event_loop_blocking();
+                return _manager->default_account();
+            }
+            return _manager->add_account(args[0], args[1], args[2]);
+        }
+        if (!_manager) {
+            throw Error(PJ_EINVALIDOP, "Shard Error", "No account on this worker", __FILE__, __LINE__);
+        }
+
+        int handle = request.args[0];
+        switch (request.op) {
+            case SHARD_OP_ACCOUNT_REMOVE:
+                _manager->remove_account(handle);
+                return 0;
+            case SHARD_OP_MAKE_CALL:
+            case SHARD_OP_SUBMIT_MAKE_CALL:
+                if (args.empty()) {
+                    throw Error(PJ_EINVAL, "Shard Error", "Missing URI", __FILE__, __LINE__);
+                }
+                if (request.op == SHARD_OP_SUBMIT_MAKE_CALL) {
+                    return _manager->submit_make_call(handle, args[0]);
+                }
+                return _manager->get_call_handle(_manager->make_call(handle, args[0]));
+            case SHARD_OP_ANSWER_CALL:
+                _manager->answer_call(handle);
+                return 0;
+            case SHARD_OP_HANGUP_CALL:
+                _manager->hang_up_call(handle);
+                return 0;
+            case SHARD_OP_SUBMIT_ANSWER_CALL:
+                return _manager->submit_answer_call(handle);
+            case SHARD_OP_SUBMIT_HANGUP_CALL:
+                return _manager->submit_hang_up_call(handle);
+            case SHARD_OP_GET_CALLS:
+                {
+                    int cap = (int)((SHARD_MAX_MESSAGE - sizeof(ShardReply)) / sizeof(CallData));
+                    vector<CallData> calls(min(cap, (int)PJSUA_MAX_CALLS));
+                    int n = _manager->get_calls_snapshot(calls.data(), (int)calls.size());
+                    body.assign(reinterpret_cast<const char*>(calls.data()), n * sizeof(CallData));
+                    return n;
+                }
+            default:
+                throw Error(PJ_ENOTSUP, "Shard Error", "Unknown request", __FILE__, __LINE__);
+        }
+    }
+
+    /**
+     * @brief Send the pending events to the supervisor in batches
+     *
+     * Sends never block: a synchronous request of the supervisor must not
+     * wait behind events Dart is not draining. Batches the socket cannot take
+     * are kept in order in a backlog of EVENT_BACKLOG_BYTES, and counted and
+     * dropped beyond it.
+     *
+     * @return false when the supervisor is gone
+     */
+    bool _forward_events() {
+        if (!_flush_backlog()) return false;
+
+        char* strings = _message.data() + sizeof(ShardEventBatch) + SHARD_EVENT_BATCH * sizeof(EventData);
+        while (true) {
+            int n = _manager->poll_events(_events.data(), SHARD_EVENT_BATCH, strings, EVENT_STRINGS_CAP);
+            if (n <= 0) return true;
+
+            ShardEventBatch header;
+            header.count = (uint32_t)n;
+            header.strings_len = 0;
+            for (int i = 0; i < n; i++) {
+                header.strings_len = max(header.strings_len, _events[i].strings_offset + _events[i].strings_len);
+            }
+            // Records and strings are packed back to back in one message
+            char* out = _message.data();
+            memcpy(out, &header, sizeof(header));
+            memcpy(out + sizeof(header), _events.data(), n * sizeof(EventData));
+            memmove(out + sizeof(header) + n * sizeof(EventData), strings, header.strings_len);
+            size_t len = sizeof(header) + n * sizeof(EventData) + header.strings_len;
+            bool queue = !_backlog.empty();
+            if (!queue && !shard_send(_eventFd, out, len, nullptr, 0, false)) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+                queue = true;
+            }
+            if (queue) {
+                if (_backlogBytes + len > EVENT_BACKLOG_BYTES) {
+                    _dropped += n;
+                } else {
+                    _backlog.emplace_back(out, out + len);
+                    _backlogBytes += len;
+                }
+            }
+            if (n < SHARD_EVENT_BATCH) return true;
+        }
+    }
+
+    /**
+     * @brief Send the backlog, oldest batch first, as far as the socket takes it
+     *
+     * @return false when the supervisor is gone
+     */
+    bool _flush_backlog() {
+        while (!_backlog.empty()) {
+            const vector<char>& batch = _backlog.front();
+            if (!shard_send(_eventFd, batch.data(), batch.size(), nullptr, 0, false)) {
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            _backlogBytes -= batch.size();
+            _backlog.pop_front();
+        }
+        if (_dropped) {
+            cerr << "pjsua2_worker: " << _dropped << " events dropped, supervisor not reading" << endl;
+            _dropped = 0;
+        }
+        return true;
+    }
+
+    int _cmdFd;                             /**< Request/reply socket */
+    int _eventFd;                           /**< Event socket */
+    ManagerConfig _config;                  /**< Configuration sent by SHARD_OP_INIT */
+    string _tlsFiles[3];                    /**< Storage of the TLS file names of _config */
+    unique_ptr<PJSUA2Manager> _manager;     /**< Created with the first account */
+    vector<char> _request;                  /**< Receive buffer */
+    vector<EventData> _events;              /**< Drained records */
+    vector<char> _message;                  /**< Event message being built */
+    deque<vector<char>> _backlog;           /**< Event messages waiting for socket space */
+    size_t _backlogBytes;                   /**< Bytes held in _backlog */
+    uint64_t _dropped;                      /**< Events dropped since the backlog was last drained */
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        cerr << "usage: pjsua2_worker <shard> <request fd> <event fd>" << endl;
+        return EXIT_FAILURE;
+    }
+    ShardWorker worker(atoi(argv[2]), atoi(argv[3]));
+    return worker.run();
+}
@@ -0,0 +1,211 @@
+#include "sip_trace.hpp"
+#include "call_metrics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace pj;
+using namespace std;
+
+static_assert(sizeof(TraceHeader) == 24, "TraceHeader layout is part of the trace format");
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord layout is part of the trace format");
+
+const size_t TraceRecorder::MAX_PENDING;
+const unsigned TraceRecorder::FLUSH_MS;
+
+TraceRecorder::TraceRecorder()
+    : _active(false), _records(0), _dropped(0), _startUs(0), _stopping(false), _file(nullptr) {
+    for (int i = 0; i < PJSUA_MAX_CALLS; i++) {
+        _internedCalls[i].store(-1, memory_order_relaxed);
+    }
+}
+
+TraceRecorder::~TraceRecorder() {
+    stop();
+}
+
+bool TraceRecorder::start(const string& path) {
+    lock_guard<mutex> control(_controlMutex);
+    _stop();
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PJSUA2_TRACE_MAGIC, sizeof(header.magic));
+    header.version = PJSUA2_TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.start_us = CallMetrics::now_us();
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        return false;
+    }
+
+    for (int i = 0; i < PJSUA_MAX_CALLS; i++) {
+        _internedCalls[i].store(-1, memory_order_relaxed);
+    }
+    {
+        lock_guard<mutex> lock(_mutex);
+        _pending.clear();
+        _stopping = false;
+        _startUs = header.start_us;
+    }
+    _records.store(0, memory_order_relaxed);
+    _dropped.store(0, memory_order_relaxed);
+    _file = file;
+    _thread = thread(&TraceRecorder::_run, this);
+    _active.store(true, memory_order_release);
+    return true;
+}
+
+void TraceRecorder::stop() {
+    lock_guard<mutex> control(_controlMutex);
+    _stop();
+}
+
+void TraceRecorder::_stop() {
+    _active.store(false, memory_order_release);
+    if (!_thread.joinable()) return;
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    _thread.join();
+    fclose(_file);
+    _file = nullptr;
+}
+
+void TraceRecorder::record(TraceRecord& record, const char* strings, size_t len) {
+    if (!_active.load(memory_order_acquire)) return;
+    if (!strings) len = 0;
+    len = min(len, (size_t)UINT16_MAX);
+    record.strings_len = (uint16_t)len;
+
+    bool flush = false;
+    {
+        lock_guard<mutex> lock(_mutex);
+        if (_pending.size() + sizeof(record) + len > MAX_PENDING) {
+            _dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        // Stamped under the lock so records stay in time order in the file
+        record.timestamp_us = CallMetrics::now_us() - _startUs;
+        const char* bytes = reinterpret_cast<const char*>(&record);
+        _pending.insert(_pending.end(), bytes, bytes + sizeof(record));
+        _pending.insert(_pending.end(), strings, strings + len);
+        flush = _pending.size() > MAX_PENDING / 2;
+    }
+    _records.fetch_add(1, memory_order_relaxed);
+    if (flush) {
+        _wake.notify_one();
+    }
+}
+
+void TraceRecorder::record_call(TraceKind kind, int index, int handle, const CallInfo& info) {
+    if (!_active.load(memory_order_relaxed)) return;
+
+    TraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind = kind;
+    record.index = index;
+    record.handle = handle;
+    record.acc_handle = info.accId;
+    record.code = kind == PJSUA2_TRACE_CALL_STATE ? (int32_t)info.lastStatusCode : 0;
+    record.state = info.state;
+
+    // Intern like the event queue: only a call's first record carries its Call-ID and URIs
+    string strings;
+    if (index >= 0 && index < PJSUA_MAX_CALLS
+            && _internedCalls[index].exchange(handle, memory_order_relaxed) != handle) {
+        strings.reserve(info.callIdString.size() + info.localUri.size() + info.remoteUri.size() + 3);
+        strings.append(info.callIdString).push_back('\0');
+        strings.append(info.localUri).push_back('\0');
+        strings.append(info.remoteUri).push_back('\0');
+    }
+    this->record(record, strings.data(), strings.size());
+}
+
+void TraceRecorder::record(TraceKind kind, TraceOp op, int index, int handle, int acc_handle, int code, int state,
+                           const string& text) {
+    if (!_active.load(memory_order_relaxed)) return;
+
+    TraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind = kind;
+    record.op = (uint8_t)op;
+    record.index = index;
+    record.handle = handle;
+    record.acc_handle = acc_handle;
+    record.code = code;
+    record.state = state;
+    this->record(record, text.c_str(), text.empty() ? 0 : text.size() + 1);
+}
+
+void TraceRecorder::_run() {
+    vector<char> batch;
+    bool stopping = false;
+    while (!stopping) {
+        {
+            unique_lock<mutex> lock(_mutex);
+            _wake.wait_for(lock, chrono::milliseconds(FLUSH_MS), [this] {
+                return _stopping || _pending.size() > MAX_PENDING / 2;
+            });
+            stopping = _stopping;
+            batch.swap(_pending);
+        }
+        if (!batch.empty()) {
+            fwrite(batch.data(), 1, batch.size(), _file);
+            batch.clear();
+        }
+    }
+    fflush(_file);
+}
+
+TraceReader::TraceReader() : _file(nullptr) {}
+
+TraceReader::~TraceReader() {
+    if (_file) {
+        fclose(_file);
+    }
+}
+
+bool TraceReader::open(const string& path) {
+    if (_file) {
+        fclose(_file);
+    }
+    _file = fopen(path.c_str(), "rb");
+    if (!_file) return false;
+
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, _file) != 1
+            || memcmp(header.magic, PJSUA2_TRACE_MAGIC, sizeof(header.magic)) != 0
+            || header.version != PJSUA2_TRACE_VERSION
+            || header.record_size != sizeof(TraceRecord)) {
+        fclose(_file);
+        _file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool TraceReader::next(TraceRecord& record, string& strings) {
+    if (!_file || fread(&record, sizeof(record), 1, _file) != 1) return false;
+    strings.resize(record.strings_len);
+    // A record cut short by a crash ends the trace
+    return record.strings_len == 0 || fread(&strings[0], 1, record.strings_len, _file) == record.strings_len;
+}
+
+string TraceReader::field(const string& strings, int n) {
+    size_t begin = 0;
+    for (int i = 0; i < n; i++) {
+        begin = strings.find('\0', begin);
+        if (begin == string::npos) return string();
+        begin++;
+    }
+    if (begin >= strings.size()) return string();
+    size_t end = strings.find('\0', begin);
+    return strings.substr(begin, end == string::npos ? string::npos : end - begin);
+}
@@ -0,0 +1,231 @@
+#ifndef SIP_TRACE_H
+#define SIP_TRACE_H
+
+#include <pjsua2.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define PJSUA2_TRACE_MAGIC "PJS2TRC"  /**< First 8 bytes of a trace file (with the NUL) */
+#define PJSUA2_TRACE_VERSION 1        /**< Current trace file layout version */
+
+/**
+ * @brief What a trace record captured.
+ */
+typedef enum {
+    PJSUA2_TRACE_REG_STARTED = 1,   /**< REGISTER sent (state: 1 for a renewal) */
+    PJSUA2_TRACE_REG_STATE = 2,     /**< Registration result (code, state: 1 if active, strings: reason) */
+    PJSUA2_TRACE_INCOMING_CALL = 3, /**< INVITE received (strings: Call-ID, local URI, remote URI) */
+    PJSUA2_TRACE_CALL_STATE = 4,    /**< Call state change (code, state; strings on the call's first record) */
+    PJSUA2_TRACE_MEDIA_STATE = 5,   /**< Call media update (state: 1 if the audio stream is active) */
+    PJSUA2_TRACE_COMMAND = 6        /**< Command from the application (op, strings: URI or account) */
+} TraceKind;
+
+/**
+ * @brief Command carried by a PJSUA2_TRACE_COMMAND record.
+ *
+ * Submitted commands are recorded twice: when queued (SUBMIT_*) and when the
+ * event thread runs them.
+ */
+typedef enum {
+    PJSUA2_TRACE_OP_MAKE_CALL = 1,        /**< Outgoing call placed (acc_handle, strings: destination) */
+    PJSUA2_TRACE_OP_ANSWER = 2,           /**< Call answered (handle) */
+    PJSUA2_TRACE_OP_HANGUP = 3,           /**< Call hung up (handle) */
+    PJSUA2_TRACE_OP_SUBMIT_MAKE_CALL = 4, /**< Outgoing call queued (acc_handle, code: request id, strings: destination) */
+    PJSUA2_TRACE_OP_SUBMIT_ANSWER = 5,    /**< Answer queued (handle, code: request id) */
+    PJSUA2_TRACE_OP_SUBMIT_HANGUP = 6,    /**< Hangup queued (handle, code: request id) */
+    PJSUA2_TRACE_OP_ACCOUNT_ADD = 7,      /**< Account added (acc_handle, strings: user@domain) */
+    PJSUA2_TRACE_OP_ACCOUNT_REMOVE = 8    /**< Account removed (acc_handle) */
+} TraceOp;
+
+/**
+ * @brief Trace file header.
+ */
+typedef struct {
+    char magic[8];          /**< PJSUA2_TRACE_MAGIC */
+    uint32_t version;       /**< PJSUA2_TRACE_VERSION */
+    uint32_t record_size;   /**< sizeof(TraceRecord) */
+    uint64_t start_us;      /**< Steady clock when the trace started */
+} TraceHeader;
+
+/**
+ * @brief Fixed-size trace record (32 bytes), followed in the file by
+ * strings_len bytes of NUL-separated strings.
+ */
+typedef struct {
+    uint64_t timestamp_us;  /**< Microseconds since the trace started */
+    uint8_t kind;           /**< TraceKind */
+    uint8_t op;             /**< TraceOp of a command, 0 otherwise */
+    uint16_t strings_len;   /**< Bytes of strings following the record */
+    int32_t index;          /**< pjsua call index, -1 if none */
+    int32_t handle;         /**< Call handle at record time, -1 if none */
+    int32_t acc_handle;     /**< Account handle, -1 if none */
+    int32_t code;           /**< SIP status code, or request id of a submitted command */
+    int32_t state;          /**< pjsip_inv_state, registration or media flag */
+} TraceRecord;
+
+/**
+ * @brief Outcome of PJSUA2Manager::replay_trace.
+ */
+typedef struct {
+    uint64_t records;       /**< Records read */
+    uint64_t call_events;   /**< Incoming call and call state records fed to the callback layer */
+    uint64_t reg_events;    /**< Registration records fed to the callback layer */
+    uint64_t commands;      /**< Command records (timing only, not executed) */
+    uint64_t skipped;       /**< Records that did not match a replayed call */
+    uint64_t elapsed_us;    /**< Wall time of the replay */
+    uint64_t max_lag_us;    /**< Worst delay behind the recorded schedule, 0 at maximum speed */
+} TraceReplayStats;
+
+
+/**
+ * @brief Binary recorder of the signalling and command stream.
+ *
+ * Callbacks append a fixed record and a few strings to an in-memory buffer
+ * under a short lock; a background thread writes the buffer out every few
+ * milliseconds. A call's Call-ID and URIs are written once, with its first
+ * record. When the writer falls behind records are dropped and counted.
+ * Recording costs one relaxed load while no trace is open.
+ */
+class TraceRecorder {
+public:
+    TraceRecorder();
+
+    /**
+     * @brief Stop the trace, flushing pending records
+     */
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    /**
+     * @brief Start writing a new trace, replacing the current one
+     *
+     * @param path Trace file, truncated
+     * @return true if the file could be opened
+     */
+    bool start(const std::string& path);
+
+    /**
+     * @brief Flush pending records and close the trace
+     */
+    void stop();
+
+    /**
+     * @brief A trace is being written
+     */
+    bool active() const { return _active.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Append a record (any thread)
+     *
+     * @param record Record, timestamp and strings_len are filled in
+     * @param strings NUL-separated strings (may be null)
+     * @param len Length of strings
+     */
+    void record(TraceRecord& record, const char* strings, size_t len);
+
+    /**
+     * @brief Append a call record, with the call's strings if not yet written
+     *
+     * @param kind PJSUA2_TRACE_INCOMING_CALL or PJSUA2_TRACE_CALL_STATE
+     * @param index pjsua call index
+     * @param handle Registry handle of the call
+     * @param info Current call info
+     */
+    void record_call(TraceKind kind, int index, int handle, const pj::CallInfo& info);
+
+    /**
+     * @brief Append a registration, media or command record without call strings
+     */
+    void record(TraceKind kind, TraceOp op, int index, int handle, int acc_handle, int code, int state,
+                const std::string& text = std::string());
+
+    /**
+     * @brief Records written since start()
+     */
+    uint64_t records() const { return _records.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Records dropped because the writer fell behind
+     */
+    uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t MAX_PENDING = 8 * 1024 * 1024; /**< Buffered bytes before records are dropped */
+    static const unsigned FLUSH_MS = 50;               /**< Writer period */
+
+    /**
+     * @brief Writer thread body
+     */
+    void _run();
+
+    /**
+     * @brief Stop the writer and close the file (control mutex held)
+     */
+    void _stop();
+
+    std::mutex _controlMutex;                    /**< Serializes start() and stop() */
+    std::atomic<bool> _active;                   /**< A trace is open */
+    std::atomic<uint64_t> _records;              /**< Record counter */
+    std::atomic<uint64_t> _dropped;              /**< Dropped record counter */
+    std::atomic<int> _internedCalls[PJSUA_MAX_CALLS]; /**< Handle whose strings were written, per call index */
+    uint64_t _startUs;                           /**< Steady clock at start() */
+
+    std::mutex _mutex;                           /**< Guards _pending and _stopping */
+    std::vector<char> _pending;                  /**< Records awaiting the writer */
+    std::condition_variable _wake;               /**< Stops the writer wait */
+    bool _stopping;                              /**< Writer must exit */
+    FILE* _file;                                 /**< Trace file, owned by the writer while it runs */
+    std::thread _thread;                         /**< Writer thread */
+};
+
+
+/**
+ * @brief Sequential reader of a trace file.
+ */
+class TraceReader {
+public:
+    TraceReader();
+
+    /**
+     * @brief Close the file
+     */
+    ~TraceReader();
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    /**
+     * @brief Open a trace and check its header
+     *
+     * @param path Trace file
+     * @return true if the file is a trace of a supported version
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Read the next record
+     *
+     * @param record Destination
+     * @param strings Receives the record's strings (NUL-separated)
+     * @return true if a complete record was read, false at the end of the trace
+     */
+    bool next(TraceRecord& record, std::string& strings);
+
+    /**
+     * @brief String number n of a record (empty if missing)
+     */
+    static std::string field(const std::string& strings, int n);
+
+private:
+    FILE* _file;    /**< Trace file, null if not open */
+};
+
+#endif // SIP_TRACE_H
@@ -0,0 +1,124 @@
+// admission_control_test.cpp
+//
+// Decisions of AdmissionControl on synthetic load: token bucket, account
+// cap, event queue depth and a stalled sampling timer. No SIP stack is
+// started.
+
+#include <gtest/gtest.h>
+#include "../admission_control.hpp"
+#include "../call_metrics.hpp"
+
+#include <cstring>
+
+namespace {
+
+AdmissionConfig limits() {
+    AdmissionConfig config;
+    memset(&config, 0, sizeof(config));
+    config.version = PJSUA2_ADMISSION_CONFIG_VERSION;
+    config.retry_after_sec = 5;
+    return config;
+}
+
+} // namespace
+
+TEST(AdmissionControl, AdmitsEverythingByDefault) {
+    AdmissionControl admission;
+    admission.configure(limits());
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(ADMISSION_ACCEPT, admission.admit(i, 100000));
+    }
+    AdmissionStats stats;
+    admission.read(stats);
+    EXPECT_EQ(1000u, stats.admitted);
+    // No lag or CPU limit: the sampling timer stays off
+    EXPECT_FALSE(admission.sampling());
+}
+
+TEST(AdmissionControl, SamplesOnlyForLagOrCpuLimits) {
+    AdmissionControl admission;
+    AdmissionConfig config = limits();
+    config.calls_per_second = 10;
+    config.max_event_queue = 64;
+    admission.configure(config);
+    EXPECT_FALSE(admission.sampling());
+
+    config.max_cpu_percent = 90;
+    admission.configure(config);
+    EXPECT_TRUE(admission.sampling());
+
+    config.max_cpu_percent = 0;
+    config.max_loop_lag_ms = 50;
+    admission.configure(config);
+    EXPECT_TRUE(admission.sampling());
+    admission.timer_armed(CallMetrics::now_us() - 200000);
+    admission.timer_fired(CallMetrics::now_us());
+
+    // Clearing both limits drops the stale samples
+    config.max_loop_lag_ms = 0;
+    admission.configure(config);
+    EXPECT_FALSE(admission.sampling());
+    AdmissionStats stats;
+    admission.read(stats);
+    EXPECT_EQ(0u, stats.loop_lag_us);
+}
+
+TEST(AdmissionControl, TokenBucketAllowsBurstThenRejects) {
+    AdmissionControl admission;
+    AdmissionConfig config = limits();
+    config.calls_per_second = 1;
+    config.burst = 3;
+    admission.configure(config);
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(ADMISSION_ACCEPT, admission.admit(0, 0));
+    }
+    EXPECT_EQ(ADMISSION_REJECT_RATE, admission.admit(0, 0));
+    EXPECT_EQ(PJSIP_SC_SERVICE_UNAVAILABLE, AdmissionControl::status_code(ADMISSION_REJECT_RATE));
+
+    AdmissionStats stats;
+    admission.read(stats);
+    EXPECT_EQ(3u, stats.admitted);
+    EXPECT_EQ(1u, stats.rejected_rate);
+}
+
+TEST(AdmissionControl, AccountCapAnswersBusyWithoutSpendingTokens) {
+    AdmissionControl admission;
+    AdmissionConfig config = limits();
+    config.calls_per_second = 1;
+    config.burst = 1;
+    config.max_calls_per_account = 2;
+    admission.configure(config);
+
+    EXPECT_EQ(ADMISSION_REJECT_ACCOUNT, admission.admit(2, 0));
+    EXPECT_EQ(PJSIP_SC_BUSY_HERE, AdmissionControl::status_code(ADMISSION_REJECT_ACCOUNT));
+    // The refused call left the only token in the bucket
+    EXPECT_EQ(ADMISSION_ACCEPT, admission.admit(1, 0));
+}
+
+TEST(AdmissionControl, OverloadSignalsReject) {
+    AdmissionControl admission;
+    AdmissionConfig config = limits();
+    config.max_event_queue = 64;
+    config.max_loop_lag_ms = 50;
+    admission.configure(config);
+
+    EXPECT_EQ(ADMISSION_ACCEPT, admission.admit(0, 64));
+    EXPECT_EQ(ADMISSION_REJECT_QUEUE, admission.admit(0, 65));
+
+    // A sampling timer that should have fired 200 ms ago: the loop is stalled
+    admission.timer_armed(CallMetrics::now_us() - 200000);
+    EXPECT_EQ(ADMISSION_REJECT_LAG, admission.admit(0, 0));
+    admission.timer_fired(CallMetrics::now_us());
+    admission.timer_armed(CallMetrics::now_us() + 100000);
+    AdmissionStats stats;
+    admission.read(stats);
+    EXPECT_GE(stats.loop_lag_us, 200000u);
+    EXPECT_EQ(1u, stats.rejected_queue);
+    EXPECT_EQ(1u, stats.rejected_lag);
+
+    admission.reset();
+    admission.read(stats);
+    EXPECT_EQ(0u, stats.admitted);
+    EXPECT_EQ(0u, stats.rejected_lag);
+}
@@ -0,0 +1,255 @@
+// call_load_bench.cpp
+//
+// Loopback load test: a forked child runs a second endpoint on 127.0.0.1
+// that answers every incoming call, and the parent dials it through the FFI
+// (pjsua2_submit_make_call / pjsua2_submit_hangup_call) at a fixed call
+// rate and concurrency. Reports calls per second, INVITE-to-CONFIRMED
+// setup latency percentiles, CPU time and peak RSS of both processes.
+//
+//   call_load_bench [--calls N] [--rate CPS] [--concurrency C] [--hold-ms MS] [--port P]
+
+#include "../ffi_bindings.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int calls = 200;
+    double rate = 20.0;
+    int concurrency = 16;
+    int holdMs = 500;
+    int port = 5080;            // Generator; the stand-in UAS listens on port + 1
+};
+
+struct CallEntry {
+    uint64_t submittedUs = 0;
+    bool confirmed = false;
+};
+
+volatile sig_atomic_t g_stop = 0;
+
+uint64_t now_us() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)] / 1000.0;
+}
+
+double cpu_seconds(const rusage& usage) {
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+PJSUA2ManagerPtr create_endpoint(const char* user, int port, int peer_port, int max_calls) {
+    ManagerConfig config;
+    pjsua2_manager_config_default(&config);
+    config.udp_port = port;
+    config.tcp_port = -1;
+    config.tls_port = -1;
+    config.max_calls = (unsigned)max_calls;
+    config.log_level = 1;
+    // Registration towards the peer is refused; calls are placed without it
+    std::string domain = "127.0.0.1:" + std::to_string(peer_port);
+    PJSUA2ManagerPtr mgr = pjsua2_manager_create_ex(user, "", domain.c_str(), &config,
+                                                    nullptr, nullptr, nullptr, nullptr);
+    if (mgr) {
+        pjsua2_set_headless(mgr, 1);
+        pjsua2_start_events_loop_blocking(mgr);
+    }
+    return mgr;
+}
+
+// Stand-in UAS: answers every call until SIGTERM
+int run_uas(const Options& options) {
+    signal(SIGTERM, [](int) { g_stop = 1; });
+    PJSUA2ManagerPtr mgr = create_endpoint("uas", options.port + 1, options.port, options.concurrency + 4);
+    if (!mgr) return EXIT_FAILURE;
+
+    EventData events[64];
+    char strings[16 * 1024];
+    struct pollfd pfd = {pjsua2_get_event_fd(mgr), POLLIN, 0};
+    while (!g_stop) {
+        poll(&pfd, 1, 200);
+        int n;
+        do {
+            n = pjsua2_poll_events(mgr, events, 64, strings, sizeof(strings));
+            for (int i = 0; i < n; i++) {
+                if (events[i].type == PJSUA2_EVENT_INCOMING_CALL) {
+                    pjsua2_submit_answer_call(mgr, events[i].call_handle);
+                }
+            }
+        } while (n == 64);
+    }
+    pjsua2_stop_events_loop(mgr);
+    pjsua2_manager_destroy(mgr);
+    return EXIT_SUCCESS;
+}
+
+bool parse(int argc, char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        const char* value = argv[i + 1];
+        if (name == "--calls") options.calls = atoi(value);
+        else if (name == "--rate") options.rate = atof(value);
+        else if (name == "--concurrency") options.concurrency = atoi(value);
+        else if (name == "--hold-ms") options.holdMs = atoi(value);
+        else if (name == "--port") options.port = atoi(value);
+        else return false;
+    }
+    return options.calls > 0 && options.rate > 0 && options.concurrency > 0 && options.holdMs >= 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (argc % 2 == 0 || !parse(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--calls N] [--rate CPS] [--concurrency C] [--hold-ms MS] [--port P]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Fork before PJSIP starts any thread: each process gets its own endpoint singleton
+    pid_t uas = fork();
+    if (uas == 0) {
+        _exit(run_uas(options));
+    }
+    if (uas < 0) {
+        perror("fork");
+        return EXIT_FAILURE;
+    }
+
+    PJSUA2ManagerPtr mgr = create_endpoint("bench", options.port, options.port + 1, options.concurrency + 4);
+    if (!mgr) {
+        fprintf(stderr, "cannot create the generator endpoint\n");
+        kill(uas, SIGTERM);
+        waitpid(uas, nullptr, 0);
+        return EXIT_FAILURE;
+    }
+    // Let the UAS bind its port
+    usleep(500 * 1000);
+
+    int acc = pjsua2_get_default_account(mgr);
+    std::string target = "sip:uas@127.0.0.1:" + std::to_string(options.port + 1);
+    std::unordered_map<int, uint64_t> requests;         // request id -> submit time
+    std::unordered_map<int, CallEntry> calls;           // call handle -> entry
+    std::unordered_set<int> endedEarly;                 // disconnected before COMMAND_DONE
+    std::vector<std::pair<uint64_t, int>> hangups;      // due time, call handle
+    std::vector<uint64_t> latencies;
+    latencies.reserve(options.calls);
+
+    int launched = 0, active = 0, finished = 0, failed = 0;
+    const uint64_t intervalUs = (uint64_t)(1e6 / options.rate);
+    const uint64_t start = now_us();
+    const uint64_t deadline = start + (uint64_t)(options.calls / options.rate * 1e6) + options.holdMs * 1000ull + 30000000ull;
+    uint64_t nextLaunch = start;
+
+    EventData events[64];
+    char strings[16 * 1024];
+    struct pollfd pfd = {pjsua2_get_event_fd(mgr), POLLIN, 0};
+
+    while (finished < options.calls && now_us() < deadline) {
+        uint64_t now = now_us();
+        while (launched < options.calls && active < options.concurrency && now >= nextLaunch) {
+            int rid = pjsua2_submit_make_call(mgr, acc, target.c_str());
+            requests[rid] = now_us();
+            launched++;
+            active++;
+            nextLaunch += intervalUs;
+        }
+        for (size_t i = 0; i < hangups.size();) {
+            if (hangups[i].first <= now) {
+                pjsua2_submit_hangup_call(mgr, hangups[i].second);
+                hangups[i] = hangups.back();
+                hangups.pop_back();
+            } else {
+                i++;
+            }
+        }
+
+        uint64_t wake = launched < options.calls ? nextLaunch : now + 100000;
+        for (const auto& hangup : hangups) wake = std::min(wake, hangup.first);
+        poll(&pfd, 1, wake > now ? (int)((wake - now + 999) / 1000) : 0);
+
+        int n;
+        do {
+            n = pjsua2_poll_events(mgr, events, 64, strings, sizeof(strings));
+            for (int i = 0; i < n; i++) {
+                const EventData& event = events[i];
+                if (event.type == PJSUA2_EVENT_COMMAND_DONE) {
+                    auto request = requests.find(event.request_id);
+                    if (request == requests.end()) continue;
+                    uint64_t submitted = request->second;
+                    requests.erase(request);
+                    if (event.state != 0 || event.call_handle < 0 || endedEarly.erase(event.call_handle)) {
+                        failed++;
+                        finished++;
+                        active--;
+                    } else {
+                        calls[event.call_handle].submittedUs = submitted;
+                    }
+                } else if (event.type == PJSUA2_EVENT_CALL_STATE) {
+                    auto call = calls.find(event.call_handle);
+                    if (call == calls.end()) {
+                        if (event.state == PJSIP_INV_STATE_DISCONNECTED) endedEarly.insert(event.call_handle);
+                        continue;
+                    }
+                    if (event.state == PJSIP_INV_STATE_CONFIRMED && !call->second.confirmed) {
+                        call->second.confirmed = true;
+                        latencies.push_back(event.timestamp_us - call->second.submittedUs);
+                        hangups.emplace_back(now_us() + options.holdMs * 1000ull, event.call_handle);
+                    } else if (event.state == PJSIP_INV_STATE_DISCONNECTED) {
+                        if (!call->second.confirmed) failed++;
+                        calls.erase(call);
+                        finished++;
+                        active--;
+                    }
+                }
+            }
+        } while (n == 64);
+    }
+    double elapsed = (now_us() - start) / 1e6;
+
+    MemoryStats memory;
+    memset(&memory, 0, sizeof(memory));
+    pjsua2_get_memory_stats(mgr, &memory);
+    pjsua2_stop_events_loop(mgr);
+    pjsua2_manager_destroy(mgr);
+    kill(uas, SIGTERM);
+    waitpid(uas, nullptr, 0);
+
+    rusage self, child;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &child);
+    std::sort(latencies.begin(), latencies.end());
+
+    printf("calls        attempted %d  answered %zu  failed %d  unfinished %d\n",
+           launched, latencies.size(), failed, options.calls - finished);
+    printf("throughput   %.1f calls/s over %.2f s (target %.1f, concurrency %d, hold %d ms)\n",
+           latencies.size() / elapsed, elapsed, options.rate, options.concurrency, options.holdMs);
+    printf("setup ms     p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+           percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99), percentile(latencies, 100));
+    printf("cpu          generator %.2f s (%.0f%%)  uas %.2f s (%.0f%%)\n",
+           cpu_seconds(self), 100.0 * cpu_seconds(self) / elapsed, cpu_seconds(child), 100.0 * cpu_seconds(child) / elapsed);
+    printf("rss          generator %ld KiB peak, %llu KiB at end  uas %ld KiB peak\n",
+           self.ru_maxrss, (unsigned long long)memory.rss_bytes / 1024, child.ru_maxrss);
+
+    return failed == 0 && finished == options.calls ? EXIT_SUCCESS : EXIT_FAILURE;
+}
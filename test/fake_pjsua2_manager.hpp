@@ -0,0 +1,146 @@
+// fake_pjsua2_manager.hpp
+#ifndef FAKE_PJSUA2_MANAGER_HPP
+#define FAKE_PJSUA2_MANAGER_HPP
+
+#include "../pjsua2_manager.hpp"
+#include "../pjsua2_manager_interface.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+// In-memory backend: calls live in a fixed slot table searched like
+// CallRegistry::find, commands complete immediately through a real
+// EventQueue, and unknown calls throw pj::Error like PJSUA2Manager does.
+class FakePJSUA2Manager : public IPJSUA2Manager {
+public:
+    FakePJSUA2Manager() : _nextCall(0), _nextRequest(0) {
+        memset(_slots, 0, sizeof(_slots));
+    }
+
+    std::string make_call(const std::string& dest_uri) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (int i = 0; i < CallRegistry::CAPACITY; i++) {
+            Slot& slot = _slots[i];
+            if (slot.used) continue;
+            slot.used = true;
+            memset(&slot.data, 0, sizeof(slot.data));
+            snprintf(slot.data.call_id, sizeof(slot.data.call_id), "fake-%u@127.0.0.1", _nextCall++);
+            snprintf(slot.data.remote_uri, sizeof(slot.data.remote_uri), "%s", dest_uri.c_str());
+            snprintf(slot.data.local_uri, sizeof(slot.data.local_uri), "sip:fake@127.0.0.1");
+            snprintf(slot.data.actual_state, sizeof(slot.data.actual_state), "CALLING");
+            slot.data.call_handle = ((++slot.generation & 0x7ffff) << CallRegistry::INDEX_BITS) | i;
+            slot.data.state = PJSIP_INV_STATE_CALLING;
+            slot.data.direction = CALL_DIR_OUTBOUND;
+            return slot.data.call_id;
+        }
+        throw Error(PJ_ETOOMANY, "Call Error", "No free call slot", __FILE__, __LINE__);
+    }
+
+    void answer_call(const std::string& call_id) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _find(call_id).data.state = PJSIP_INV_STATE_CONFIRMED;
+    }
+
+    void hang_up_call(const std::string& call_id) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _find(call_id).used = false;
+    }
+
+    CallData get_call_info(const std::string& call_id) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _find(call_id).data;
+    }
+
+    void start_event_loop(unsigned) override {}
+    void stop_event_loop() override {}
+
+    int get_call_handle(const std::string& call_id) const override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const Slot& slot : _slots) {
+            if (slot.used && call_id == slot.data.call_id) return slot.data.call_handle;
+        }
+        return CallRegistry::INVALID_HANDLE;
+    }
+
+    void answer_call(int handle) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _at(handle).data.state = PJSIP_INV_STATE_CONFIRMED;
+    }
+
+    void hang_up_call(int handle) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _at(handle).used = false;
+    }
+
+    CallData get_call_info(int handle) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _at(handle).data;
+    }
+
+    int get_calls_snapshot(CallData* out, int cap) const override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        int n = 0;
+        for (const Slot& slot : _slots) {
+            if (n >= cap) break;
+            if (slot.used) out[n++] = slot.data;
+        }
+        return n;
+    }
+
+    int submit_make_call(int acc_handle, const std::string&) override {
+        return _complete(CallRegistry::INVALID_HANDLE, acc_handle);
+    }
+
+    int submit_answer_call(int handle) override { return _complete(handle, -1); }
+    int submit_hang_up_call(int handle) override { return _complete(handle, -1); }
+
+    int poll_events(EventData* out, int max, char* strings, size_t strings_cap) override {
+        return _events.pop_batch(out, max, strings, strings_cap);
+    }
+
+    int event_fd() const override { return _events.notify_fd(); }
+
+private:
+    struct Slot {
+        bool used;
+        uint32_t generation;
+        CallData data;
+    };
+
+    Slot& _find(const std::string& call_id) {
+        for (Slot& slot : _slots) {
+            if (slot.used && call_id == slot.data.call_id) return slot;
+        }
+        throw Error(PJ_ENOTFOUND, "Call Error", "Unknown Call-ID", __FILE__, __LINE__);
+    }
+
+    Slot& _at(int handle) {
+        int index = handle & ((1 << CallRegistry::INDEX_BITS) - 1);
+        if (handle < 0 || index >= CallRegistry::CAPACITY || !_slots[index].used
+                || _slots[index].data.call_handle != handle) {
+            throw Error(PJ_ENOTFOUND, "Call Error", "Unknown call handle", __FILE__, __LINE__);
+        }
+        return _slots[index];
+    }
+
+    int _complete(int call_handle, int acc_handle) {
+        EventData event;
+        memset(&event, 0, sizeof(event));
+        event.version = PJSUA2_EVENT_VERSION;
+        event.type = PJSUA2_EVENT_COMMAND_DONE;
+        event.call_handle = call_handle;
+        event.acc_handle = acc_handle;
+        event.request_id = ++_nextRequest;
+        _events.push(event);
+        return event.request_id;
+    }
+
+    mutable std::mutex _mutex;
+    Slot _slots[CallRegistry::CAPACITY];
+    unsigned _nextCall;
+    int _nextRequest;
+    EventQueue _events;
+};
+
+#endif
@@ -0,0 +1,174 @@
+// ffi_bindings_bench.cpp
+//
+// Microbenchmarks of the FFI shims against FakePJSUA2Manager: per entry
+// point cost and the price of errors thrown through the catch (const Error&)
+// paths. Call lookups as the number of live calls grows are measured on a
+// real CallRegistry, filled with call-less slots as trace replay does, and
+// event throughput on a real EventQueue. No SIP stack is started.
+
+#include <benchmark/benchmark.h>
+#include "../ffi_bindings.hpp"
+#include "fake_pjsua2_manager.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+PJSUA2ManagerPtr handle_of(FakePJSUA2Manager& fake) {
+    return static_cast<PJSUA2ManagerPtr>(static_cast<IPJSUA2Manager*>(&fake));
+}
+
+// Fills the fake with count calls, returns their Call-IDs in slot order
+std::vector<std::string> populate(FakePJSUA2Manager& fake, int count) {
+    std::vector<std::string> ids;
+    for (int i = 0; i < count; i++) {
+        ids.push_back(fake.make_call("sip:peer@127.0.0.1"));
+    }
+    return ids;
+}
+
+// Fills slots 0..count-1 of a registry without pj::Call objects, returns their handles
+std::vector<int> populate(CallRegistry& registry, int count) {
+    std::vector<int> handles;
+    for (int i = 0; i < count; i++) {
+        pj::CallInfo info;
+        info.callIdString = "call-" + std::to_string(i) + "@127.0.0.1";
+        info.localUri = "sip:local@127.0.0.1";
+        info.remoteUri = "sip:peer@127.0.0.1";
+        info.stateText = "CONFIRMED";
+        info.state = PJSIP_INV_STATE_CONFIRMED;
+        handles.push_back(registry.insert(i, nullptr, CALL_DIR_OUTBOUND, info, 0));
+    }
+    return handles;
+}
+
+// Baseline: argument checks only, the backend is never reached
+void BM_NullArgument(benchmark::State& state) {
+    FakePJSUA2Manager fake;
+    CallData data;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pjsua2_get_call_info(handle_of(fake), nullptr, &data));
+    }
+}
+BENCHMARK(BM_NullArgument);
+
+void BM_MakeAndHangupCall(benchmark::State& state) {
+    FakePJSUA2Manager fake;
+    char call_id[128];
+    for (auto _ : state) {
+        pjsua2_make_call(handle_of(fake), "sip:peer@127.0.0.1", call_id, sizeof(call_id));
+        pjsua2_hangup_call(handle_of(fake), call_id);
+    }
+}
+BENCHMARK(BM_MakeAndHangupCall);
+
+void BM_AnswerCall(benchmark::State& state) {
+    FakePJSUA2Manager fake;
+    std::string id = populate(fake, 1)[0];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pjsua2_answer_call(handle_of(fake), id.c_str()));
+    }
+}
+BENCHMARK(BM_AnswerCall);
+
+// Same shim, but the backend throws pj::Error and the shim translates it to -1
+void BM_AnswerCallThrows(benchmark::State& state) {
+    FakePJSUA2Manager fake;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pjsua2_answer_call(handle_of(fake), "unknown@127.0.0.1"));
+    }
+}
+BENCHMARK(BM_AnswerCallThrows);
+
+void BM_HangupByHandleThrows(benchmark::State& state) {
+    FakePJSUA2Manager fake;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pjsua2_hangup_call_by_handle(handle_of(fake), 12345));
+    }
+}
+BENCHMARK(BM_HangupByHandleThrows);
+
+// Worst case: the looked-up call sits in the last occupied slot
+void BM_RegistryFindAndRead(benchmark::State& state) {
+    CallRegistry registry;
+    populate(registry, (int)state.range(0));
+    std::string id = "call-" + std::to_string(state.range(0) - 1) + "@127.0.0.1";
+    CallData data;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(registry.read(registry.find(id), data));
+    }
+}
+BENCHMARK(BM_RegistryFindAndRead)->RangeMultiplier(2)->Range(1, CallRegistry::CAPACITY);
+
+void BM_RegistryReadByHandle(benchmark::State& state) {
+    CallRegistry registry;
+    int handle = populate(registry, (int)state.range(0)).back();
+    CallData data;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(registry.read(handle, data));
+    }
+}
+BENCHMARK(BM_RegistryReadByHandle)->RangeMultiplier(2)->Range(1, CallRegistry::CAPACITY);
+
+void BM_RegistryFind(benchmark::State& state) {
+    CallRegistry registry;
+    populate(registry, (int)state.range(0));
+    std::string id = "call-" + std::to_string(state.range(0) - 1) + "@127.0.0.1";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(registry.find(id));
+    }
+}
+BENCHMARK(BM_RegistryFind)->RangeMultiplier(2)->Range(1, CallRegistry::CAPACITY);
+
+void BM_RegistrySnapshot(benchmark::State& state) {
+    CallRegistry registry;
+    populate(registry, (int)state.range(0));
+    std::vector<CallData> out(CallRegistry::CAPACITY);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(registry.snapshot(out.data(), (int)out.size()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RegistrySnapshot)->RangeMultiplier(2)->Range(1, CallRegistry::CAPACITY);
+
+// Submit commands and drain their COMMAND_DONE events in batches
+void BM_SubmitAndPollEvents(benchmark::State& state) {
+    FakePJSUA2Manager fake;
+    const int batch = (int)state.range(0);
+    std::vector<EventData> events(batch);
+    char strings[4096];
+    for (auto _ : state) {
+        for (int i = 0; i < batch; i++) {
+            pjsua2_submit_hangup_call(handle_of(fake), i);
+        }
+        benchmark::DoNotOptimize(pjsua2_poll_events(handle_of(fake), events.data(), batch, strings, sizeof(strings)));
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_SubmitAndPollEvents)->Arg(1)->Arg(16)->Arg(256);
+
+// Event ring alone, with the Call-ID/URI strings a call's first event carries
+void BM_EventQueueThroughput(benchmark::State& state) {
+    EventQueue queue(1024);
+    const int batch = (int)state.range(0);
+    std::vector<EventData> events(batch);
+    std::vector<char> strings(batch * 96);
+    static const char attached[] = "fake-1@127.0.0.1\0sip:fake@127.0.0.1\0sip:peer@127.0.0.1";
+    EventData event;
+    memset(&event, 0, sizeof(event));
+    event.version = PJSUA2_EVENT_VERSION;
+    event.type = PJSUA2_EVENT_CALL_STATE;
+    for (auto _ : state) {
+        for (int i = 0; i < batch; i++) {
+            queue.push(event, attached, sizeof(attached));
+        }
+        benchmark::DoNotOptimize(queue.pop_batch(events.data(), batch, strings.data(), strings.size()));
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_EventQueueThroughput)->Arg(1)->Arg(64)->Arg(512);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,99 @@
+// ffi_bindings_test.cpp
+//
+// Return codes of the call-control FFI shims, checked against
+// MockPJSUA2Manager so no SIP stack is needed.
+
+#include <gtest/gtest.h>
+#include "../ffi_bindings.hpp"
+#include "mock_pjsua2_manager.hpp"
+
+#include <cstring>
+
+using ::testing::_;
+using ::testing::Return;
+using ::testing::Throw;
+
+namespace {
+
+PJSUA2ManagerPtr handle_of(MockPJSUA2Manager& mock) {
+    return static_cast<PJSUA2ManagerPtr>(static_cast<IPJSUA2Manager*>(&mock));
+}
+
+pj::Error not_found() {
+    return pj::Error(PJ_ENOTFOUND, "Call Error", "Unknown call", __FILE__, __LINE__);
+}
+
+} // namespace
+
+TEST(FfiBindings, MakeCallCopiesAndTruncatesCallId) {
+    MockPJSUA2Manager mock;
+    EXPECT_CALL(mock, make_call(std::string("sip:peer@example.org")))
+        .WillOnce(Return(std::string("0123456789@example.org")));
+
+    char call_id[8];
+    EXPECT_EQ(0, pjsua2_make_call(handle_of(mock), "sip:peer@example.org", call_id, sizeof(call_id)));
+    EXPECT_STREQ("0123456", call_id);
+}
+
+TEST(FfiBindings, MakeCallRejectsBadArguments) {
+    MockPJSUA2Manager mock;
+    EXPECT_CALL(mock, make_call(_)).Times(0);
+
+    char call_id[8];
+    EXPECT_EQ(-2, pjsua2_make_call(nullptr, "sip:peer@example.org", call_id, sizeof(call_id)));
+    EXPECT_EQ(-2, pjsua2_make_call(handle_of(mock), nullptr, call_id, sizeof(call_id)));
+    EXPECT_EQ(-3, pjsua2_make_call(handle_of(mock), "sip:peer@example.org", call_id, 0));
+}
+
+TEST(FfiBindings, ErrorsBecomeMinusOne) {
+    MockPJSUA2Manager mock;
+    EXPECT_CALL(mock, answer_call(std::string("missing"))).WillOnce(Throw(not_found()));
+    EXPECT_CALL(mock, answer_call(42)).WillOnce(Throw(not_found()));
+    EXPECT_CALL(mock, hang_up_call(std::string("missing"))).WillOnce(Throw(not_found()));
+    EXPECT_CALL(mock, hang_up_call(42)).WillOnce(Throw(not_found()));
+
+    EXPECT_EQ(-1, pjsua2_answer_call(handle_of(mock), "missing"));
+    EXPECT_EQ(-1, pjsua2_answer_call_by_handle(handle_of(mock), 42));
+    EXPECT_EQ(-1, pjsua2_hangup_call(handle_of(mock), "missing"));
+    EXPECT_EQ(-1, pjsua2_hangup_call_by_handle(handle_of(mock), 42));
+}
+
+TEST(FfiBindings, GetCallInfoByHandle) {
+    MockPJSUA2Manager mock;
+    CallData data;
+    memset(&data, 0, sizeof(data));
+    data.call_handle = 7;
+    strcpy(data.call_id, "abc@example.org");
+    EXPECT_CALL(mock, get_call_info(7)).WillOnce(Return(data));
+
+    CallData out;
+    EXPECT_EQ(0, pjsua2_get_call_info_by_handle(handle_of(mock), 7, &out));
+    EXPECT_EQ(7, out.call_handle);
+    EXPECT_STREQ("abc@example.org", out.call_id);
+    EXPECT_EQ(-2, pjsua2_get_call_info_by_handle(handle_of(mock), 7, nullptr));
+}
+
+TEST(FfiBindings, PollEventsValidatesAndForwards) {
+    MockPJSUA2Manager mock;
+    EventData events[4];
+    char strings[64];
+    EXPECT_CALL(mock, poll_events(events, 4, strings, sizeof(strings))).WillOnce(Return(3));
+    EXPECT_CALL(mock, poll_events(events, 4, nullptr, 0)).WillOnce(Return(1));
+
+    EXPECT_EQ(3, pjsua2_poll_events(handle_of(mock), events, 4, strings, sizeof(strings)));
+    // No arena: the capacity is ignored
+    EXPECT_EQ(1, pjsua2_poll_events(handle_of(mock), events, 4, nullptr, 64));
+    EXPECT_EQ(-3, pjsua2_poll_events(handle_of(mock), events, 0, strings, sizeof(strings)));
+    EXPECT_EQ(-2, pjsua2_poll_events(handle_of(mock), nullptr, 4, strings, sizeof(strings)));
+}
+
+TEST(FfiBindings, SubmitCommandsReturnRequestIds) {
+    MockPJSUA2Manager mock;
+    EXPECT_CALL(mock, submit_make_call(0, std::string("sip:peer@example.org"))).WillOnce(Return(11));
+    EXPECT_CALL(mock, submit_answer_call(5)).WillOnce(Return(12));
+    EXPECT_CALL(mock, submit_hang_up_call(5)).WillOnce(Return(13));
+
+    EXPECT_EQ(11, pjsua2_submit_make_call(handle_of(mock), 0, "sip:peer@example.org"));
+    EXPECT_EQ(12, pjsua2_submit_answer_call(handle_of(mock), 5));
+    EXPECT_EQ(13, pjsua2_submit_hangup_call(handle_of(mock), 5));
+}
@@ -0,0 +1,156 @@
+// invite_headers_test.cpp
+//
+// Parses sample INVITEs with the PJSIP parser and checks the packed
+// "\0name\0value" pairs InviteHeaders extracts: order, repeated and
+// missing headers, compact forms, the size cap and the count of dropped
+// headers. No call is placed.
+
+#include <gtest/gtest.h>
+#include "../invite_headers.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+const char INVITE[] =
+    "INVITE sip:bob@example.org SIP/2.0\r\n"
+    "Via: SIP/2.0/UDP 192.0.2.1:5060;branch=z9hG4bK776asdhds\r\n"
+    "Max-Forwards: 70\r\n"
+    "f: \"Alice\" <sip:alice@example.org>;tag=1928301774\r\n"
+    "To: <sip:bob@example.org>\r\n"
+    "i: a84b4c76e66710@192.0.2.1\r\n"
+    "CSeq: 314159 INVITE\r\n"
+    "Contact: <sip:alice@192.0.2.1>\r\n"
+    "X-Caller-Id: 4711\r\n"
+    "P-Asserted-Identity: <sip:alice@example.org>\r\n"
+    "P-Asserted-Identity: <tel:+15551234567>\r\n"
+    "Alert-Info: <http://example.org/ring.wav>\r\n"
+    "s: Routing test\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n";
+
+std::string pair(const std::string& name, const std::string& value) {
+    std::string out;
+    out.push_back('\0');
+    out.append(name).push_back('\0');
+    out.append(value);
+    return out;
+}
+
+class InviteHeadersTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(PJ_SUCCESS, pj_init());
+        pj_caching_pool_init(&_cp, nullptr, 0);
+        // The endpoint initialises the message parser
+        ASSERT_EQ(PJ_SUCCESS, pjsip_endpt_create(&_cp.factory, "invite_headers_test", &_endpt));
+        _pool = pj_pool_create(&_cp.factory, "invite_headers_test", 4000, 4000, nullptr);
+    }
+
+    void TearDown() override {
+        if (_pool) pj_pool_release(_pool);
+        if (_endpt) pjsip_endpt_destroy(_endpt);
+        pj_caching_pool_destroy(&_cp);
+        pj_shutdown();
+    }
+
+    pjsip_msg* parse(const std::string& text) {
+        _text.assign(text.begin(), text.end());
+        _text.push_back('\0');
+        return pjsip_parse_msg(_pool, _text.data(), text.size(), nullptr);
+    }
+
+    pj_caching_pool _cp;
+    pjsip_endpoint* _endpt = nullptr;
+    pj_pool_t* _pool = nullptr;
+    std::vector<char> _text;
+};
+
+} // namespace
+
+TEST_F(InviteHeadersTest, PacksConfiguredHeadersInOrder) {
+    pjsip_msg* msg = parse(INVITE);
+    ASSERT_NE(nullptr, msg);
+
+    InviteHeaders headers;
+    headers.configure({"x-caller-id", "P-Asserted-Identity", "X-Missing", "Alert-Info"});
+    std::string out;
+    EXPECT_EQ(4, headers.extract(msg, out));
+    EXPECT_EQ(pair("x-caller-id", "4711")
+            + pair("P-Asserted-Identity", "<sip:alice@example.org>")
+            + pair("P-Asserted-Identity", "<tel:+15551234567>")
+            + pair("Alert-Info", "<http://example.org/ring.wav>"), out);
+}
+
+TEST_F(InviteHeadersTest, MatchesCompactForms) {
+    pjsip_msg* msg = parse(INVITE);
+    ASSERT_NE(nullptr, msg);
+
+    InviteHeaders headers;
+    headers.configure({"Subject", "Call-ID"});
+    std::string out;
+    EXPECT_EQ(2, headers.extract(msg, out));
+    EXPECT_EQ(pair("Subject", "Routing test") + pair("Call-ID", "a84b4c76e66710@192.0.2.1"), out);
+
+    // Typed headers are printed back, whichever form the INVITE used
+    headers.configure({"f"});
+    out.clear();
+    EXPECT_EQ(1, headers.extract(msg, out));
+    EXPECT_NE(std::string::npos, out.find("<sip:alice@example.org>;tag=1928301774"));
+    EXPECT_EQ(0, out.compare(0, 3, std::string("\0f\0", 3)));
+}
+
+TEST_F(InviteHeadersTest, StopsAtTheSizeCap) {
+    std::string text(INVITE);
+    std::string value(100, 'v');
+    std::string extra;
+    for (int i = 0; i < 40; i++) {
+        extra += "X-Route: " + value + "\r\n";
+    }
+    text.insert(text.find("Content-Length"), extra);
+    pjsip_msg* msg = parse(text);
+    ASSERT_NE(nullptr, msg);
+
+    InviteHeaders headers;
+    headers.configure({"X-Route", "X-Caller-Id"});
+    std::string out;
+    int dropped = -1;
+    int found = headers.extract(msg, out, &dropped);
+    size_t each = pair("X-Route", value).size();
+    EXPECT_EQ((int)(InviteHeaders::MAX_BYTES / each), found);
+    EXPECT_EQ(found * each, out.size());
+    EXPECT_LE(out.size(), InviteHeaders::MAX_BYTES);
+    // Headers after the cap are not extracted either, but counted
+    EXPECT_EQ(std::string::npos, out.find("X-Caller-Id"));
+    EXPECT_EQ(40 - found + 1, dropped);
+}
+
+TEST_F(InviteHeadersTest, SkipsOnlyAnOversizedHeader) {
+    std::string text(INVITE);
+    text.insert(text.find("X-Caller-Id"), "X-Big: " + std::string(InviteHeaders::MAX_BYTES, 'b') + "\r\n");
+    pjsip_msg* msg = parse(text);
+    ASSERT_NE(nullptr, msg);
+
+    InviteHeaders headers;
+    headers.configure({"X-Big", "X-Caller-Id"});
+    std::string out;
+    int dropped = -1;
+    EXPECT_EQ(1, headers.extract(msg, out, &dropped));
+    EXPECT_EQ(1, dropped);
+    EXPECT_EQ(pair("X-Caller-Id", "4711"), out);
+}
+
+TEST_F(InviteHeadersTest, NothingConfiguredOrNoMessage) {
+    pjsip_msg* msg = parse(INVITE);
+    ASSERT_NE(nullptr, msg);
+
+    InviteHeaders headers;
+    std::string out;
+    int dropped = -1;
+    EXPECT_EQ(0, headers.extract(msg, out, &dropped));
+    EXPECT_EQ(0, dropped);
+    headers.configure({"X-Caller-Id"});
+    EXPECT_EQ(0, headers.extract(nullptr, out));
+    EXPECT_TRUE(out.empty());
+}
@@ -13,6 +13,16 @@ public:
     MOCK_METHOD(CallData, get_call_info, (const std::string& call_id), (override));
     MOCK_METHOD(void, start_event_loop, (unsigned timeout_ms), (override));
     MOCK_METHOD(void, stop_event_loop, (), (override));
+    MOCK_METHOD(int, get_call_handle, (const std::string& call_id), (const, override));
+    MOCK_METHOD(void, answer_call, (int handle), (override));
+    MOCK_METHOD(void, hang_up_call, (int handle), (override));
+    MOCK_METHOD(CallData, get_call_info, (int handle), (override));
+    MOCK_METHOD(int, get_calls_snapshot, (CallData* out, int cap), (const, override));
+    MOCK_METHOD(int, submit_make_call, (int acc_handle, const std::string& dest_uri), (override));
+    MOCK_METHOD(int, submit_answer_call, (int handle), (override));
+    MOCK_METHOD(int, submit_hang_up_call, (int handle), (override));
+    MOCK_METHOD(int, poll_events, (EventData* out, int max, char* strings, size_t strings_cap), (override));
+    MOCK_METHOD(int, event_fd, (), (const, override));
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+// registrar_failover_test.cpp
+//
+// Runs the manager against two local stand-in registrars: the primary
+// swallows every request (PBX down), the backup answers REGISTER with
+// 200 OK. Measures how long an account takes to end up registered.
+
+#include <gtest/gtest.h>
+#include "../pjsua2_manager.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Minimal UDP registrar: answers REGISTER with 200 OK, or stays silent
+class StandInRegistrar {
+public:
+    explicit StandInRegistrar(bool answer) : _answer(answer), _running(true), _requests(0) {
+        _fd = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        bind(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        _port = ntohs(addr.sin_port);
+        _thread = std::thread(&StandInRegistrar::_run, this);
+    }
+
+    ~StandInRegistrar() {
+        _running = false;
+        _thread.join();
+        close(_fd);
+    }
+
+    std::string uri() const { return "sip:127.0.0.1:" + std::to_string(_port); }
+    std::string host() const { return "127.0.0.1:" + std::to_string(_port); }
+    int requests() const { return _requests.load(); }
+
+private:
+    static std::string _header(const std::string& msg, const std::string& name) {
+        std::istringstream in(msg);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.compare(0, name.size() + 1, name + ":") == 0) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                return line;
+            }
+        }
+        return "";
+    }
+
+    void _run() {
+        char buf[4096];
+        while (_running) {
+            pollfd pfd = {_fd, POLLIN, 0};
+            if (poll(&pfd, 1, 50) <= 0) continue;
+            sockaddr_in from = {};
+            socklen_t len = sizeof(from);
+            ssize_t n = recvfrom(_fd, buf, sizeof(buf) - 1, 0, reinterpret_cast<sockaddr*>(&from), &len);
+            if (n <= 0) continue;
+            buf[n] = '\0';
+            std::string msg(buf);
+            if (msg.compare(0, 9, "REGISTER ") != 0) continue;
+            _requests++;
+            if (!_answer) continue;
+
+            std::string to = _header(msg, "To");
+            if (to.find(";tag=") == std::string::npos) to += ";tag=standin";
+            std::string contact = _header(msg, "Contact");
+            std::string reply =
+                "SIP/2.0 200 OK\r\n" +
+                _header(msg, "Via") + "\r\n" +
+                _header(msg, "From") + "\r\n" +
+                to + "\r\n" +
+                _header(msg, "Call-ID") + "\r\n" +
+                _header(msg, "CSeq") + "\r\n" +
+                (contact.empty() ? "" : contact + ";expires=60\r\n") +
+                "Content-Length: 0\r\n\r\n";
+            sendto(_fd, reply.data(), reply.size(), 0, reinterpret_cast<sockaddr*>(&from), len);
+        }
+    }
+
+    bool _answer;
+    std::atomic<bool> _running;
+    std::atomic<int> _requests;
+    int _fd;
+    int _port;
+    std::thread _thread;
+};
+
+// Wait for an active REG_STATE event of acc_handle; returns elapsed ms or -1
+long wait_registered(PJSUA2Manager& manager, int acc_handle, std::chrono::steady_clock::time_point start, long limit_ms) {
+    EventData events[32];
+    char strings[4096];
+    for (;;) {
+        long elapsed = (long)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        if (elapsed > limit_ms) return -1;
+        int n = manager.poll_events(events, 32, strings, sizeof(strings));
+        for (int i = 0; i < n; i++) {
+            if (events[i].type == PJSUA2_EVENT_REG_STATE && events[i].acc_handle == acc_handle
+                    && events[i].state == 1) {
+                return elapsed;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+} // namespace
+
+TEST(RegistrarFailover, FailsOverToBackupWithinRegisterTimeout) {
+    StandInRegistrar primary(false);
+    StandInRegistrar backup(true);
+
+    ManagerConfig config = PJSUA2Manager::default_config();
+    config.udp_port = 0;
+    config.log_level = 1;
+    PJSUA2Manager manager("default", "secret", backup.host(), config,
+                          nullptr, nullptr, nullptr, nullptr);
+    manager.set_headless(true);
+    manager.start_event_loop(10);
+
+    RegistrationConfig regConfig = PJSUA2Manager::default_registration_config();
+    regConfig.register_timeout_ms = 500;
+    regConfig.failback_sec = 300;
+
+    auto start = std::chrono::steady_clock::now();
+    int acc = manager.add_account("1001", "secret", "127.0.0.1",
+                                  {primary.uri(), backup.uri()}, regConfig);
+    long failover_ms = wait_registered(manager, acc, start, 10000);
+
+    std::cout << "[ registrar ] failover to backup took " << failover_ms << " ms" << std::endl;
+    ASSERT_GE(failover_ms, 0) << "account never registered with the backup";
+    EXPECT_LT(failover_ms, 2000);
+    EXPECT_GE(primary.requests(), 1);
+
+    RegistrarStats stats[2];
+    ASSERT_EQ(manager.get_registrar_stats(acc, stats, 2), 2);
+    EXPECT_EQ(stats[0].active, 0);
+    EXPECT_EQ(stats[0].healthy, 0);
+    EXPECT_EQ(stats[0].last_code, 408);
+    EXPECT_EQ(stats[1].active, 1);
+    EXPECT_EQ(stats[1].healthy, 1);
+    EXPECT_GT(stats[1].last_latency_us, 0u);
+
+    manager.stop_event_loop();
+}
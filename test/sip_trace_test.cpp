@@ -0,0 +1,119 @@
+// sip_trace_test.cpp
+//
+// Writes a trace with TraceRecorder and reads it back with TraceReader:
+// record layout, Call-ID/URI interning per call and the end of a trace cut
+// short. No SIP stack is started.
+
+#include <gtest/gtest.h>
+#include "../sip_trace.hpp"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+std::string temp_path() {
+    char path[] = "/tmp/sip_trace_testXXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    return path;
+}
+
+pj::CallInfo call_info(pjsip_inv_state state) {
+    pj::CallInfo info;
+    info.accId = 3;
+    info.callIdString = "abc@example.org";
+    info.localUri = "sip:alice@example.org";
+    info.remoteUri = "sip:bob@example.org";
+    info.state = state;
+    info.lastStatusCode = PJSIP_SC_OK;
+    return info;
+}
+
+} // namespace
+
+TEST(SipTrace, RoundTripInternsCallStrings) {
+    std::string path = temp_path();
+    TraceRecorder recorder;
+    ASSERT_TRUE(recorder.start(path));
+    recorder.record_call(PJSUA2_TRACE_INCOMING_CALL, 5, 5, call_info(PJSIP_INV_STATE_INCOMING));
+    recorder.record_call(PJSUA2_TRACE_CALL_STATE, 5, 5, call_info(PJSIP_INV_STATE_CONFIRMED));
+    recorder.record(PJSUA2_TRACE_COMMAND, PJSUA2_TRACE_OP_SUBMIT_HANGUP, 5, 5, -1, 42, 0);
+    // Same slot, next generation: a new call carries its strings again
+    recorder.record_call(PJSUA2_TRACE_CALL_STATE, 5, 5 | (1 << 12), call_info(PJSIP_INV_STATE_CALLING));
+    recorder.stop();
+    EXPECT_EQ(4u, recorder.records());
+    EXPECT_EQ(0u, recorder.dropped());
+
+    TraceReader reader;
+    ASSERT_TRUE(reader.open(path));
+    TraceRecord record;
+    std::string strings;
+
+    ASSERT_TRUE(reader.next(record, strings));
+    EXPECT_EQ(PJSUA2_TRACE_INCOMING_CALL, record.kind);
+    EXPECT_EQ(5, record.index);
+    EXPECT_EQ(3, record.acc_handle);
+    EXPECT_EQ("abc@example.org", TraceReader::field(strings, 0));
+    EXPECT_EQ("sip:alice@example.org", TraceReader::field(strings, 1));
+    EXPECT_EQ("sip:bob@example.org", TraceReader::field(strings, 2));
+    uint64_t previous = record.timestamp_us;
+
+    ASSERT_TRUE(reader.next(record, strings));
+    EXPECT_EQ(PJSUA2_TRACE_CALL_STATE, record.kind);
+    EXPECT_EQ(PJSIP_INV_STATE_CONFIRMED, record.state);
+    EXPECT_EQ(PJSIP_SC_OK, record.code);
+    EXPECT_TRUE(strings.empty());
+    EXPECT_GE(record.timestamp_us, previous);
+
+    ASSERT_TRUE(reader.next(record, strings));
+    EXPECT_EQ(PJSUA2_TRACE_COMMAND, record.kind);
+    EXPECT_EQ(PJSUA2_TRACE_OP_SUBMIT_HANGUP, record.op);
+    EXPECT_EQ(42, record.code);
+
+    ASSERT_TRUE(reader.next(record, strings));
+    EXPECT_EQ("abc@example.org", TraceReader::field(strings, 0));
+    EXPECT_FALSE(reader.next(record, strings));
+    remove(path.c_str());
+}
+
+TEST(SipTrace, TruncatedRecordEndsTheTrace) {
+    std::string path = temp_path();
+    TraceRecorder recorder;
+    ASSERT_TRUE(recorder.start(path));
+    recorder.record(PJSUA2_TRACE_REG_STATE, (TraceOp)0, -1, -1, 0, 200, 1, "OK (sip:registrar.example.org)");
+    recorder.record(PJSUA2_TRACE_REG_STATE, (TraceOp)0, -1, -1, 0, 408, 0, "Request Timeout (sip:registrar.example.org)");
+    recorder.stop();
+
+    // Cut the second record's strings in half, as a crash would
+    FILE* file = fopen(path.c_str(), "rb");
+    ASSERT_NE(nullptr, file);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    ASSERT_EQ(0, truncate(path.c_str(), size - 10));
+
+    TraceReader reader;
+    ASSERT_TRUE(reader.open(path));
+    TraceRecord record;
+    std::string strings;
+    ASSERT_TRUE(reader.next(record, strings));
+    EXPECT_EQ(200, record.code);
+    EXPECT_EQ("OK (sip:registrar.example.org)", TraceReader::field(strings, 0));
+    EXPECT_FALSE(reader.next(record, strings));
+    remove(path.c_str());
+}
+
+TEST(SipTrace, RejectsOtherFiles) {
+    std::string path = temp_path();
+    FILE* file = fopen(path.c_str(), "wb");
+    fputs("not a trace, just some text long enough for a header", file);
+    fclose(file);
+
+    TraceReader reader;
+    EXPECT_FALSE(reader.open(path));
+    EXPECT_FALSE(reader.open("/nonexistent/trace"));
+    remove(path.c_str());
+}
@@ -0,0 +1,121 @@
+// trace_replay.cpp
+//
+// Offline replay of a trace written by pjsua2_trace_start: the recorded
+// signalling is fed through the manager's registry and callback layer
+// (pjsua2_trace_replay) on one thread while the main thread drains the
+// resulting events like a Dart isolate would. The endpoint only binds
+// 127.0.0.1 and its account registers towards a closed local port, so no
+// SIP traffic leaves the host. Reports replay throughput, schedule lag and
+// the events delivered.
+//
+//   trace_replay TRACE [--speed S] [--port P]
+
+#include "../ffi_bindings.hpp"
+
+#include <poll.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace {
+
+struct Options {
+    std::string trace;
+    double speed = 0.0;         // 0: as fast as possible, 1: recorded pace
+    int port = 5090;            // Local endpoint; the account registers towards port + 1
+};
+
+bool parse(int argc, char** argv, Options& options) {
+    if (argc < 2 || argc % 2 != 0) return false;
+    options.trace = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        const char* value = argv[i + 1];
+        if (name == "--speed") options.speed = atof(value);
+        else if (name == "--port") options.port = atoi(value);
+        else return false;
+    }
+    return options.speed >= 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse(argc, argv, options)) {
+        fprintf(stderr, "usage: %s TRACE [--speed S] [--port P]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ManagerConfig config;
+    pjsua2_manager_config_default(&config);
+    config.udp_port = options.port;
+    config.tcp_port = -1;
+    config.tls_port = -1;
+    config.log_level = 1;
+    std::string domain = "127.0.0.1:" + std::to_string(options.port + 1);
+    PJSUA2ManagerPtr mgr = pjsua2_manager_create_ex("replay", "", domain.c_str(), &config,
+                                                    nullptr, nullptr, nullptr, nullptr);
+    if (!mgr) {
+        fprintf(stderr, "cannot create the endpoint\n");
+        return EXIT_FAILURE;
+    }
+    pjsua2_set_headless(mgr, 1);
+    pjsua2_start_events_loop_blocking(mgr);
+
+    EventData events[256];
+    char strings[64 * 1024];
+    // Drop the endpoint's own registration events before replaying
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    while (pjsua2_poll_events(mgr, events, 256, strings, sizeof(strings)) > 0) {}
+
+    TraceReplayStats stats;
+    memset(&stats, 0, sizeof(stats));
+    std::atomic<int> status(1);
+    std::thread replay([&] {
+        status.store(pjsua2_trace_replay(mgr, options.trace.c_str(), options.speed, &stats));
+    });
+
+    uint64_t delivered[PJSUA2_EVENT_QUALITY_ALERT + 1] = {0};
+    uint64_t other = 0;
+    struct pollfd pfd = {pjsua2_get_event_fd(mgr), POLLIN, 0};
+    for (bool done = false; !done;) {
+        done = status.load() != 1;
+        poll(&pfd, 1, 20);
+        int n;
+        do {
+            n = pjsua2_poll_events(mgr, events, 256, strings, sizeof(strings));
+            for (int i = 0; i < n; i++) {
+                if (events[i].type <= PJSUA2_EVENT_QUALITY_ALERT) delivered[events[i].type]++;
+                else other++;
+            }
+        } while (n == 256);
+    }
+    replay.join();
+
+    pjsua2_stop_events_loop(mgr);
+    pjsua2_manager_destroy(mgr);
+    if (status.load() != 0) {
+        fprintf(stderr, "cannot replay %s\n", options.trace.c_str());
+        return EXIT_FAILURE;
+    }
+
+    double elapsed = stats.elapsed_us / 1e6;
+    printf("records      %llu  call %llu  registration %llu  commands %llu  skipped %llu\n",
+           (unsigned long long)stats.records, (unsigned long long)stats.call_events,
+           (unsigned long long)stats.reg_events, (unsigned long long)stats.commands,
+           (unsigned long long)stats.skipped);
+    printf("throughput   %.0f records/s over %.3f s (speed %g, max lag %.2f ms)\n",
+           elapsed > 0 ? stats.records / elapsed : 0.0, elapsed, options.speed, stats.max_lag_us / 1000.0);
+    printf("events       incoming %llu  call state %llu  registration %llu  error %llu  other %llu\n",
+           (unsigned long long)delivered[PJSUA2_EVENT_INCOMING_CALL],
+           (unsigned long long)delivered[PJSUA2_EVENT_CALL_STATE],
+           (unsigned long long)delivered[PJSUA2_EVENT_REG_STATE],
+           (unsigned long long)delivered[PJSUA2_EVENT_ERROR], (unsigned long long)other);
+    return EXIT_SUCCESS;
+}